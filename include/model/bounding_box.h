@@ -78,6 +78,13 @@ public:
 	 */
 	float getLengthZ() const;
 
+	/**
+	 * @brief Computes the surface area of the bounding box.
+	 *
+	 * @return The surface area, 0 for an empty box.
+	 */
+	float getSurfaceArea() const;
+
 	/**
 	 * @brief Checks if the bounding box overlaps with another bounding box.
 	 *
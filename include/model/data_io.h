@@ -32,5 +32,6 @@ public:
 	std::vector<Material> materials;
 	std::vector<Texture> textures;
 	std::vector<PointLight> point_lights;
+	std::vector<DirectionLight> direction_lights;
 	std::map<std::string, Index> texture_index;
 };
@@ -27,6 +27,9 @@ public:
 
 	Matrix4f model{1};
 
+	/* The index of the object whose vertices and indices this object instances, -1 if it holds its own. */
+	Index mesh_source{-1};
+
 	/* ========== Path Tracing Data Extension ========== */
 	/* The triangle mesh representing the object's geometry. */
 	std::vector<Triangle> mesh;
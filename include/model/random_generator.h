@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @class RandomGenerator
+ * @brief A small, seedable PCG32 random number generator.
+ *
+ * The generator keeps 16 bytes of state, so it can be created per pixel sample on the stack. Two generators with
+ * the same seed and sequence always produce the same stream, which keeps renders reproducible regardless of the
+ * number of threads.
+ */
+class RandomGenerator
+{
+public:
+	/**
+	 * @brief Default constructor using the default PCG32 stream.
+	 */
+	RandomGenerator() = default;
+
+	/**
+	 * @brief Constructs a generator on a given stream.
+	 *
+	 * @param[in] sequence The stream selector, generators on different streams are independent.
+	 * @param[in] seed The starting offset within the stream.
+	 */
+	RandomGenerator(const uint64_t sequence, const uint64_t seed = 0x853c49e6748fea9bULL);
+
+	/**
+	 * @brief Reseeds the generator.
+	 *
+	 * @param[in] sequence The stream selector, generators on different streams are independent.
+	 * @param[in] seed The starting offset within the stream.
+	 */
+	void setSequence(const uint64_t sequence, const uint64_t seed = 0x853c49e6748fea9bULL);
+
+	/**
+	 * @brief Generates a uniformly distributed 32-bit unsigned integer.
+	 *
+	 * @return The next random integer of the stream.
+	 */
+	uint32_t nextUInt();
+
+	/**
+	 * @brief Generates a uniformly distributed float in [0, 1).
+	 *
+	 * @return The next random number of the stream.
+	 */
+	float nextFloat();
+
+	/**
+	 * @brief Generates a uniformly distributed float in [min, max).
+	 *
+	 * @param[in] min The lower bound of the range.
+	 * @param[in] max The upper bound of the range.
+	 * @return The next random number of the stream.
+	 */
+	float nextFloat(const float min, const float max);
+
+	/**
+	 * @brief Skips ahead or back in the stream in O(log n).
+	 *
+	 * @param[in] delta The number of values to skip, negative values move backwards.
+	 */
+	void advance(const int64_t delta);
+
+	/* The internal state of the generator. */
+	uint64_t state{0x853c49e6748fea9bULL};
+
+	/* The stream increment of the generator, always odd. */
+	uint64_t increment{0xda3e39cb94b95bdbULL};
+};
+
+/**
+ * @brief Mixes the bits of a 64-bit value, used to derive decorrelated seeds from indices.
+ *
+ * @param[in] value The value to mix.
+ * @return The mixed value.
+ */
+uint64_t mixBits(uint64_t value);
+
+/**
+ * @brief Derives a reproducible random seed for one sample of one pixel.
+ *
+ * @param[in] pixel The index of the pixel in the image.
+ * @param[in] sample The index of the sample within the pixel.
+ * @param[in] frame The index of the frame or render pass.
+ * @return A well-mixed 64-bit seed.
+ */
+uint64_t hashSeed(const uint64_t pixel, const uint64_t sample, const uint64_t frame);
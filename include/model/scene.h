@@ -23,4 +23,18 @@ public:
 
 	/* Point lights in the scene */
 	std::vector<PointLight> point_lights;
+
+	/* Directional lights in the scene */
+	std::vector<DirectionLight> direction_lights;
+
+	/**
+	 * @brief Gets the object holding the vertices and indices of an object, which is another object for instances.
+	 *
+	 * @param[in] object An object of the scene.
+	 * @return The object whose vertices and indices the object uses.
+	 */
+	const Object& getGeometry(const Object& object) const
+	{
+		return object.mesh_source == -1 ? object : this->objects[object.mesh_source];
+	}
 };
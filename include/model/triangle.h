@@ -35,8 +35,9 @@ public:
 	 *
 	 * @param[out] result : The sampled point on the triangle.
 	 * @param[out] pdf : The PDF of the sampled point.
+	 * @param[in] u : A uniform two-dimensional sample in [0, 1)^2.
 	 */
-	void sample(Point& result, float& pdf) const;
+	void sample(Point& result, float& pdf, const Vector2f& u) const;
 
 	/* The three vertices of the triangle. */
 	Vertex vertex1, vertex2, vertex3;
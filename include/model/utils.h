@@ -9,6 +9,8 @@
 #include <glm/ext/scalar_constants.hpp>
 #include <glm/glm.hpp>
 
+#include <random_generator.h>
+
 typedef glm::ivec2 Vector2i;
 typedef glm::vec2 Vector2f;
 typedef glm::dvec2 Vector2d;
@@ -44,6 +46,9 @@ float clamp(const float& min, const float& max, const float& n);
 
 /**
  * @brief Generates a random floating-point number within a specified range.
+ *
+ * Uses a per-thread generator seeded once, so it is cheap but not reproducible. Rendering code should draw from
+ * its own RandomGenerator instead.
  * @param[in] min The lower bound of the range.
  * @param[in] max The upper bound of the range.
  * @return A random number between min and max.
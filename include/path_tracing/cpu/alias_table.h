@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+/**
+ * @struct AliasEntry
+ * @brief One slot of an alias table, it keeps its own index with a probability and gives the rest to its alias.
+ */
+struct AliasEntry
+{
+	/* The probability of keeping the index of the slot rather than switching to the alias. */
+	float probability{1.0f};
+
+	/* The index the slot switches to. */
+	int alias{0};
+
+	/* The probability of the index of the slot being sampled. */
+	float pmf{0.0f};
+};
+
+/**
+ * @class AliasTable
+ * @brief Samples an index with probability proportional to a weight in constant time (Vose's alias method).
+ */
+class AliasTable
+{
+public:
+	/**
+	 * @brief Builds the table for a set of weights, all indices are equally likely if the weights sum to zero.
+	 *
+	 * @param[in] weights The non-negative weight of every index.
+	 */
+	void build(const std::vector<float>& weights);
+
+	/**
+	 * @brief Samples an index.
+	 *
+	 * @param[in] u A uniform sample in [0, 1).
+	 * @param[out] pmf The probability of the sampled index.
+	 * @param[out] u_remapped The part of the sample not used to pick the index, again uniform in [0, 1), so the
+	 * caller can reuse it.
+	 * @return The sampled index.
+	 */
+	int sample(const float u, float& pmf, float& u_remapped) const
+	{
+		int count = int(this->entries.size());
+		float scaled = u * float(count);
+		int index = std::min(int(scaled), count - 1);
+		float fraction = std::min(scaled - float(index), 0.99999994f);
+
+		const AliasEntry& entry = this->entries[index];
+		if (fraction < entry.probability)
+		{
+			u_remapped = std::min(fraction / entry.probability, 0.99999994f);
+		}
+		else
+		{
+			u_remapped = std::min((fraction - entry.probability) / (1.0f - entry.probability), 0.99999994f);
+			index = entry.alias;
+		}
+		pmf = this->entries[index].pmf;
+		return index;
+	}
+
+	/**
+	 * @brief Gets the probability of an index.
+	 *
+	 * @param[in] index The index.
+	 * @return The probability that sample returns the index.
+	 */
+	float getPMF(const int index) const
+	{
+		return this->entries[index].pmf;
+	}
+
+	/**
+	 * @brief Checks whether the table was built.
+	 *
+	 * @return True if the table has no entries.
+	 */
+	bool empty() const
+	{
+		return this->entries.empty();
+	}
+
+	/* The slots of the table, one per index. */
+	std::vector<AliasEntry> entries;
+};
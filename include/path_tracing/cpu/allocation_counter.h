@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Gets the number of heap allocations made by the calling thread so far.
+ *
+ * Debug builds replace the global operator new to count allocations per thread, so the render loops can check that
+ * tracing a sample never touches the heap. Release builds keep the default allocator and always return 0.
+ *
+ * @return The number of calls to operator new made by the calling thread.
+ */
+uint64_t getAllocationCount();
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <data_io.h>
+#include <path_tracing_scene.h>
+#include <utils.h>
+
+/**
+ * @brief Measures the ray throughput of the recursive BVH traversal against the wide BVH traversal.
+ *
+ * Camera rays through random pixel positions and cosine-distributed secondary rays leaving their hit points are
+ * traced with both traversals on a single thread. The hits of both traversals are compared and the throughput is
+ * printed in millions of rays per second.
+ *
+ * @param[in] scene The scene with initialized BVHs.
+ * @param[in] ray_count The number of camera rays to trace.
+ */
+void benchmarkTraversal(const PathTracingScene& scene, const int ray_count);
+
+/**
+ * @brief Measures the ray throughput of single-ray queries against packet queries and of any-hit shadow queries.
+ *
+ * Camera rays through the pixel centers in scanline order are traced one at a time and as a packet stream on a single
+ * thread, shadow rays from their hits towards sampled light points as closest-hit and as any-hit queries. The results
+ * are compared and the throughput is printed in millions of rays per second.
+ *
+ * @param[in] scene The scene with initialized BVHs.
+ * @param[in] ray_count The number of camera rays to trace.
+ */
+void benchmarkPacketTraversal(PathTracingScene& scene, const int ray_count);
+
+/**
+ * @brief Measures the OBJ loader in triangles per second.
+ *
+ * The file is loaded several times through InputOutput::loadObjFile, which parses the text and deduplicates the
+ * vertices of every shape in parallel. The best time, the triangle and vertex counts and the throughput are printed.
+ *
+ * @param[in] path The directory of the model, ending with a separator.
+ * @param[in] name The name of the model, the file loaded is path + name + ".obj".
+ */
+void benchmarkObjLoader(const std::string& path, const std::string& name);
+
+/**
+ * @brief Measures updating the BVHs of an animated scene against rebuilding them.
+ *
+ * Every frame the vertices of the in-memory meshes are displaced along their normals by a travelling wave and, on
+ * every other frame, every other object is moved as well, so both the refit and the top-level rebuild of
+ * PathTracingScene::updateBVH are exercised. The update time per frame, the refit and rebuild counts and the SAH cost
+ * of the updated BVHs are printed next to the time and SAH cost of a full rebuild of the last frame.
+ *
+ * @param[in,out] scene The scene with initialized BVHs, it is left in the last frame of the animation.
+ * @param[in] frame_count The number of frames to animate.
+ */
+void benchmarkAnimation(PathTracingScene& scene, const int frame_count);
+
+/**
+ * @brief Compares the light samplers of PathTracingScene::sampleLight by cost and by noise.
+ *
+ * Every sampler estimates the direct irradiance at random camera hits from a number of light samples with shadow
+ * rays. The time per sampleLight call and the mean relative variance of a single sample estimate are printed, lower
+ * variance at the same sample count is less noise in the rendered image.
+ *
+ * @param[in,out] scene The scene with initialized BVHs, its light_sampler_type is restored afterwards.
+ * @param[in] point_count The number of camera hits the irradiance is estimated at.
+ * @param[in] sample_count The number of light samples per camera hit.
+ */
+void benchmarkLightSampling(PathTracingScene& scene, const int point_count, const int sample_count);
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include <path_tracing_material.h>
+
+/**
+ * @struct BSDFParameters
+ * @brief A material compiled for shading, the fields the BSDF kernels read in a small block without strings.
+ *
+ * The scene keeps one block per material, so every hit reads its parameters through an index instead of a copy of the
+ * material.
+ */
+struct BSDFParameters
+{
+	/**
+	 * @brief Default constructor for BSDFParameters.
+	 */
+	BSDFParameters() = default;
+
+	/**
+	 * @brief Compiles a material.
+	 *
+	 * @param[in] material The material.
+	 */
+	explicit BSDFParameters(const Material& material);
+
+	/* The diffuse and specular reflectance. */
+	Vector3f kd{0.0f}, ks{0.0f};
+
+	/* The Phong exponent. */
+	float ns{0.0f};
+
+	/* The refractive index. */
+	float ni{1.0f};
+
+	/* The probability that a glossy sample is drawn from the Phong lobe rather than the diffuse one. */
+	float specular_probability{0.5f};
+
+	/* Whether the diffuse color is read from the texture of the object instead of kd. */
+	bool textured{false};
+
+	/* The type of the material, selecting its kernels. */
+	MaterialType type{MaterialType::Diffuse};
+};
+
+/**
+ * @brief Samples a direction from the cosine-weighted hemisphere around a normal.
+ *
+ * @param[in] normal The surface normal.
+ * @param[in] u A uniform two-dimensional sample in [0, 1)^2.
+ * @return The sampled direction.
+ */
+Vector3f diffuseSample(const Direction& normal, const Vector2f& u);
+
+/**
+ * @brief Samples a direction from a Phong lobe around the mirror direction.
+ *
+ * @param[in] wi The incident direction, pointing to the surface.
+ * @param[in] normal The surface normal.
+ * @param[in] ns The Phong exponent.
+ * @param[in] u A uniform two-dimensional sample in [0, 1)^2.
+ * @return The sampled direction.
+ */
+Vector3f glossySample(const Direction& wi, const Direction& normal, const float ns, const Vector2f& u);
+
+/**
+ * @brief Samples the refracted direction, or the mirror direction under total internal reflection.
+ *
+ * @param[in] wi The incident direction, pointing to the surface.
+ * @param[in] normal The surface normal, pointing out of the material.
+ * @param[in] ni The refractive index of the material.
+ * @return The sampled direction.
+ */
+Vector3f refractionSample(const Direction& wi, const Direction& normal, const float ni);
+
+/**
+ * @struct BSDF
+ * @brief The sample, evaluate and pdf kernels of one material type.
+ *
+ * Every kernel is specialized for its type, so a loop over hits of one type has no branch on the type. wi points away
+ * from the surface in every kernel, evaluate returns the BSDF times the cosine of wo to the normal and pdf the density
+ * with respect to solid angle of sample returning wo.
+ *
+ * @tparam type The material type.
+ */
+template <MaterialType type>
+struct BSDF;
+
+template <>
+struct BSDF<MaterialType::Diffuse>
+{
+	/* Whether the sampled directions form a delta distribution without a density. */
+	static constexpr bool delta = false;
+
+	static Vector3f sample(const BSDFParameters&, const Direction&, const Direction& normal, const Vector2f& u)
+	{
+		return diffuseSample(normal, u);
+	}
+
+	static Vector3f evaluate(const BSDFParameters& bsdf, const Direction&, const Direction& wo, const Direction& normal,
+							 const Vector3f& color)
+	{
+		Vector3f albedo = bsdf.textured ? color : bsdf.kd;
+		return std::max(glm::dot(normal, wo), 0.0f) * albedo / pi;
+	}
+
+	static float pdf(const BSDFParameters&, const Direction&, const Direction& wo, const Direction& normal)
+	{
+		return std::max(glm::dot(normal, wo), 0.0f) / pi;
+	}
+};
+
+template <>
+struct BSDF<MaterialType::Glossy>
+{
+	/* Whether the sampled directions form a delta distribution without a density. */
+	static constexpr bool delta = false;
+
+	static Vector3f sample(const BSDFParameters& bsdf, const Direction& wi, const Direction& normal, const Vector2f& u)
+	{
+		/* The first dimension picks the lobe and is stretched back to [0, 1) for sampling it */
+		float specular = bsdf.specular_probability;
+		if (u.x < specular)
+		{
+			return glossySample(-wi, normal, bsdf.ns, Vector2f{u.x / specular, u.y});
+		}
+		return diffuseSample(normal, Vector2f{(u.x - specular) / (1.0f - specular), u.y});
+	}
+
+	static Vector3f evaluate(const BSDFParameters& bsdf, const Direction& wi, const Direction& wo,
+							 const Direction& normal, const Vector3f& color)
+	{
+		float cos_theta = glm::dot(normal, wo);
+		if (cos_theta <= 0.0f)
+		{
+			return Vector3f{0.0f};
+		}
+
+		Vector3f albedo = bsdf.textured ? color : bsdf.kd;
+		Vector3f diffuse = cos_theta * albedo / pi;
+
+		Vector3f half_direction = glm::normalize(wo + wi);
+		Vector3f specular = std::pow(std::max(glm::dot(normal, half_direction), 0.0f), bsdf.ns) * bsdf.ks;
+
+		return diffuse + specular;
+	}
+
+	static float pdf(const BSDFParameters& bsdf, const Direction& wi, const Direction& wo, const Direction& normal)
+	{
+		/* Phong lobe around the mirror direction, mixed with the diffuse lobe as sample picks them */
+		float diffuse = std::max(glm::dot(normal, wo), 0.0f) / pi;
+		float exponent = std::max(bsdf.ns, 0.0f);
+		float cos_alpha = glm::dot(glm::normalize(glm::reflect(-wi, normal)), wo);
+		float lobe = cos_alpha > 0.0f ? (exponent + 1.0f) / (2.0f * pi) * std::pow(cos_alpha, exponent) : 0.0f;
+		return bsdf.specular_probability * lobe + (1.0f - bsdf.specular_probability) * diffuse;
+	}
+};
+
+template <>
+struct BSDF<MaterialType::Specular>
+{
+	/* Whether the sampled directions form a delta distribution without a density. */
+	static constexpr bool delta = true;
+
+	static Vector3f sample(const BSDFParameters&, const Direction& wi, const Direction& normal, const Vector2f&)
+	{
+		return glm::reflect(-wi, normal);
+	}
+
+	static Vector3f evaluate(const BSDFParameters&, const Direction&, const Direction&, const Direction&,
+							 const Vector3f&)
+	{
+		return Vector3f{0.0f};
+	}
+
+	static float pdf(const BSDFParameters&, const Direction&, const Direction&, const Direction&)
+	{
+		return 0.0f;
+	}
+};
+
+template <>
+struct BSDF<MaterialType::Refraction>
+{
+	/* Whether the sampled directions form a delta distribution without a density. */
+	static constexpr bool delta = true;
+
+	static Vector3f sample(const BSDFParameters& bsdf, const Direction& wi, const Direction& normal, const Vector2f&)
+	{
+		return refractionSample(-wi, normal, bsdf.ni);
+	}
+
+	static Vector3f evaluate(const BSDFParameters&, const Direction&, const Direction&, const Direction&,
+							 const Vector3f&)
+	{
+		return Vector3f{0.0f};
+	}
+
+	static float pdf(const BSDFParameters&, const Direction&, const Direction&, const Direction&)
+	{
+		return 0.0f;
+	}
+};
+
+/**
+ * @struct BSDFKernels
+ * @brief The kernels of one material type, for callers that shade hits of mixed types.
+ */
+struct BSDFKernels
+{
+	Vector3f (*sample)(const BSDFParameters& bsdf, const Direction& wi, const Direction& normal, const Vector2f& u);
+	Vector3f (*evaluate)(const BSDFParameters& bsdf, const Direction& wi, const Direction& wo, const Direction& normal,
+						 const Vector3f& color);
+	float (*pdf)(const BSDFParameters& bsdf, const Direction& wi, const Direction& wo, const Direction& normal);
+
+	/* Whether the sampled directions form a delta distribution without a density. */
+	bool delta;
+};
+
+/* The kernels of every material type, indexed by MaterialType. */
+extern const std::array<BSDFKernels, 4> BSDF_KERNELS;
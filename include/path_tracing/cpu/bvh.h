@@ -31,8 +31,11 @@ public:
 	/* Flag indicating whether this node is a leaf node. */
 	bool leaf_node_flag{false};
 
-	/* The triangle stored in this leaf node (valid only if it is a leaf). */
-	Triangle triangle{};
+	/* First entry of the leaf in the primitive index array of the owner (valid only if it is a leaf). */
+	int primitive_offset = -1;
+
+	/* Number of primitives stored in the leaf (valid only if it is a leaf). */
+	int primitive_count = 0;
 };
 
 /**
@@ -46,6 +49,86 @@ public:
 	int object_index;
 };
 
+/**
+ * @class BVHBuilder
+ * @brief Builds a binary BVH over primitive bounds with the binned surface area heuristic (SAH).
+ *
+ * The builder reorders a single index array in place, every node owns a contiguous range of it. Splits are chosen
+ * among bin_count planes along the largest centroid extent, and subtrees larger than task_threshold primitives are
+ * built as parallel OpenMP tasks.
+ */
+class BVHBuilder
+{
+public:
+	/**
+	 * @brief Default constructor for BVHBuilder.
+	 */
+	BVHBuilder() = default;
+
+	/**
+	 * @brief Builds a BVH.
+	 *
+	 * @param[in] boxes The bounding box of every primitive.
+	 * @param[in] areas The surface area of every primitive, summed into the node areas used for sampling.
+	 * @param[out] nodes The BVH nodes, the root is nodes[0].
+	 * @param[out] indices The primitive indices, leaves reference ranges of this array.
+	 */
+	void build(const std::vector<BoundingBox>& boxes,
+			   const std::vector<float>& areas,
+			   std::vector<BVH>& nodes,
+			   std::vector<int>& indices) const;
+
+	/**
+	 * @brief Computes the SAH cost of a BVH, the expected cost of a ray that hits the root bounds.
+	 *
+	 * @param[in] nodes The BVH nodes, the root is nodes[0].
+	 * @return The SAH cost in units of one ray-box test.
+	 */
+	float getSAHCost(const std::vector<BVH>& nodes) const;
+
+	/* Leaves are only split further while they hold more primitives than this, or when splitting is cheaper. */
+	int max_leaf_size = 4;
+
+	/* Number of candidate bins per split. */
+	int bin_count = 16;
+
+	/* Relative cost of a ray-box test. */
+	float traversal_cost = 1.0f;
+
+	/* Relative cost of a ray-primitive test. */
+	float intersection_cost = 1.0f;
+
+	/* Subtrees with more primitives than this are built as separate tasks. */
+	int task_threshold = 4096;
+};
+
+/**
+ * @brief Recomputes the bounds and areas of a BVH bottom-up after its primitives moved, keeping its topology.
+ *
+ * Both BVHBuilder and the scene BVH store the children of a node after the node, so one pass from the last node to
+ * the root visits every child before its parent.
+ *
+ * @param[in,out] nodes The BVH nodes, the root is nodes[0].
+ * @param[in] refit_leaf Sets the bounding box and area of a leaf node from its primitives.
+ */
+template <typename Node, typename RefitLeaf>
+void refitBVH(std::vector<Node>& nodes, RefitLeaf refit_leaf)
+{
+	for (size_t i = nodes.size(); i-- > 0;)
+	{
+		Node& node = nodes[i];
+		if (node.leaf_node_flag)
+		{
+			refit_leaf(node);
+			continue;
+		}
+
+		node.bounding_box = nodes[node.left].bounding_box;
+		node.bounding_box.unionBox(nodes[node.right].bounding_box);
+		node.area = nodes[node.left].area + nodes[node.right].area;
+	}
+}
+
 /**
  * @class IntersectResult
  * @brief Stores the results of a ray-object intersection test.
@@ -68,6 +151,9 @@ public:
 	/* The index of the intersected object. */
 	int object_index;
 
+	/* The index of the intersected triangle in the mesh of the object. */
+	int triangle_index{-1};
+
 	/* The interpolated color at the intersection point. */
 	Vector3f color{0.0f, 0.0f, 0.0f};
 
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <path_tracing_scene.h>
+#include <sampler.h>
+#include <utils.h>
+
+/**
+ * @struct RenderCheckpoint
+ * @brief The state of a progressive render, written to disk so an interrupted render can be resumed.
+ *
+ * The samplers derive every sample from the seed, the pixel and the sample index. The random number state of a
+ * render is therefore fully described by the sampler type, the seed and the number of samples every pixel has taken,
+ * and a resumed render continues with exactly the samples the interrupted one would have taken. The settings that
+ * change what a sample estimates are stored as well, a render with other settings does not resume the checkpoint.
+ */
+struct RenderCheckpoint
+{
+	/**
+	 * @brief Writes the checkpoint to a temporary file and renames it over the target.
+	 *
+	 * A render killed while writing leaves the previous checkpoint intact.
+	 *
+	 * @param[in] path The path of the checkpoint file.
+	 * @return True if the checkpoint was written.
+	 */
+	bool save(const std::string& path) const;
+
+	/**
+	 * @brief Reads a checkpoint written by save.
+	 *
+	 * @param[in] path The path of the checkpoint file.
+	 * @return True if the file exists and is a complete checkpoint.
+	 */
+	bool load(const std::string& path);
+
+	/* The image width in pixels. */
+	int width{0};
+
+	/* The image height in pixels. */
+	int height{0};
+
+	/* The sample generator of the render. */
+	SamplerType sampler_type{SamplerType::Sobol};
+
+	/* The target samples per pixel, the stratified sampler sizes its strata from it. */
+	int spp{0};
+
+	/* The seed of the sampler. */
+	uint64_t seed{0};
+
+	/* The maximum path depth of the render. */
+	int max_depth{0};
+
+	/* The depth at which Russian roulette starts terminating paths. */
+	int russian_roulette_depth{0};
+
+	/* The sampler the scene picks lights with. */
+	LightSamplerType light_sampler_type{LightSamplerType::Power};
+
+	/* The number of passes rendered so far. */
+	int passes{0};
+
+	/* The render time in seconds spent so far, summed over all resumed runs. */
+	double elapsed{0.0};
+
+	/* The number of samples taken by every pixel, also the index of its next sample. */
+	std::vector<uint32_t> sample_counts;
+
+	/* The sum of the radiance samples of every pixel, kept in floating point to preserve high dynamic range. */
+	std::vector<Vector3f> accumulation;
+};
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <sampler.h>
+#include <tile_scheduler.h>
+#include <utils.h>
+
+/**
+ * @enum MessageType
+ * @brief Defines the messages exchanged between the render coordinator and its workers.
+ */
+enum class MessageType : uint32_t
+{
+	Setup,	/* Coordinator to worker, the RenderSettings of the render. */
+	Task,	/* Coordinator to worker, a RenderTask to render. */
+	Result, /* Worker to coordinator, the task index followed by the radiance sums of the tile. */
+	Finish	/* Coordinator to worker, all tasks are done. */
+};
+
+/**
+ * @struct RenderSettings
+ * @brief The render parameters the coordinator sends to every worker, so all workers render the same image.
+ */
+struct RenderSettings
+{
+	/* The image width in pixels, checked against the scene loaded by the worker. */
+	int32_t width{0};
+
+	/* The image height in pixels, checked against the scene loaded by the worker. */
+	int32_t height{0};
+
+	/* The number of samples per pixel. */
+	int32_t spp{1};
+
+	/* The sample generator, see SamplerType. */
+	int32_t sampler_type{0};
+
+	/* The frame index seeding the sampler. */
+	int32_t frame{0};
+
+	/* The maximum path depth. */
+	int32_t max_depth{0};
+
+	/* The depth after which Russian roulette starts. */
+	int32_t russian_roulette_depth{0};
+
+	/* How lights are picked for next event estimation, see LightSamplerType. */
+	int32_t light_sampler_type{0};
+};
+
+/**
+ * @struct RenderTask
+ * @brief A unit of distributed work, a range of sample indices of all pixels of one tile.
+ */
+struct RenderTask
+{
+	/* The index of the task. */
+	int32_t index{0};
+
+	/* The first pixel column of the tile. */
+	int32_t x_begin{0};
+
+	/* The first pixel row of the tile. */
+	int32_t y_begin{0};
+
+	/* One past the last pixel column of the tile. */
+	int32_t x_end{0};
+
+	/* One past the last pixel row of the tile. */
+	int32_t y_end{0};
+
+	/* The first sample index. */
+	int32_t sample_begin{0};
+
+	/* One past the last sample index. */
+	int32_t sample_end{0};
+};
+
+/**
+ * @class Connection
+ * @brief A TCP connection carrying length-prefixed messages.
+ *
+ * Every message starts with its MessageType and payload size as two 32-bit integers. Sends and receives block until
+ * the whole message is transferred; a closed or broken connection makes them fail instead of blocking forever.
+ */
+class Connection
+{
+public:
+	/**
+	 * @brief Default constructor for Connection.
+	 */
+	Connection() = default;
+
+	/**
+	 * @brief Wraps an accepted socket.
+	 *
+	 * @param[in] handle The socket handle.
+	 */
+	explicit Connection(const int64_t handle);
+
+	Connection(const Connection&) = delete;
+	Connection& operator=(const Connection&) = delete;
+
+	Connection(Connection&& other) noexcept;
+	Connection& operator=(Connection&& other) noexcept;
+
+	/**
+	 * @brief Closes the connection.
+	 */
+	~Connection();
+
+	/**
+	 * @brief Connects to a listening coordinator.
+	 *
+	 * @param[in] host The host name or address.
+	 * @param[in] port The TCP port.
+	 * @return True if the connection was established.
+	 */
+	bool open(const std::string& host, const int port);
+
+	/**
+	 * @brief Closes the connection.
+	 */
+	void close();
+
+	/**
+	 * @brief Checks whether the connection is open.
+	 *
+	 * @return True if the connection is open.
+	 */
+	bool isOpen() const;
+
+	/**
+	 * @brief Sends one message.
+	 *
+	 * @param[in] type The message type.
+	 * @param[in] data The payload.
+	 * @param[in] size The payload size in bytes.
+	 * @return True if the whole message was sent.
+	 */
+	bool send(const MessageType type, const void* data, const size_t size);
+
+	/**
+	 * @brief Receives one message.
+	 *
+	 * @param[out] type The message type.
+	 * @param[out] data The payload.
+	 * @return True if a whole message was received.
+	 */
+	bool receive(MessageType& type, std::vector<char>& data);
+
+	/* The socket handle, -1 if closed. */
+	int64_t handle{-1};
+};
+
+/**
+ * @class RenderCoordinator
+ * @brief Splits an image into tasks, hands them to worker processes over TCP and merges the returned tiles.
+ *
+ * Workers may connect at any time. Every worker has at most one task in flight; when its connection breaks, e.g.
+ * because the worker process died, or it does not return the task within task_timeout seconds, the worker is dropped
+ * and the task is handed to the next idle worker. A task that timed out gets twice the time on its next worker, and
+ * render throws once it timed out more than max_task_timeouts times. The returned radiance sums are added to an HDR
+ * accumulation buffer, so tasks may cover any range of samples.
+ */
+class RenderCoordinator
+{
+public:
+	/**
+	 * @brief Default constructor for RenderCoordinator.
+	 */
+	RenderCoordinator() = default;
+
+	/**
+	 * @brief Closes the listening socket.
+	 */
+	~RenderCoordinator();
+
+	/**
+	 * @brief Starts listening for workers.
+	 *
+	 * @param[in] port The TCP port, workers connect to it.
+	 * @return True if the socket is listening.
+	 */
+	bool listen(const int port);
+
+	/**
+	 * @brief Renders an image with the connected workers and waits until every task is done.
+	 *
+	 * @param[in] settings The render parameters sent to every worker.
+	 * @param[in] tile_size The edge length of a square tile in pixels.
+	 * @param[in] task_spp The number of samples per task, 0 renders all samples of a tile in one task.
+	 * @param[out] frame_buffer The average radiance of every pixel.
+	 */
+	void render(const RenderSettings& settings,
+				const int tile_size,
+				const int task_spp,
+				std::vector<Vector3f>& frame_buffer);
+
+	/* Seconds a worker has to return a task before it is presumed hung, also the longest wait for a started message.
+	   It has to exceed the time one task takes, with task_spp 0 all samples of a tile. */
+	int task_timeout{300};
+
+	/* Number of times a task may time out, each time with a doubled deadline, before render gives up. */
+	int max_task_timeouts{3};
+
+	/* Number of tasks that were handed out again after their worker disconnected or timed out. */
+	int reissued{0};
+
+	/* Number of workers that connected during the render. */
+	int worker_count{0};
+
+private:
+	/* The listening socket handle, -1 if closed. */
+	int64_t listen_handle{-1};
+};
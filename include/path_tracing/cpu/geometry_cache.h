@@ -0,0 +1,153 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <utils.h>
+
+/* The size of the pages the geometry cache reads and evicts as a whole, pages never split an element. */
+constexpr size_t GEOMETRY_PAGE_SIZE = 64 * 1024;
+
+/**
+ * @class GeometryCache
+ * @brief Loads the geometry arrays of out-of-core objects on demand from a scene cache file into a bounded page cache.
+ *
+ * Every array is split into pages of up to GEOMETRY_PAGE_SIZE bytes of whole elements. A page is read from the file
+ * the first time one of its elements is needed and kept in a least recently used list; once the pages take more than
+ * capacity bytes the oldest ones are dropped, so the resident geometry stays bounded no matter how large the file is.
+ *
+ * Pages are read with positioned reads instead of through a memory mapping: the operating system may map far more
+ * of a mapped file than was touched, e.g. whole 2 MB page cache folios, which the process cannot bound.
+ *
+ * Every thread holds on to the last page it used, so the element returned by get stays valid until the same thread
+ * gets an element of another page, and the cache may exceed its capacity by about one page per thread.
+ */
+class GeometryCache
+{
+public:
+	/**
+	 * @brief Constructs a geometry cache.
+	 *
+	 * @param[in] capacity The number of bytes of pages kept resident, at least one page.
+	 */
+	explicit GeometryCache(const size_t capacity);
+
+	GeometryCache(const GeometryCache&) = delete;
+	GeometryCache& operator=(const GeometryCache&) = delete;
+
+	/**
+	 * @brief Closes the file.
+	 */
+	~GeometryCache();
+
+	/**
+	 * @brief Opens the file holding the arrays.
+	 *
+	 * @param[in] path The path of the scene cache file.
+	 * @return True if the file was opened.
+	 */
+	bool open(const std::string& path);
+
+	/**
+	 * @brief Registers an array stored in the file.
+	 *
+	 * @param[in] offset The byte offset of the first element in the file.
+	 * @param[in] count The number of elements.
+	 * @param[in] element_size The size of an element in bytes.
+	 * @return The index of the array, used to get its elements.
+	 */
+	int addArray(const size_t offset, const int count, const size_t element_size);
+
+	/**
+	 * @brief Gets an element of an array, loading its page on demand.
+	 *
+	 * @param[in] array The index of the array returned by addArray.
+	 * @param[in] index The index of the element in the array.
+	 * @return The element, valid until the calling thread gets an element of another page.
+	 */
+	template <typename T>
+	const T& get(const int array, const int index) const
+	{
+		return *reinterpret_cast<const T*>(this->getElement(array, index));
+	}
+
+	/**
+	 * @brief Gets the number of elements of an array.
+	 *
+	 * @param[in] array The index of the array returned by addArray.
+	 * @return The number of elements.
+	 */
+	int getCount(const int array) const;
+
+	/**
+	 * @brief Prints the number of page loads, evictions and the peak resident size.
+	 */
+	void outputStatistics() const;
+
+	/* The number of bytes of pages kept resident. */
+	size_t capacity;
+
+private:
+	/* Where an array is stored in the file and how it is split into pages */
+	struct GeometryArray
+	{
+		size_t offset;
+		int count;
+		size_t element_size;
+		int page_elements;
+	};
+
+	/**
+	 * @brief Gets the bytes of an element of an array, loading its page on demand.
+	 *
+	 * @param[in] array The index of the array.
+	 * @param[in] index The index of the element in the array.
+	 * @return The first byte of the element.
+	 */
+	const char* getElement(const int array, const int index) const;
+
+	/**
+	 * @brief Finds a page in the cache or reads it from the file, and marks it as most recently used.
+	 *
+	 * @param[in] array The index of the array.
+	 * @param[in] page The index of the page in the array.
+	 * @return The bytes of the page.
+	 */
+	std::shared_ptr<const std::vector<char>> getPage(const int array, const int page) const;
+
+	/* The file handle, -1 if closed. */
+	int64_t handle{-1};
+
+	/* The registered arrays. */
+	std::vector<GeometryArray> arrays;
+
+	/* Distinguishes this cache from others in the page every thread holds on to. */
+	uint64_t id;
+
+	/* Guards the page list and the statistics. */
+	mutable std::mutex mutex;
+
+	/* The keys of the resident pages, most recently used first. */
+	mutable std::list<uint64_t> pages;
+
+	/* The bytes and the position in the page list of every resident page. */
+	mutable std::unordered_map<uint64_t,
+							   std::pair<std::shared_ptr<const std::vector<char>>, std::list<uint64_t>::iterator>>
+		page_data;
+
+	/* The bytes of the resident pages. */
+	mutable size_t resident_bytes{0};
+
+	/* Number of pages read from the file. */
+	mutable uint64_t page_loads{0};
+
+	/* Number of pages dropped from the cache. */
+	mutable uint64_t evictions{0};
+
+	/* The largest number of bytes resident at the same time. */
+	mutable size_t peak_bytes{0};
+};
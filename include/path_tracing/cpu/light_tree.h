@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <bounding_box.h>
+#include <utils.h>
+
+/**
+ * @struct LightBounds
+ * @brief Bounds the position, power and emission directions of one light or of a group of lights.
+ *
+ * The normals of the emitters lie in a cone of half angle theta_o around axis, and every emitter radiates up to
+ * theta_e beyond its normal; lights emitting in all directions have cos_theta_o = -1.
+ */
+struct LightBounds
+{
+	/**
+	 * @brief Estimates how much the bounded lights contribute to a shading point, an upper bound up to the distance.
+	 *
+	 * @param[in] point The shading point.
+	 * @param[in] normal The normal at the shading point, zero to ignore the orientation of the receiver.
+	 * @return The importance, 0 if no bounded light can reach the point.
+	 */
+	float getImportance(const Point& point, const Direction& normal) const;
+
+	/**
+	 * @brief Merges the bounds of another group of lights into these bounds.
+	 *
+	 * @param[in] other The bounds to merge, ignored if it has no power.
+	 */
+	void unionBounds(const LightBounds& other);
+
+	/* The bounding box of the emitters. */
+	BoundingBox bounding_box{};
+
+	/* The total emitted power, 0 for empty bounds. */
+	float power{0.0f};
+
+	/* The axis of the cone bounding the emitter normals. */
+	Direction axis{0.0f, 0.0f, 1.0f};
+
+	/* The cosines of the half angle of the normal cone and of the emission angle around every normal. */
+	float cos_theta_o{1.0f};
+	float cos_theta_e{0.0f};
+};
+
+/**
+ * @struct LightTreeNode
+ * @brief A node of the light tree, stored depth first so the first child of an interior node follows it.
+ */
+struct LightTreeNode
+{
+	/* The bounds of the lights below the node. */
+	LightBounds bounds;
+
+	/* The light of a leaf node, or the index of the second child of an interior node. */
+	int child_or_light{-1};
+
+	/* Whether the node is a leaf node. */
+	bool leaf_node_flag{false};
+};
+
+/**
+ * @class LightTree
+ * @brief A bounding volume hierarchy over lights, sampling them by their estimated contribution to a shading point.
+ *
+ * Every traversal step picks a child with probability proportional to its importance, so lights that are close,
+ * bright and facing the point are found in logarithmic time and distant or back-facing ones are rarely picked. The
+ * tree is built top-down by the surface area orientation heuristic.
+ *
+ * Infinite lights, such as directional lights, have no bounds and are kept beside the tree. Each of them is picked by
+ * its power against the power of the whole tree.
+ */
+class LightTree
+{
+public:
+	/**
+	 * @brief Builds the tree, lights without power are never sampled and left out.
+	 *
+	 * @param[in] lights The bounds of every light, the light index of a sample is its position in this list.
+	 * @param[in] infinite_count The number of infinite lights at the end of the list, only the power of their bounds is
+	 * used.
+	 */
+	void build(const std::vector<LightBounds>& lights, const int infinite_count = 0);
+
+	/**
+	 * @brief Samples a light for a shading point.
+	 *
+	 * @param[in] point The shading point.
+	 * @param[in] normal The normal at the shading point, zero for points in a medium.
+	 * @param[in] u A uniform sample in [0, 1).
+	 * @param[out] pmf The probability of the sampled light.
+	 * @return The sampled light, -1 if no light can reach the point.
+	 */
+	int sample(const Point& point, const Direction& normal, float u, float& pmf) const;
+
+	/**
+	 * @brief Gets the probability that sample picks a light for a shading point.
+	 *
+	 * @param[in] point The shading point.
+	 * @param[in] normal The normal at the shading point.
+	 * @param[in] light The light.
+	 * @return The probability, 0 for lights left out of the tree.
+	 */
+	float getPMF(const Point& point, const Direction& normal, const int light) const;
+
+	/**
+	 * @brief Checks whether the tree has any light.
+	 *
+	 * @return True if no light can be sampled.
+	 */
+	bool empty() const
+	{
+		return this->nodes.empty() && this->infinite_count == 0;
+	}
+
+	/**
+	 * @brief Gets the probability that sample picks one of the infinite lights rather than descending the tree.
+	 *
+	 * @return The probability, 0 without infinite lights.
+	 */
+	float getInfiniteProbability() const;
+
+	/* The nodes of the tree in depth first order. */
+	std::vector<LightTreeNode> nodes;
+
+	/* The path from the root to the leaf of every light, bit i is set if the second child is taken at depth i. */
+	std::vector<uint64_t> bit_trails;
+
+	/* The number of infinite lights, the last lights of bit_trails. */
+	int infinite_count{0};
+
+	/* The power of every infinite light, weighed against the power of the tree root when sampling. */
+	std::vector<float> infinite_powers;
+
+private:
+	/**
+	 * @brief Sums the power of the infinite lights.
+	 *
+	 * @return The total power of the infinite lights.
+	 */
+	float getInfinitePower() const;
+
+	/**
+	 * @brief Builds the subtree over a range of lights.
+	 *
+	 * @param[in,out] lights The light indices and bounds, the range is partitioned by the split.
+	 * @param[in] start The first light of the range.
+	 * @param[in] end The end of the range.
+	 * @param[in] bit_trail The path from the root to the subtree.
+	 * @param[in] depth The depth of the subtree.
+	 * @return The bounds of the subtree.
+	 */
+	LightBounds buildTree(std::vector<std::pair<int, LightBounds>>& lights, const int start, const int end,
+						  const uint64_t bit_trail, const int depth);
+};
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <alias_table.h>
+#include <bvh.h>
+#include <geometry_cache.h>
+#include <object.h>
+#include <ray.h>
+#include <ray_packet.h>
+#include <triangle_record.h>
+#include <wide_bvh.h>
+
+/**
+ * @class PathTracingMesh
+ * @brief The triangles of a mesh and their BVHs in object space, shared by every object that instances the mesh.
+ *
+ * A mesh only finds which triangle a ray hits; the objects referencing it transform rays into object space and turn
+ * the hit into an intersection result with their own transform and material.
+ */
+class PathTracingMesh
+{
+public:
+	/**
+	 * @brief Default constructor for PathTracingMesh.
+	 */
+	PathTracingMesh() = default;
+
+	/**
+	 * @brief Takes the vertices and indices of an object and builds the intersection records of its triangles.
+	 *
+	 * @param[in,out] object The object, its vertices and indices are moved from.
+	 */
+	PathTracingMesh(Object& object);
+
+	/**
+	 * @brief Initializes the BVH structure for the mesh.
+	 *
+	 * The triangles are reordered so those of every leaf are stored next to each other, which keeps the triangles a
+	 * ray visits in few cache lines and, for out-of-core meshes, in few file pages.
+	 *
+	 * @param[in] builder The builder and its settings used for the mesh BVH.
+	 */
+	void initBVH(const BVHBuilder& builder = BVHBuilder{});
+
+	/**
+	 * @brief Replaces the vertices of the mesh, for example with the next frame of an animation.
+	 *
+	 * The triangle records follow the new positions, the BVHs keep the old bounds until refit is called.
+	 *
+	 * @param[in] vertices The vertices in the order of the object the mesh was built from.
+	 */
+	void setVertices(const std::vector<Vertex>& vertices);
+
+	/**
+	 * @brief Recomputes the bounds and areas of the BVH nodes bottom-up after the vertices moved.
+	 *
+	 * The tree topology is kept, so refitting is linear in the number of nodes, but the SAH cost grows when triangles
+	 * move far from where they were when the tree was built; it is compared with build_sah_cost to decide on a
+	 * rebuild.
+	 *
+	 * @param[in] builder The builder settings the SAH cost is computed with.
+	 */
+	void refit(const BVHBuilder& builder = BVHBuilder{});
+
+	/**
+	 * @brief Builds the table sample picks triangles from by area.
+	 *
+	 * Only the meshes of lights are sampled, so the table is built for them alone; initBVH and refit keep a built
+	 * table up to date.
+	 */
+	void initTriangleTable();
+
+	/**
+	 * @brief Gets the intersection record of a triangle, from memory or from the geometry cache of an out-of-core mesh.
+	 *
+	 * @param[in] index The index of the triangle.
+	 * @return The record, for an out-of-core mesh valid until the thread reads other geometry of the cache.
+	 */
+	const TriangleRecord& getTriangle(const int index) const
+	{
+		return this->geometry_cache == nullptr
+				   ? this->triangles[index]
+				   : this->geometry_cache->get<TriangleRecord>(this->geometry_triangles, index);
+	}
+
+	/**
+	 * @brief Gets a corner vertex of a triangle for shading.
+	 *
+	 * @param[in] index The index of the triangle.
+	 * @param[in] corner The corner of the triangle, 0, 1 or 2.
+	 * @return A copy of the vertex.
+	 */
+	Vertex getVertex(const int index, const int corner) const
+	{
+		if (this->geometry_cache == nullptr)
+		{
+			return this->vertices[this->indices[3 * index + corner]];
+		}
+		Index vertex = this->geometry_cache->get<Index>(this->geometry_indices, 3 * index + corner);
+		return this->geometry_cache->get<Vertex>(this->geometry_vertices, vertex);
+	}
+
+	/**
+	 * @brief Gets the number of triangles.
+	 *
+	 * @return The number of triangles.
+	 */
+	int getTriangleCount() const
+	{
+		return this->geometry_cache == nullptr ? int(this->triangles.size())
+											   : this->geometry_cache->getCount(this->geometry_triangles);
+	}
+
+	/**
+	 * @brief Finds the closest triangle hit of a ray using the wide BVH.
+	 *
+	 * @param[in,out] ray The ray in object space, ray.t is shortened to the closest hit.
+	 * @param[out] hit The barycentric coordinates and distance of the closest hit.
+	 * @return The index of the hit triangle, or -1 if no triangle is hit closer than ray.t.
+	 */
+	int intersect(Ray& ray, float hit[4]) const;
+
+	/**
+	 * @brief Tests whether a ray hits any triangle of this mesh before a distance, without computing hit attributes.
+	 *
+	 * @param[in] ray The ray in object space.
+	 * @param[in] t_max The maximum hit distance.
+	 * @return True if any triangle is hit closer than t_max.
+	 */
+	bool occluded(const Ray& ray, const float t_max) const;
+
+	/**
+	 * @brief Finds the closest triangle hit of every active lane of a ray packet.
+	 *
+	 * @param[in,out] packet The rays in object space, packet.t of every hit lane is shortened to its closest hit.
+	 * @param[in] mask The active lanes.
+	 * @param[in,out] hit Receives the barycentric coordinates and triangle index of the lanes that hit.
+	 * @return The mask of the lanes that hit this mesh closer than their t.
+	 */
+	int intersect8(RayPacket& packet, const int mask, PacketHit& hit) const;
+
+	/**
+	 * @brief Samples a point on the surface of the mesh, uniformly by area, after initTriangleTable was called.
+	 *
+	 * @param[out] result The intersection result storing the sampled point and the normal of its triangle.
+	 * @param[out] pdf The probability density function (PDF) value of the sample with respect to area.
+	 * @param[in] u A uniform sample in [0, 1) selecting the triangle.
+	 * @param[in] u_point A uniform two-dimensional sample in [0, 1)^2 selecting the point on the triangle.
+	 * @return The index of the sampled triangle.
+	 */
+	int sample(IntersectResult& result, float& pdf, const float u, const Vector2f& u_point) const;
+
+	/* The vertices of the mesh, read when a hit is shaded. */
+	std::vector<Vertex> vertices;
+
+	/* The three vertex indices of every triangle. */
+	std::vector<Index> indices;
+
+	/* The BVH tree of the mesh, the wide BVH is collapsed from it. */
+	std::vector<BVH> bvh;
+
+	/* The intersection records of the triangles, the shading data is read from vertices through indices. */
+	std::vector<TriangleRecord> triangles;
+
+	/* The indices of the triangles, every BVH leaf references a range of it. */
+	std::vector<int> triangle_indices;
+
+	/* The SAH cost of the mesh BVH. */
+	float sah_cost = 0.0f;
+
+	/* The SAH cost of the mesh BVH right after its last full build. */
+	float build_sah_cost = 0.0f;
+
+	/* The position in vertices of every vertex of the source object, -1 for vertices no triangle uses. */
+	std::vector<Index> vertex_index;
+
+	/* The alias table over the triangle areas, empty unless the mesh is sampled as a light. */
+	AliasTable triangle_table;
+
+	/* The wide BVH of the mesh, used for ray intersection. */
+	WideBVH<BVH_WIDTH> wide_bvh;
+
+	/* The bounding box of the mesh in object space. */
+	BoundingBox bounding_box{};
+
+	/* The total surface area of the mesh in object space. */
+	float area = 0.0f;
+
+	/* The geometry cache holding the triangles, indices and vertices of an out-of-core mesh, nullptr if they are in
+	   memory. */
+	const GeometryCache* geometry_cache{nullptr};
+
+	/* The arrays of the triangle records, indices and vertices of an out-of-core mesh in the geometry cache. */
+	int geometry_triangles{-1}, geometry_indices{-1}, geometry_vertices{-1};
+};
@@ -1,13 +1,18 @@
 #pragma once
 
-#include <bvh.h>
-#include <object.h>
+#include <memory>
+
+#include <light_tree.h>
 #include <path_tracing_material.h>
-#include <ray.h>
+#include <path_tracing_mesh.h>
 
 /**
  * @class PathTracingObject
- * @brief Represents a geometric object in the scene.
+ * @brief Represents an instance of a mesh in the scene, placed by the model matrix of the object.
+ *
+ * Rays are transformed into the object space of the mesh with an unnormalized direction, so hit distances along the
+ * world ray and the object space ray are the same and the mesh BVH is traversed as is. Objects with an identity model
+ * matrix skip the transform.
  */
 class PathTracingObject : public Object
 {
@@ -16,60 +21,175 @@ public:
 	 * @brief Default constructor for PathTracingObject.
 	 */
 	PathTracingObject() = default;
-	PathTracingObject(Object& object);
 
 	/**
-	 * @brief Initializes the BVH structure for the object.
+	 * @brief Places a mesh in the scene with the name, model matrix and light of an object.
+	 *
+	 * The world space bounding box and area are computed from the mesh. The area is exact for lights, which are
+	 * sampled by area; other objects scale the area of the mesh by the average area scale of the model matrix, so
+	 * placing an instance does not visit its triangles.
+	 *
+	 * @param[in] object The object, its vertices and indices are not read.
+	 * @param[in] geometry The mesh the object instances, built from the vertices of the object or of the object it
+	 * shares them with.
+	 */
+	PathTracingObject(const Object& object, std::shared_ptr<PathTracingMesh> geometry);
+
+	/**
+	 * @brief Moves the object to a new model matrix and recomputes its world space bounding box and area.
+	 *
+	 * Also called with the current model matrix after the vertices of the mesh changed.
+	 *
+	 * @param[in] model The new model matrix.
+	 */
+	void setModel(const Matrix4f& model);
+
+	/**
+	 * @brief Gets the intersection record of a triangle of the mesh, in object space.
+	 *
+	 * @param[in] index The index of the triangle.
+	 * @return The record, for an out-of-core mesh valid until the thread reads other geometry of the cache.
+	 */
+	const TriangleRecord& getTriangle(const int index) const
+	{
+		return this->geometry->getTriangle(index);
+	}
+
+	/**
+	 * @brief Gets a corner vertex of a triangle of the mesh for shading, in object space.
+	 *
+	 * @param[in] index The index of the triangle.
+	 * @param[in] corner The corner of the triangle, 0, 1 or 2.
+	 * @return A copy of the vertex.
 	 */
-	void initBVH();
+	Vertex getVertex(const int index, const int corner) const
+	{
+		return this->geometry->getVertex(index, corner);
+	}
 
 	/**
-	 * @brief Builds the BVH tree for this object.
+	 * @brief Gets the number of triangles of the mesh.
 	 *
-	 * @param[in] index The index of the BVH node.
-	 * @param[in,out] triangles The list of triangles belonging to this object.
-	 * @param[in] bounding_box The bounding box enclosing the triangles.
+	 * @return The number of triangles.
 	 */
-	void buildBVH(const int index, std::vector<Triangle>& triangles, const BoundingBox& bounding_box);
+	int getTriangleCount() const
+	{
+		return this->geometry->getTriangleCount();
+	}
 
 	/**
-	 * @brief Computes the intersection between a ray and this object.
+	 * @brief Computes the intersection between a ray and this object using the wide BVH of the mesh.
 	 *
-	 * @param[in,out] ray The ray to be tested for intersection.
+	 * @param[in,out] ray The ray to be tested for intersection, ray.t is shortened to the closest hit.
 	 * @return The intersection result containing intersection details.
 	 */
 	IntersectResult intersect(Ray& ray) const;
 
 	/**
-	 * @brief Traverses the BVH structure to find ray intersections.
+	 * @brief Tests whether a ray hits any triangle of this object before a distance, without computing hit attributes.
+	 *
+	 * @param[in] ray The ray to test.
+	 * @param[in] t_max The maximum hit distance.
+	 * @return True if any triangle is hit closer than t_max.
+	 */
+	bool occluded(const Ray& ray, const float t_max) const;
+
+	/**
+	 * @brief Finds the closest triangle hit of every active lane of a ray packet.
+	 *
+	 * @param[in,out] packet The rays to test, packet.t of every hit lane is shortened to its closest hit.
+	 * @param[in] mask The active lanes.
+	 * @param[in,out] hit Receives the barycentric coordinates and triangle index of the lanes that hit.
+	 * @return The mask of the lanes that hit this object closer than their t.
+	 */
+	int intersect8(RayPacket& packet, const int mask, PacketHit& hit) const;
+
+	/**
+	 * @brief Fills an intersection result from a triangle hit, interpolating the vertices of the triangle.
 	 *
-	 * @param[in] index The index of the BVH node to traverse.
-	 * @param[in,out] ray The ray to test for intersection.
-	 * @return The intersection result.
+	 * @param[in] ray The world space ray that hit the triangle.
+	 * @param[in] index The index of the triangle that was hit.
+	 * @param[in] hit The barycentric coordinates and distance returned by Ray::intersectTriangle.
+	 * @return The intersection result in world space.
 	 */
-	IntersectResult traverse(const int index, Ray& ray) const;
+	IntersectResult getIntersectResult(const Ray& ray, const int index, const float hit[4]) const;
 
 	/**
 	 * @brief Samples a point on the surface of a light-emitting object.
 	 *
 	 * @param[out] result The intersection result storing the sampled point.
-	 * @param[out] pdf The probability density function (PDF) value of the sample.
+	 * @param[out] pdf The probability density function (PDF) value of the sample with respect to world space area.
+	 * @param[in] u A uniform sample in [0, 1) selecting the triangle.
+	 * @param[in] u_point A uniform two-dimensional sample in [0, 1)^2 selecting the point on the triangle.
 	 */
-	void sample(IntersectResult& result, float& pdf);
+	void sample(IntersectResult& result, float& pdf, const float u, const Vector2f& u_point) const;
 
 	/**
-	 * @brief Traverses the BVH structure to sample a point on the object.
+	 * @brief Gets the area and geometric normal of a triangle in world space, as sampleTriangle sees them.
 	 *
-	 * @param[in] index The BVH node index.
-	 * @param[in] p A random parameter for sampling.
-	 * @param[out] result The intersection result storing the sampled point.
-	 * @param[out] pdf The probability density function (PDF) value of the sample.
+	 * @param[in] index The index of the triangle.
+	 * @param[out] normal The geometric normal of the triangle.
+	 * @return The area of the triangle.
+	 */
+	float getTriangleArea(const int index, Direction& normal) const;
+
+	/**
+	 * @brief Samples a point on one triangle of a light-emitting object, uniformly by area.
+	 *
+	 * @param[in] index The index of the triangle.
+	 * @param[out] result The intersection result storing the sampled point and the normal of the triangle.
+	 * @param[out] pdf The probability density function (PDF) value of the sample with respect to world space area.
+	 * @param[in] u_point A uniform two-dimensional sample in [0, 1)^2 selecting the point on the triangle.
+	 */
+	void sampleTriangle(const int index, IntersectResult& result, float& pdf, const Vector2f& u_point) const;
+
+	/**
+	 * @brief Bounds one triangle of a light-emitting object in world space for the light tree.
+	 *
+	 * The triangle emits the radiance of the object from its front side, its power is pi times the luminance of the
+	 * radiance times its area.
+	 *
+	 * @param[in] index The index of the triangle.
+	 * @return The bounds of the triangle.
 	 */
-	void traverse(const int index, float p, IntersectResult& result, float& pdf);
+	LightBounds getLightBounds(const int index) const;
+
+	/* The mesh of the object, shared with the other instances of the same mesh. */
+	std::shared_ptr<PathTracingMesh> geometry;
+
+	/* The index of the mesh among the distinct meshes of the scene. */
+	int mesh_index{-1};
 
-	/* The BVH tree of the object. */
-	std::vector<BVH> bvh;
+	/* Whether the model matrix is not the identity, rays are then transformed into object space. */
+	bool transformed{false};
+
+	/* The inverse of the model matrix, transforming world space rays into object space. */
+	Matrix4f inverse_model{1};
+
+	/* The inverse transpose of the model matrix, transforming object space normals into world space. */
+	Matrix3f normal_model{1};
 
 	/* The material of the object. */
 	PathTracingMaterial material;
-};
\ No newline at end of file
+
+	/* The index of the compiled material in the scene bsdfs, shared by the objects with the same material_index. */
+	int bsdf_index{-1};
+
+private:
+	/**
+	 * @brief Transforms a world space ray into object space, keeping its distance.
+	 *
+	 * @param[in] ray The world space ray.
+	 * @return The object space ray with an unnormalized direction.
+	 */
+	Ray toObject(const Ray& ray) const;
+
+	/**
+	 * @brief Transforms the active lanes of a world space ray packet into object space.
+	 *
+	 * @param[in] packet The world space rays.
+	 * @param[in] mask The active lanes.
+	 * @return The object space rays.
+	 */
+	RayPacket toObject(const RayPacket& packet, const int mask) const;
+};
@@ -1,11 +1,74 @@
 ﻿#pragma once
 
+#include <memory>
+
+#include <alias_table.h>
+#include <bsdf.h>
 #include <bvh.h>
+#include <geometry_cache.h>
+#include <light_tree.h>
+#include <wide_bvh.h>
 #include <path_tracing_material.h>
 #include <path_tracing_object.h>
+#include <ray_packet.h>
+#include <sampler.h>
 #include <scene.h>
 #include <utils.h>
 
+/**
+ * @enum LightSamplerType
+ * @brief How sampleLight picks the light a shading point is connected to.
+ */
+enum class LightSamplerType
+{
+	/* Lights are picked by emitted power alone, the same for every shading point. */
+	Power,
+
+	/* Emissive triangles and point lights are picked through the light tree by their importance to the point,
+	   directional lights beside it by their power. */
+	Tree
+};
+
+/**
+ * @struct LightEmitter
+ * @brief A light of the light tree, an emissive triangle of a light object, a point light or a directional light.
+ */
+struct LightEmitter
+{
+	/* The light object of an emissive triangle, -1 for a point light and -2 for a directional light. */
+	int object_index{-1};
+
+	/* The triangle in the mesh of the object, or the index of the point light or directional light. */
+	int index{0};
+};
+
+/**
+ * @struct LightSample
+ * @brief A point on a light sampled for a shading point, with what the point receives from it.
+ */
+struct LightSample
+{
+	/* The sampled point on the light, for a directional light one unit from the shading point towards it. */
+	Point point{0.0f};
+
+	/* The unit direction from the shading point to the sampled point. */
+	Direction direction{0.0f};
+
+	/* The distance from the shading point to the sampled point, infinite for a directional light. */
+	float distance{0.0f};
+
+	/* The radiance arriving from the sampled point, for a point light its intensity over the squared distance and for
+	   a directional light its irradiance. */
+	Vector3f radiance{0.0f};
+
+	/* The density of the direction with respect to solid angle, for point and directional lights the probability of
+	   picking them; 0 if nothing was sampled. */
+	float pdf{0.0f};
+
+	/* The light object of the sample, -1 for point and directional lights. */
+	int object_index{-1};
+};
+
 /**
  * @class PathTracingScene
  * @brief Represents a 3D scene containing objects, a camera, and lighting.
@@ -24,28 +87,131 @@ public:
 
 	/**
 	 * @brief Initializes the BVH structure for the scene.
+	 *
+	 * The BVH of every distinct mesh is built once, the scene BVH is the top level over the objects instancing them.
 	 */
 	void initBVH();
 
 	/**
-	 * @brief Builds the BVH tree for the scene.
+	 * @brief Rebuilds the scene BVH over the objects, keeping the BVHs of the meshes.
 	 *
-	 * @param[in] index The index of the BVH node.
-	 * @param[in,out] object_index The list of object indices in the scene.
-	 * @param[in] bounding_box The bounding box enclosing the objects.
+	 * Used when only the objects moved; the mesh BVHs are in object space and stay valid.
 	 */
-	void buildBVH(const int index, std::vector<int>& object_index, const BoundingBox& bounding_box);
+	void rebuildTopLevel();
 
 	/**
-	 * @brief Performs a ray-scene intersection test.
+	 * @brief Builds the light tree and the alias tables sampleLight picks lights and their triangles from.
 	 *
-	 * @param[in,out] ray The ray to test for intersection.
+	 * The alias tables pick light objects, point lights and directional lights by emitted power, the luminance of the
+	 * radiance, intensity or irradiance times the area, sphere or scene disk of emission, and triangles by area. The
+	 * light tree bounds every emissive triangle in world space and every point light, directional lights are its
+	 * infinite lights. Called after the scene BVH is built, whose bounds give the scene disk.
+	 */
+	void initLightSampling();
+
+	/**
+	 * @brief Finds the position of every light object in light_object_index and its first triangle in light_emitters.
+	 *
+	 * Called by initLightSampling, and after loading the light sampling structures from a scene cache.
+	 */
+	void initLightLookup();
+
+	/**
+	 * @brief Compiles the material of every object into bsdfs, one block per scene material.
+	 *
+	 * Called by initBVH, and after loading a scene cache.
+	 */
+	void initMaterials();
+
+	/**
+	 * @brief Moves an object, the BVHs are updated by the next call of updateBVH.
+	 *
+	 * @param[in] object The index of the object.
+	 * @param[in] model The new model matrix of the object.
+	 */
+	void setTransform(const int object, const Matrix4f& model);
+
+	/**
+	 * @brief Replaces the vertices of a mesh, the BVHs are updated by the next call of updateBVH.
+	 *
+	 * @param[in] mesh The index of the mesh.
+	 * @param[in] vertices The vertices in the order of the object the mesh was built from.
+	 */
+	void setVertices(const int mesh, const std::vector<Vertex>& vertices);
+
+	/**
+	 * @brief Updates the BVHs after setTransform and setVertices calls, e.g. once per animation frame.
+	 *
+	 * The BVHs of the changed meshes are refit and the objects instancing them get new bounds. Moved objects rebuild
+	 * the scene BVH, which is cheap as it only bins the objects; otherwise it is refit as well. A refit BVH whose SAH
+	 * cost grew past rebuild_threshold times its cost after the last full build is rebuilt.
+	 */
+	void updateBVH();
+
+	/**
+	 * @brief Computes the SAH cost of the scene BVH including the BVHs of the objects in its leaves.
+	 *
+	 * @return The SAH cost in units of one ray-box test.
+	 */
+	float getSAHCost() const;
+
+	/**
+	 * @brief Prints the node counts and SAH cost of the BVHs.
+	 */
+	void outputBVHStatistics() const;
+
+	/**
+	 * @brief Performs a ray-scene intersection test using the wide BVHs.
+	 *
+	 * @param[in,out] ray The ray to test for intersection, ray.t is shortened to the closest hit.
 	 * @return The intersection result.
 	 */
 	IntersectResult intersect(Ray& ray) const;
 
 	/**
-	 * @brief Traverses the BVH tree to find ray intersections.
+	 * @brief Tests whether anything blocks a ray before a distance, e.g. a shadow ray towards a light sample.
+	 *
+	 * Traversal of the scene and object BVHs stops at the first hit and no hit attributes are computed.
+	 *
+	 * @param[in] ray The ray to test.
+	 * @param[in] t_max The maximum hit distance.
+	 * @return True if any object is hit closer than t_max.
+	 */
+	bool occluded(const Ray& ray, const float t_max) const;
+
+	/**
+	 * @brief Finds the closest hits of a packet of rays traced together.
+	 *
+	 * @param[in,out] rays The rays to test, ray.t of every hit ray is shortened to its closest hit.
+	 * @param[out] results The intersection result of every ray, inactive lanes are left unchanged.
+	 * @param[in] mask The active lanes, bit i selects rays[i].
+	 */
+	void intersect8(Ray rays[PACKET_SIZE], IntersectResult results[PACKET_SIZE], const int mask = PACKET_FULL_MASK) const;
+
+	/**
+	 * @brief Finds the closest hits of a stream of rays, traced as packets of rays with the same direction octant.
+	 *
+	 * @param[in,out] rays The rays to test, ray.t of every hit ray is shortened to its closest hit.
+	 * @param[out] results The intersection result of every ray.
+	 * @param[in,out] order Scratch space for the packet order, kept by the caller so repeated calls do not allocate.
+	 */
+	void intersect(std::vector<Ray>& rays, std::vector<IntersectResult>& results, std::vector<int>& order) const;
+
+	/**
+	 * @brief Tests a stream of rays for any hit closer than their ray.t, e.g. shadow rays towards light samples.
+	 *
+	 * The rays are traced one at a time, shadow rays towards sampled light points are too incoherent for packets to
+	 * pay off.
+	 *
+	 * @param[in] rays The rays to test.
+	 * @param[out] occluded 1 for every occluded ray, 0 otherwise.
+	 */
+	void occluded(const std::vector<Ray>& rays, std::vector<uint8_t>& occluded) const;
+
+	/**
+	 * @brief Traverses the binary BVH trees recursively to find ray intersections.
+	 *
+	 * This is the reference traversal the wide BVH is measured against.
 	 *
 	 * @param[in] index The BVH node index.
 	 * @param[in,out] ray The ray to test for intersection.
@@ -54,20 +220,48 @@ public:
 	IntersectResult traverse(const int index, Ray& ray) const;
 
 	/**
-	 * @brief Samples a point on a light-emitting object in the scene.
+	 * @brief Samples a point on a light for a shading point, with the sampler selected by light_sampler_type.
+	 *
+	 * Points on the back of an emissive triangle receive nothing from it and are not sampled.
+	 *
+	 * @param[out] sample The light sample, its pdf is 0 if no light was sampled.
+	 * @param[in] point The shading point.
+	 * @param[in] normal The normal at the shading point.
+	 * @param[in] u A uniform sample in [0, 1) selecting the light source.
+	 * @param[in] u_point A uniform two-dimensional sample in [0, 1)^2 selecting the point on the light source.
+	 */
+	void sampleLight(LightSample& sample, const Point& point, const Direction& normal, const float u,
+					 const Vector2f& u_point) const;
+
+	/**
+	 * @brief Gets the density with which sampleLight samples a point found on a light by a ray from a shading point.
 	 *
-	 * @param[out] result The intersection result storing the sampled point.
-	 * @param[out] pdf The probability density function (PDF) value of the sample.
+	 * @param[in] point The shading point.
+	 * @param[in] normal The normal at the shading point.
+	 * @param[in] light The intersection of the ray with the light object.
+	 * @return The density with respect to solid angle, 0 if sampleLight cannot sample the point.
 	 */
-	void sampleLight(IntersectResult& result, float& pdf);
+	float getLightPDF(const Point& point, const Direction& normal, const IntersectResult& light) const;
 
 	/**
 	 * @brief Computes the shading for a given ray using path tracing.
 	 *
 	 * @param[in] ray The ray being traced.
+	 * @param[in,out] sampler The sampler of the current pixel sample.
 	 * @return The computed radiance at the ray intersection.
 	 */
-	Vector3f shader(Ray ray);
+	Vector3f shader(Ray ray, Sampler& sampler);
+
+	/**
+	 * @brief Computes the shading for a given ray whose first intersection is already known.
+	 *
+	 * @param[in] ray The ray being traced.
+	 * @param[in] result The intersection of the ray with the scene, e.g. found by a packet query.
+	 * @param[in,out] sampler The sampler of the current pixel sample.
+	 * @param[out] path_length The number of path segments traced, including the given one.
+	 * @return The computed radiance at the ray intersection.
+	 */
+	Vector3f shader(Ray ray, IntersectResult result, Sampler& sampler, int& path_length);
 
 	/**
 	 * @brief Sets the ambient light intensity for the scene.
@@ -79,12 +273,90 @@ public:
 	/* The BVH tree for the scene. */
 	std::vector<SceneBVH> bvh;
 
-	/* The list of objects present in the scene. */
+	/* The wide BVH over the objects of the scene, used for ray intersection. */
+	WideBVH<BVH_WIDTH> wide_bvh;
+
+	/* The builder settings used for the mesh BVHs. */
+	BVHBuilder bvh_builder;
+
+	/* The SAH cost growth relative to the last full build at which updateBVH rebuilds a refit BVH. */
+	float rebuild_threshold = 1.5f;
+
+	/* The SAH cost of the scene BVH right after the last rebuild of the top level. */
+	float build_sah_cost = 0.0f;
+
+	/* The number of BVHs updateBVH refit and rebuilt, mesh and scene BVHs alike. */
+	int refit_count = 0, rebuild_count = 0;
+
+	/* The list of objects present in the scene, instances of the meshes. */
 	std::vector<PathTracingObject> objects;
 
+	/* The distinct meshes of the scene, every object references one of them by its mesh_index. */
+	std::vector<std::shared_ptr<PathTracingMesh>> meshes;
+
 	/* Indices of objects that function as light sources. */
 	std::vector<int> light_object_index;
 
+	/* The alias table over light_object_index followed by the point lights and the directional lights, weighted by
+	   emitted power. */
+	AliasTable light_table;
+
+	/* The light tree over light_emitters. */
+	LightTree light_tree;
+
+	/* The lights of the light tree, the emissive triangles of the light objects followed by the point lights and the
+	   directional lights. */
+	std::vector<LightEmitter> light_emitters;
+
+	/* The position of every object in light_object_index and of its first triangle in light_emitters, -1 for objects
+	   that emit no light. */
+	std::vector<int> light_index;
+	std::vector<int> light_emitter_offset;
+
+	/* The compiled materials, every object reads its own through its bsdf_index. */
+	std::vector<BSDFParameters> bsdfs;
+
+	/* The sampler sampleLight picks lights with, the light tree pays off for scenes with many emitters. */
+	LightSamplerType light_sampler_type{LightSamplerType::Power};
+
 	/* The maximum recursion depth for path tracing. */
 	int max_depth = 10;
+
+	/* The number of bounces after which paths are terminated by Russian roulette, larger than max_depth disables it. */
+	int russian_roulette_depth = 3;
+
+	/* The triangles of the meshes of an out-of-core scene, nullptr if all triangles are in memory. */
+	std::shared_ptr<GeometryCache> geometry_cache;
+
+private:
+	/* The meshes whose vertices changed and whether objects moved since the last BVH update. */
+	std::vector<int> modified_meshes;
+	bool moved_objects{false};
 };
+
+/* Upper bound of the Russian roulette survival probability, so bright paths are still terminated eventually. */
+constexpr float RUSSIAN_ROULETTE_MAX_SURVIVAL = 0.95f;
+
+/**
+ * @brief Gets the probability that Russian roulette continues a path.
+ *
+ * @param[in] throughput The product of the BSDF weights along the path.
+ * @return The largest throughput component, clamped to RUSSIAN_ROULETTE_MAX_SURVIVAL.
+ */
+inline float getSurvivalProbability(const Vector3f& throughput)
+{
+	return std::min(std::max(throughput.x, std::max(throughput.y, throughput.z)), RUSSIAN_ROULETTE_MAX_SURVIVAL);
+}
+
+/**
+ * @brief Weights a sample of one of two strategies by the power heuristic of multiple importance sampling.
+ *
+ * @param[in] pdf The density of the strategy the sample was drawn with.
+ * @param[in] other_pdf The density of the other strategy for the same sample.
+ * @return The weight of the sample, the weights of both strategies sum to one.
+ */
+inline float powerHeuristic(const float pdf, const float other_pdf)
+{
+	float square = pdf * pdf;
+	return square / (square + other_pdf * other_pdf);
+}
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <bounding_box.h>
-#include <triangle.h>
+#include <triangle_record.h>
 #include <utils.h>
 
 /**
@@ -39,7 +39,7 @@ public:
 	 * @param[out] result Array to store intersection details (e.g., barycentric coordinates, distance).
 	 * @return True if the ray intersects the triangle, false otherwise.
 	 */
-	bool intersectTriangle(const Triangle& triangle, float result[4]) const;
+	bool intersectTriangle(const TriangleRecord& triangle, float result[4]) const;
 
 	/**
 	 * @brief Checks if the ray intersects an axis-aligned bounding box (AABB).
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <ray.h>
+#include <simd.h>
+
+/* Number of rays traced together in a packet. */
+constexpr int PACKET_SIZE = 8;
+
+/* Lane mask with all rays of a packet active. */
+constexpr int PACKET_FULL_MASK = (1 << PACKET_SIZE) - 1;
+
+/**
+ * @brief Counts the lanes set in a lane mask.
+ *
+ * @param[in] mask The lane mask.
+ * @return The number of set lanes.
+ */
+inline int countLanes(int mask)
+{
+	int count = 0;
+	for (; mask != 0; mask &= mask - 1)
+	{
+		count++;
+	}
+	return count;
+}
+
+/**
+ * @struct PacketHit
+ * @brief The closest triangle hit of every lane of a ray packet.
+ */
+struct alignas(32) PacketHit
+{
+	/* The barycentric coordinates b0, b1, b2 of the hit. */
+	float barycentric[3][PACKET_SIZE];
+
+	/* The index of the hit triangle in its object. */
+	int primitive[PACKET_SIZE];
+
+	/* The index of the hit object in the scene. */
+	int object[PACKET_SIZE];
+};
+
+/**
+ * @class RayPacket
+ * @brief A packet of rays stored as structure of arrays, one SIMD lane per ray.
+ *
+ * Lanes are selected by bit masks, bit i stands for the ray in lane i. The triangle test processes the lanes with SSE
+ * or AVX and returns the mask of the lanes that hit, the box tests live in WideBVH.
+ */
+class alignas(32) RayPacket
+{
+public:
+	/**
+	 * @brief Default constructor for RayPacket.
+	 */
+	RayPacket() = default;
+
+	/**
+	 * @brief Stores a ray in a lane.
+	 *
+	 * @param[in] lane The lane index.
+	 * @param[in] ray The ray, ray.t becomes the maximum hit distance of the lane.
+	 */
+	void setRay(const int lane, const Ray& ray);
+
+	/**
+	 * @brief Reads the ray of a lane back, including its current hit distance.
+	 *
+	 * @param[in] lane The lane index.
+	 * @return The ray of the lane.
+	 */
+	Ray getRay(const int lane) const;
+
+	/**
+	 * @brief Finds the direction octant shared by the active lanes.
+	 *
+	 * @param[in] mask The active lanes.
+	 * @return Bit i is set if the direction is negative along axis i, or -1 if the lanes do not share an octant.
+	 */
+	int getOctant(const int mask) const;
+
+	/**
+	 * @brief Selects the active lanes whose current t is not closer than a distance.
+	 *
+	 * @param[in] t The distance, e.g. the smallest entry distance of a node.
+	 * @param[in] mask The active lanes.
+	 * @return The lanes of the mask that can still hit something at distance t or beyond.
+	 */
+	int getLanesBeyond(const float t, const int mask) const
+	{
+		int result = 0;
+		for (int lane = 0; lane < PACKET_SIZE; lane++)
+		{
+			result |= (this->t[lane] >= t ? 1 : 0) << lane;
+		}
+		return result & mask;
+	}
+
+	/**
+	 * @brief Moller Trumbore test of the active lanes against one triangle, back faces are culled.
+	 *
+	 * @param[in] triangle The triangle to test.
+	 * @param[in] mask The active lanes.
+	 * @param[out] hit The barycentric coordinates b0, b1, b2 and the distance of every lane that hit.
+	 * @return The mask of the lanes that hit the triangle closer than their current t.
+	 */
+	int intersectTriangle(const TriangleRecord& triangle, const int mask, float hit[4][PACKET_SIZE]) const;
+
+	/* The ray origins. */
+	float origin[3][PACKET_SIZE];
+
+	/* The normalized ray directions. */
+	float direction[3][PACKET_SIZE];
+
+	/* The reciprocal ray directions used by the slab test. */
+	float inverse_direction[3][PACKET_SIZE];
+
+	/* The maximum hit distance of every lane, shortened to the closest hit found so far. */
+	float t[PACKET_SIZE];
+};
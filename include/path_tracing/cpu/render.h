@@ -1,7 +1,98 @@
 #pragma once
 
+#include <checkpoint.h>
+#include <distributed.h>
 #include <path_tracing_scene.h>
+#include <sampler.h>
+#include <tile_scheduler.h>
 #include <utils.h>
+#include <wavefront.h>
+
+/**
+ * @enum IntegratorType
+ * @brief Defines how the CPU renderer traces its paths.
+ */
+enum class IntegratorType
+{
+	Megakernel, /* Every path is traced to completion by PathTracingScene::shader. */
+	Wavefront	/* All paths of a tile advance together, stage by stage, in a WavefrontIntegrator. */
+};
+
+/**
+ * @struct PixelEstimate
+ * @brief The running mean and variance of the samples of one pixel, updated with Welford's algorithm.
+ */
+struct PixelEstimate
+{
+	/**
+	 * @brief Adds a sample to the estimate.
+	 *
+	 * @param[in] color The radiance of the sample.
+	 */
+	void add(const Vector3f& color)
+	{
+		float luminance = getLuminance(color);
+		this->count++;
+		this->mean += (color - this->mean) / float(this->count);
+
+		float delta = luminance - this->mean_luminance;
+		this->mean_luminance += delta / float(this->count);
+		this->m2 += delta * (luminance - this->mean_luminance);
+	}
+
+	/**
+	 * @brief Estimates how far one standard error of the mean moves the pixel in the saved image.
+	 *
+	 * The standard error of the linear luminance is mapped through the clamping and gamma of the saved image, so
+	 * dark pixels need a smaller linear error and pixels brighter than white converge at once.
+	 *
+	 * @return The displayed error in [0, 1].
+	 */
+	float getError() const
+	{
+		if (this->count < 2)
+		{
+			return std::numeric_limits<float>::infinity();
+		}
+		float variance = this->m2 / float(this->count - 1);
+		float error = std::sqrt(variance / float(this->count));
+		return getDisplayValue(this->mean_luminance + error) - getDisplayValue(this->mean_luminance);
+	}
+
+	/**
+	 * @brief Computes the luminance of a linear RGB color.
+	 *
+	 * @param[in] color The color.
+	 * @return The Rec. 709 luminance.
+	 */
+	static float getLuminance(const Vector3f& color)
+	{
+		return 0.2126f * color.x + 0.7152f * color.y + 0.0722f * color.z;
+	}
+
+	/**
+	 * @brief Maps a linear value to the range written to the image, clamped and gamma corrected like saveResult.
+	 *
+	 * @param[in] value The linear value.
+	 * @return The displayed value in [0, 1].
+	 */
+	static float getDisplayValue(const float value)
+	{
+		return std::pow(std::min(std::max(value, 0.0f), 1.0f), 1.0f / 2.2f);
+	}
+
+	/* The number of samples taken. */
+	int count{0};
+
+	/* The mean radiance of the samples. */
+	Vector3f mean{0.0f};
+
+	/* The mean luminance of the samples. */
+	float mean_luminance{0.0f};
+
+	/* The sum of squared luminance differences from the mean. */
+	float m2{0.0f};
+};
 
 /**
  * @class Renderer
@@ -29,10 +120,210 @@ public:
 	 */
 	void render(PathTracingScene& scene);
 
-	/* Number of samples per pixel (spp), used for anti-aliasing. */
+	/**
+	 * @brief Renders the given scene with worker processes and saves the result.
+	 *
+	 * The coordinator only needs the camera of the scene, the workers load the scene themselves and receive the spp,
+	 * sampler, frame and depth settings of this renderer.
+	 *
+	 * @param[in] scene The scene to be rendered.
+	 * @param[in] port The TCP port the workers connect to.
+	 */
+	void renderCoordinator(const PathTracingScene& scene, const int port);
+
+	/**
+	 * @brief Connects to a coordinator and renders the tasks it hands out until the render is finished.
+	 *
+	 * @param[in,out] scene The scene to be rendered, loaded by the worker process.
+	 * @param[in] host The host name or address of the coordinator.
+	 * @param[in] port The TCP port of the coordinator.
+	 */
+	void renderWorker(PathTracingScene& scene, const std::string& host, const int port);
+
+	/* Number of samples per pixel (spp), used for anti-aliasing. The upper limit per pixel with adaptive sampling. */
 	int spp = 1;
 
+	/* Flag enabling adaptive sampling, which renders in passes and only samples pixels that have not converged. */
+	bool adaptive_sampling{false};
+
+	/* Samples every pixel takes in the first pass, later passes double the samples of the unconverged pixels. */
+	int adaptive_pass_spp = 16;
+
+	/* Standard error of the displayed pixel luminance, in [0, 1], below which a pixel is converged. */
+	float adaptive_threshold = 0.02f;
+
+	/* Wall-clock time in seconds after which adaptive rendering starts no further tile and progressive rendering no
+	   further pass, 0 for no limit. */
+	float time_budget = 0.0f;
+
+	/* Flag enabling progressive rendering, which accumulates passes until every pixel has spp samples. */
+	bool progressive{false};
+
+	/* Samples every pixel takes in one progressive pass. */
+	int progressive_pass_spp = 1;
+
+	/* Seconds between the checkpoints of a progressive render, 0 writes one after every pass. */
+	float checkpoint_interval = 300.0f;
+
+	/* Flag indicating whether a progressive render continues from the checkpoint of an earlier run. */
+	bool resume{false};
+
+	/* The checkpoint file of a progressive render, empty for results/<scene>_checkpoint_cpu.bin. */
+	std::string checkpoint_path;
+
+	/* Samples per distributed task, 0 renders all samples of a tile in one task. */
+	int distributed_task_spp = 0;
+
+	/* Seconds a distributed worker has to return a task before the task is handed to another worker, it has to exceed
+	   the time one task takes. */
+	int distributed_task_timeout = 300;
+
+	/* Index of the frame being rendered, mixed into the random seed of every sample. */
+	int frame = 0;
+
+	/* The sample generator used for pixel, light and BSDF samples. */
+	SamplerType sampler_type = SamplerType::Sobol;
+
+	/* The integrator used to trace the paths. */
+	IntegratorType integrator_type = IntegratorType::Megakernel;
+
+	/* The most paths the wavefront integrator traces as one wave, tiles with more samples are traced in chunks. */
+	int max_wave_size = 1 << 16;
+
+	/* Edge length in pixels of the square tiles handed to the render threads. */
+	int tile_size = 32;
+
+	/* Flag indicating whether tile and thread statistics are printed after rendering. */
+	bool output_statistics{true};
+
 protected:
+	/**
+	 * @brief Computes the image plane of the camera used to generate primary rays.
+	 *
+	 * @param[in] camera The camera of the scene.
+	 */
+	void setCamera(const Camera& camera);
+
+	/**
+	 * @brief Renders all pixels of one tile into the frame buffer.
+	 *
+	 * @param[in,out] scene The scene to be rendered.
+	 * @param[in] tile The tile to render.
+	 * @param[in,out] sampler The sampler owned by the calling thread.
+	 * @return The number of path segments traced, used for the average path length.
+	 */
+	uint64_t renderTile(PathTracingScene& scene, const Tile& tile, Sampler& sampler);
+
+	/**
+	 * @brief Renders all samples of all pixels of one tile as waves of paths.
+	 *
+	 * Every wave traces a range of samples of all pixels of the tile, as many as fit in max_wave_size paths but at
+	 * least one, so the path state does not grow with the sample count.
+	 *
+	 * @param[in,out] scene The scene to be rendered.
+	 * @param[in] tile The tile to render.
+	 * @param[in,out] sampler The sampler owned by the calling thread.
+	 * @param[in,out] integrator The wavefront integrator owned by the calling thread.
+	 * @return The number of path segments traced, used for the average path length.
+	 */
+	uint64_t renderTileWavefront(PathTracingScene& scene,
+								 const Tile& tile,
+								 Sampler& sampler,
+								 WavefrontIntegrator& integrator);
+
+	/**
+	 * @brief Renders the scene in passes until all pixels converge, reach spp samples or the time budget runs out.
+	 *
+	 * @param[in,out] scene The scene to be rendered.
+	 */
+	void renderAdaptive(PathTracingScene& scene);
+
+	/**
+	 * @brief Adds samples to the active pixels of one tile.
+	 *
+	 * @param[in,out] scene The scene to be rendered.
+	 * @param[in] tile The tile to render.
+	 * @param[in,out] sampler The sampler owned by the calling thread.
+	 * @param[in] samples The smallest number of samples added to an active pixel.
+	 */
+	void renderTileAdaptive(PathTracingScene& scene, const Tile& tile, Sampler& sampler, const int samples);
+
+	/**
+	 * @brief Marks the pixels that need more samples after a pass of adaptive sampling.
+	 *
+	 * @param[in] width The image width in pixels.
+	 * @param[in] height The image height in pixels.
+	 * @return The number of active pixels.
+	 */
+	int updateActivePixels(const int width, const int height);
+
+	/**
+	 * @brief Accumulates passes into the HDR accumulation buffer, writing checkpoints and the image as it goes.
+	 *
+	 * @param[in,out] scene The scene to be rendered.
+	 */
+	void renderProgressive(PathTracingScene& scene);
+
+	/**
+	 * @brief Adds samples to every pixel of one tile of a progressive render.
+	 *
+	 * @param[in,out] scene The scene to be rendered.
+	 * @param[in] tile The tile to render.
+	 * @param[in,out] sampler The sampler owned by the calling thread.
+	 * @param[in] samples The number of samples added to every pixel, pixels stop at spp samples.
+	 */
+	void renderTileProgressive(PathTracingScene& scene, const Tile& tile, Sampler& sampler, const int samples);
+
+	/**
+	 * @brief Renders a range of samples of every pixel of one tile with all threads.
+	 *
+	 * @param[in,out] scene The scene to be rendered.
+	 * @param[in] tile The tile to render.
+	 * @param[in] sample_begin The first sample index.
+	 * @param[in] sample_end One past the last sample index.
+	 * @param[in] sampler The sampler cloned by every thread.
+	 * @param[out] radiance The sum of the samples of every pixel, stored row by row.
+	 */
+	void renderTileSamples(PathTracingScene& scene,
+						   const Tile& tile,
+						   const int sample_begin,
+						   const int sample_end,
+						   const Sampler& sampler,
+						   std::vector<Vector3f>& radiance);
+
+	/**
+	 * @brief Gets the checkpoint file of a progressive render.
+	 *
+	 * @param[in] scene The scene to be rendered.
+	 * @return The checkpoint path.
+	 */
+	std::string getCheckpointPath(const PathTracingScene& scene) const;
+
+	/**
+	 * @brief Saves the HDR accumulation buffer of a progressive render as a Radiance HDR image.
+	 *
+	 * @param[in] scene The scene whose rendering result is saved.
+	 */
+	void saveHDRResult(const PathTracingScene& scene);
+
+	/**
+	 * @brief Saves an image of the number of samples every pixel received, from blue for few to red for spp.
+	 *
+	 * @param[in] scene The rendered scene.
+	 */
+	void saveSampleHeatmap(const PathTracingScene& scene);
+
+	/**
+	 * @brief Starts a pixel sample and generates its jittered camera ray.
+	 *
+	 * @param[in] x The pixel column.
+	 * @param[in] y The pixel row.
+	 * @param[in] index The sample index within the pixel.
+	 * @param[in,out] sampler The sampler, left positioned after the dimensions used by the camera ray.
+	 * @return The camera ray.
+	 */
+	Ray generateCameraRay(const int x, const int y, const int index, Sampler& sampler) const;
+
 	/**
 	 * @brief Saves the rendered image result.
 	 *
@@ -43,4 +334,25 @@ protected:
 private:
 	/* Frame buffer storing the computed pixel colors. */
 	std::vector<Vector3f> frame_buffer;
+
+	/* The running estimate of every pixel during adaptive sampling. */
+	std::vector<PixelEstimate> pixel_estimates;
+
+	/* 1 for every pixel that takes samples in the next pass of adaptive sampling. */
+	std::vector<uint8_t> pixel_active;
+
+	/* The accumulation buffer, sample counts and progress of a progressive render. */
+	RenderCheckpoint checkpoint;
+
+	/* The camera position of the current render. */
+	Point eye_position;
+
+	/* The center of the top-left pixel on the image plane. */
+	Point pixel_origin;
+
+	/* The offset between horizontally adjacent pixel centers. */
+	Vector3f pixel_step_x;
+
+	/* The offset between vertically adjacent pixel centers. */
+	Vector3f pixel_step_y;
 };
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <memory>
+
+#include <random_generator.h>
+#include <utils.h>
+
+/* Edge length of the tiled blue-noise mask used to dither the BlueNoise sampler. */
+constexpr int BLUE_NOISE_SIZE = 64;
+
+/**
+ * @enum SamplerType
+ * @brief Defines the sample generators available to the path tracer.
+ */
+enum class SamplerType
+{
+	Independent, /* Uniform random numbers, every dimension independent. */
+	Stratified,	 /* Jittered strata per dimension, shuffled between dimensions. */
+	Sobol,		 /* Owen-scrambled Sobol points, padded pairwise across dimensions. */
+	BlueNoise	 /* One Owen-scrambled Sobol sequence, rotated per pixel by a blue-noise mask. */
+};
+
+/**
+ * @struct SamplerState
+ * @brief The position of a sampler within one pixel sample.
+ *
+ * Saving and restoring the state lets one sampler serve many paths that are advanced in turns, each path continuing
+ * with exactly the dimensions it would have drawn if it had been traced alone.
+ */
+struct SamplerState
+{
+	/* The pixel of the sample. */
+	Vector2i pixel{0, 0};
+
+	/* The index of the sample within the pixel. */
+	int sample_index{0};
+
+	/* The next dimension to be generated. */
+	int dimension{0};
+
+	/* The random number generator of the sample. */
+	RandomGenerator random;
+};
+
+/**
+ * @class Sampler
+ * @brief Generates the sample values consumed by the integrator.
+ *
+ * The integrator asks for one- and two-dimensional samples in a fixed order (pixel jitter, then per bounce the
+ * light pick, the light point and the BSDF direction). Every request advances the dimension, so each decision of a
+ * path draws from its own well-distributed dimension instead of sharing one random stream.
+ */
+class Sampler
+{
+public:
+	/**
+	 * @brief Constructs a sampler for a given sample count.
+	 *
+	 * @param[in] samples_per_pixel The number of samples that will be taken per pixel.
+	 * @param[in] seed A seed that decorrelates different renders or frames.
+	 */
+	Sampler(const int samples_per_pixel, const uint64_t seed);
+
+	virtual ~Sampler() = default;
+
+	/**
+	 * @brief Prepares the sampler for one sample of one pixel and resets the dimension.
+	 *
+	 * @param[in] pixel The pixel coordinates.
+	 * @param[in] index The index of the sample within the pixel.
+	 */
+	virtual void startPixelSample(const Vector2i& pixel, const int index);
+
+	/**
+	 * @brief Gets the next one-dimensional sample in [0, 1).
+	 *
+	 * @return The sample value.
+	 */
+	virtual float get1D() = 0;
+
+	/**
+	 * @brief Gets the next two-dimensional sample in [0, 1)^2.
+	 *
+	 * @return The sample value.
+	 */
+	virtual Vector2f get2D() = 0;
+
+	/**
+	 * @brief Creates an independent copy of the sampler, used to give every thread its own instance.
+	 *
+	 * @return The copied sampler.
+	 */
+	virtual std::unique_ptr<Sampler> clone() const = 0;
+
+	/**
+	 * @brief Gets the current pixel sample and dimension of the sampler.
+	 *
+	 * @return The sampler state.
+	 */
+	SamplerState getState() const;
+
+	/**
+	 * @brief Continues a pixel sample from a previously saved state.
+	 *
+	 * @param[in] state The sampler state.
+	 */
+	void setState(const SamplerState& state);
+
+	/* The number of samples that will be taken per pixel. */
+	int samples_per_pixel;
+
+	/* The seed of the sampler. */
+	uint64_t seed;
+
+protected:
+	/**
+	 * @brief Gets a hash identifying the current pixel and dimension.
+	 *
+	 * @return The hash value.
+	 */
+	uint64_t getDimensionHash() const;
+
+	/* The pixel of the current sample. */
+	Vector2i pixel{0, 0};
+
+	/* The index of the current sample within the pixel. */
+	int sample_index{0};
+
+	/* The next dimension to be generated. */
+	int dimension{0};
+
+	/* The random number generator of the current sample. */
+	RandomGenerator random;
+};
+
+/**
+ * @class IndependentSampler
+ * @brief A sampler that returns independent uniform random numbers.
+ */
+class IndependentSampler : public Sampler
+{
+public:
+	using Sampler::Sampler;
+
+	float get1D() override;
+
+	Vector2f get2D() override;
+
+	std::unique_ptr<Sampler> clone() const override;
+};
+
+/**
+ * @class StratifiedSampler
+ * @brief A sampler that jitters samples inside shuffled strata.
+ *
+ * Two-dimensional samples use a jittered grid if the sample count is a square number and Latin hypercube strata
+ * otherwise.
+ */
+class StratifiedSampler : public Sampler
+{
+public:
+	using Sampler::Sampler;
+
+	float get1D() override;
+
+	Vector2f get2D() override;
+
+	std::unique_ptr<Sampler> clone() const override;
+};
+
+/**
+ * @class SobolSampler
+ * @brief A sampler producing Owen-scrambled Sobol points.
+ *
+ * Every dimension pair uses the first two Sobol dimensions with its own shuffled sample index and its own nested
+ * uniform scramble, which keeps the (0, 2)-sequence properties without needing high-dimensional direction numbers.
+ */
+class SobolSampler : public Sampler
+{
+public:
+	using Sampler::Sampler;
+
+	float get1D() override;
+
+	Vector2f get2D() override;
+
+	std::unique_ptr<Sampler> clone() const override;
+};
+
+/**
+ * @class BlueNoiseSampler
+ * @brief A Sobol sampler that shares one point set between pixels and rotates it by a blue-noise mask.
+ *
+ * Neighbouring pixels receive decorrelated but evenly spread offsets, so the remaining error is pushed into high
+ * screen-space frequencies where it is far less visible and easier to filter.
+ */
+class BlueNoiseSampler : public Sampler
+{
+public:
+	using Sampler::Sampler;
+
+	float get1D() override;
+
+	Vector2f get2D() override;
+
+	std::unique_ptr<Sampler> clone() const override;
+
+protected:
+	/**
+	 * @brief Looks up the blue-noise offset of the current pixel for a dimension.
+	 *
+	 * @param[in] dimension The dimension of the sample.
+	 * @return The offset in [0, 1).
+	 */
+	float getOffset(const int dimension) const;
+};
+
+/**
+ * @brief Creates a sampler of a given type.
+ *
+ * @param[in] type The type of sampler.
+ * @param[in] samples_per_pixel The number of samples that will be taken per pixel.
+ * @param[in] seed A seed that decorrelates different renders or frames.
+ * @return The created sampler.
+ */
+std::unique_ptr<Sampler> createSampler(const SamplerType type, const int samples_per_pixel, const uint64_t seed);
+
+/**
+ * @brief Gets the tiled blue-noise mask, generated with the void-and-cluster method on first use.
+ *
+ * @return BLUE_NOISE_SIZE * BLUE_NOISE_SIZE values in [0, 1), stored row by row.
+ */
+const std::vector<float>& getBlueNoiseMask();
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <path_tracing_scene.h>
+#include <utils.h>
+
+/**
+ * @class MappedFile
+ * @brief A read-only memory mapping of a whole file.
+ *
+ * Pages are read from disk when they are first touched, so reading a mapped file costs page faults instead of
+ * buffered copies through the C++ streams.
+ */
+class MappedFile
+{
+public:
+	/**
+	 * @brief Default constructor for MappedFile.
+	 */
+	MappedFile() = default;
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/**
+	 * @brief Unmaps the file.
+	 */
+	~MappedFile();
+
+	/**
+	 * @brief Maps a file into memory.
+	 *
+	 * @param[in] path The path of the file.
+	 * @return True if the file exists and was mapped.
+	 */
+	bool open(const std::string& path);
+
+	/**
+	 * @brief Unmaps the file.
+	 */
+	void close();
+
+	/**
+	 * @brief Gets the mapped bytes.
+	 *
+	 * @return The first byte of the file, nullptr if no file or an empty file is mapped.
+	 */
+	const char* data() const;
+
+	/**
+	 * @brief Gets the file size.
+	 *
+	 * @return The size of the mapped file in bytes.
+	 */
+	size_t size() const;
+
+private:
+	/* The first mapped byte. */
+	const char* address{nullptr};
+
+	/* The size of the mapping in bytes. */
+	size_t length{0};
+
+	/* The file mapping object on Windows, unused elsewhere. */
+	void* mapping{nullptr};
+};
+
+/**
+ * @brief Hashes the contents of source files, so a cache built from them can detect any change.
+ *
+ * Missing files hash differently from empty ones.
+ *
+ * @param[in] paths The paths of the source files.
+ * @return The combined 64-bit hash of the paths and contents of all files.
+ */
+uint64_t hashSourceFiles(const std::vector<std::string>& paths);
+
+/**
+ * @brief Writes a scene with its prebuilt BVHs to a binary cache file.
+ *
+ * The file stores the vertices, indices and triangle records, the materials, the decoded textures and the binary
+ * and wide BVHs of the scene and of every distinct mesh, which the objects instancing it reference by index. Arrays
+ * start at 64-byte aligned offsets. loadSceneCache copies them out of a memory mapping of the file, the mapping is only
+ * a fast read source and the loaded scene never points into it. The file is written to a temporary file first and
+ * renamed over the target.
+ *
+ * @param[in] path The path of the cache file.
+ * @param[in] scene The scene after PathTracingScene::initBVH.
+ * @param[in] sources The files the scene was loaded from; the paths of the scene textures are added to them.
+ * @return True if the cache was written.
+ */
+bool saveSceneCache(const std::string& path, const PathTracingScene& scene, const std::vector<std::string>& sources);
+
+/**
+ * @brief Loads a scene with its prebuilt BVHs from a binary cache file written by saveSceneCache.
+ *
+ * The cache is rejected if its version or data layout differs from this build, if it was built with other BVH
+ * builder settings than scene.bvh_builder, or if any of its source files changed since it was written. Every index
+ * read from the file, of the BVH children and primitives, the mesh vertices, the alias tables, the lights and the
+ * materials, is range-checked before the scene is used, and a cache with one out of range is rejected as well.
+ *
+ * With a geometry cache size the scene is loaded out of core: the triangle records, indices and vertices of the
+ * meshes stay in the file and are read through a GeometryCache that keeps at most that many bytes of them resident,
+ * everything else, including the BVHs, is loaded into memory.
+ *
+ * @param[in] path The path of the cache file.
+ * @param[in,out] scene The scene to load into, its bvh_builder settings are compared with those of the cache.
+ * @param[in] geometry_cache_size The resident geometry bytes of an out-of-core scene, 0 loads all geometry.
+ * @return True if the cache was valid and the scene was loaded, the scene is left unchanged otherwise.
+ */
+bool loadSceneCache(const std::string& path, PathTracingScene& scene, const size_t geometry_cache_size = 0);
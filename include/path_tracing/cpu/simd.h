@@ -0,0 +1,179 @@
+#pragma once
+
+/*
+ * Thin wrappers over the SSE and AVX float vectors used by the BVH and ray packet code. SIMDFloat holds SIMD_WIDTH
+ * floats, comparisons return lane masks as SIMDFloat with all bits set in the selected lanes.
+ */
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PATH_TRACING_SSE
+#include <immintrin.h>
+#endif
+
+#if defined(__AVX2__)
+
+using SIMDFloat = __m256;
+constexpr int SIMD_WIDTH = 8;
+
+inline SIMDFloat simdLoad(const float* data)
+{
+	return _mm256_load_ps(data);
+}
+
+inline void simdStore(float* data, const SIMDFloat a)
+{
+	_mm256_store_ps(data, a);
+}
+
+inline SIMDFloat simdSet(const float a)
+{
+	return _mm256_set1_ps(a);
+}
+
+inline SIMDFloat simdAdd(const SIMDFloat a, const SIMDFloat b)
+{
+	return _mm256_add_ps(a, b);
+}
+
+inline SIMDFloat simdSub(const SIMDFloat a, const SIMDFloat b)
+{
+	return _mm256_sub_ps(a, b);
+}
+
+inline SIMDFloat simdMul(const SIMDFloat a, const SIMDFloat b)
+{
+	return _mm256_mul_ps(a, b);
+}
+
+inline SIMDFloat simdDiv(const SIMDFloat a, const SIMDFloat b)
+{
+	return _mm256_div_ps(a, b);
+}
+
+/* Returns b in the lanes where a or b is NaN */
+inline SIMDFloat simdMin(const SIMDFloat a, const SIMDFloat b)
+{
+	return _mm256_min_ps(a, b);
+}
+
+/* Returns b in the lanes where a or b is NaN */
+inline SIMDFloat simdMax(const SIMDFloat a, const SIMDFloat b)
+{
+	return _mm256_max_ps(a, b);
+}
+
+inline SIMDFloat simdLess(const SIMDFloat a, const SIMDFloat b)
+{
+	return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+}
+
+inline SIMDFloat simdLessEqual(const SIMDFloat a, const SIMDFloat b)
+{
+	return _mm256_cmp_ps(a, b, _CMP_LE_OQ);
+}
+
+inline SIMDFloat simdGreater(const SIMDFloat a, const SIMDFloat b)
+{
+	return _mm256_cmp_ps(a, b, _CMP_GT_OQ);
+}
+
+inline SIMDFloat simdOr(const SIMDFloat a, const SIMDFloat b)
+{
+	return _mm256_or_ps(a, b);
+}
+
+/* Selects a where the mask is set and b elsewhere */
+inline SIMDFloat simdSelect(const SIMDFloat mask, const SIMDFloat a, const SIMDFloat b)
+{
+	return _mm256_blendv_ps(b, a, mask);
+}
+
+inline int simdMask(const SIMDFloat mask)
+{
+	return _mm256_movemask_ps(mask);
+}
+
+#elif defined(PATH_TRACING_SSE)
+
+using SIMDFloat = __m128;
+constexpr int SIMD_WIDTH = 4;
+
+inline SIMDFloat simdLoad(const float* data)
+{
+	return _mm_load_ps(data);
+}
+
+inline void simdStore(float* data, const SIMDFloat a)
+{
+	_mm_store_ps(data, a);
+}
+
+inline SIMDFloat simdSet(const float a)
+{
+	return _mm_set1_ps(a);
+}
+
+inline SIMDFloat simdAdd(const SIMDFloat a, const SIMDFloat b)
+{
+	return _mm_add_ps(a, b);
+}
+
+inline SIMDFloat simdSub(const SIMDFloat a, const SIMDFloat b)
+{
+	return _mm_sub_ps(a, b);
+}
+
+inline SIMDFloat simdMul(const SIMDFloat a, const SIMDFloat b)
+{
+	return _mm_mul_ps(a, b);
+}
+
+inline SIMDFloat simdDiv(const SIMDFloat a, const SIMDFloat b)
+{
+	return _mm_div_ps(a, b);
+}
+
+/* Returns b in the lanes where a or b is NaN */
+inline SIMDFloat simdMin(const SIMDFloat a, const SIMDFloat b)
+{
+	return _mm_min_ps(a, b);
+}
+
+/* Returns b in the lanes where a or b is NaN */
+inline SIMDFloat simdMax(const SIMDFloat a, const SIMDFloat b)
+{
+	return _mm_max_ps(a, b);
+}
+
+inline SIMDFloat simdLess(const SIMDFloat a, const SIMDFloat b)
+{
+	return _mm_cmplt_ps(a, b);
+}
+
+inline SIMDFloat simdLessEqual(const SIMDFloat a, const SIMDFloat b)
+{
+	return _mm_cmple_ps(a, b);
+}
+
+inline SIMDFloat simdGreater(const SIMDFloat a, const SIMDFloat b)
+{
+	return _mm_cmpgt_ps(a, b);
+}
+
+inline SIMDFloat simdOr(const SIMDFloat a, const SIMDFloat b)
+{
+	return _mm_or_ps(a, b);
+}
+
+/* Selects a where the mask is set and b elsewhere */
+inline SIMDFloat simdSelect(const SIMDFloat mask, const SIMDFloat a, const SIMDFloat b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+inline int simdMask(const SIMDFloat mask)
+{
+	return _mm_movemask_ps(mask);
+}
+
+#endif
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include <utils.h>
+
+/**
+ * @struct Tile
+ * @brief A rectangular block of pixels rendered as one unit of work.
+ */
+struct Tile
+{
+	/* The index of the tile in the image. */
+	int index{0};
+
+	/* The first pixel column of the tile. */
+	int x_begin{0};
+
+	/* The first pixel row of the tile. */
+	int y_begin{0};
+
+	/* One past the last pixel column of the tile. */
+	int x_end{0};
+
+	/* One past the last pixel row of the tile. */
+	int y_end{0};
+};
+
+/**
+ * @struct ThreadStatistics
+ * @brief Work counters gathered for one render thread.
+ */
+struct ThreadStatistics
+{
+	/* Number of tiles rendered by this thread. */
+	int tiles{0};
+
+	/* Number of tiles this thread stole from other queues. */
+	int stolen{0};
+
+	/* Time spent rendering tiles. */
+	std::chrono::steady_clock::duration busy{0};
+};
+
+/**
+ * @class TileScheduler
+ * @brief Splits an image into tiles and hands them to threads through work-stealing queues.
+ *
+ * Each thread owns a queue that is seeded with a contiguous run of tiles. A thread takes work from the front of its
+ * own queue and, once it is empty, steals from the back of the other queues, so threads that drew cheap tiles keep
+ * helping until the whole image is done.
+ */
+class TileScheduler
+{
+public:
+	/**
+	 * @brief Default constructor for TileScheduler.
+	 */
+	TileScheduler() = default;
+
+	/**
+	 * @brief Splits the image into tiles and distributes them over the thread queues.
+	 *
+	 * @param[in] width The image width in pixels.
+	 * @param[in] height The image height in pixels.
+	 * @param[in] tile_size The edge length of a square tile in pixels.
+	 * @param[in] thread_count The number of threads that will request tiles.
+	 */
+	void init(const int width, const int height, const int tile_size, const int thread_count);
+
+	/**
+	 * @brief Fetches the next tile for a thread, stealing from other threads when its own queue is empty.
+	 *
+	 * @param[in] thread The index of the requesting thread.
+	 * @param[out] tile The tile to render.
+	 * @return True if a tile was returned, false once all tiles have been handed out.
+	 */
+	bool next(const int thread, Tile& tile);
+
+	/**
+	 * @brief Records that a thread finished a tile.
+	 *
+	 * @param[in] thread The index of the thread.
+	 * @param[in] duration The time the thread spent on the tile.
+	 */
+	void finish(const int thread, const std::chrono::steady_clock::duration duration);
+
+	/**
+	 * @brief Gets the fraction of tiles that have been finished.
+	 *
+	 * @return The progress between 0.0 and 1.0.
+	 */
+	float getProgress() const;
+
+	/**
+	 * @brief Prints tiles per second and the utilization of every thread.
+	 *
+	 * @param[in] duration The wall-clock time of the whole render.
+	 */
+	void outputStatistics(const std::chrono::steady_clock::duration duration) const;
+
+	/* The per-thread counters, valid after rendering. */
+	std::vector<ThreadStatistics> statistics;
+
+private:
+	/**
+	 * @struct WorkQueue
+	 * @brief A tile queue owned by one thread.
+	 */
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<Tile> tiles;
+	};
+
+	/* The work queues, one per thread. */
+	std::vector<std::unique_ptr<WorkQueue>> queues;
+
+	/* The total number of tiles in the image. */
+	int tile_count{0};
+
+	/* The number of tiles that have been finished. */
+	std::atomic<int> finished{0};
+};
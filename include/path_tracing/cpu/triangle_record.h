@@ -0,0 +1,60 @@
+#pragma once
+
+#include <bounding_box.h>
+#include <utils.h>
+#include <vertex.h>
+
+/**
+ * @class TriangleRecord
+ * @brief The 48 bytes of a triangle needed to intersect and sample it, stored apart from its shading vertices.
+ *
+ * The corners are the vertex, vertex + edge1 and vertex + edge2, so a record holds no vertex attributes; the normal,
+ * texture coordinates and color of the corners are read from the vertices of the object when a hit is shaded.
+ */
+class TriangleRecord
+{
+public:
+	/** Default constructor for a triangle record. */
+	TriangleRecord() = default;
+
+	/**
+	 * @brief Constructs the record of a triangle with three vertices.
+	 *
+	 * @param[in] vertex1 The first vertex of the triangle.
+	 * @param[in] vertex2 The second vertex of the triangle.
+	 * @param[in] vertex3 The third vertex of the triangle.
+	 */
+	TriangleRecord(const Vertex& vertex1, const Vertex& vertex2, const Vertex& vertex3);
+
+	/**
+	 * @brief Computes the bounding box of the triangle.
+	 *
+	 * @return The bounding box that contains the triangle.
+	 */
+	BoundingBox getBoundingBox() const;
+
+	/**
+	 * @brief Computes the area of the triangle.
+	 *
+	 * @return The area of the triangle.
+	 */
+	float getArea() const;
+
+	/**
+	 * @brief Samples a point on the triangle and computes its PDF (Probability Density Function).
+	 *
+	 * @param[out] result The sampled point on the triangle.
+	 * @param[out] pdf The PDF of the sampled point.
+	 * @param[in] u A uniform two-dimensional sample in [0, 1)^2.
+	 */
+	void sample(Point& result, float& pdf, const Vector2f& u) const;
+
+	/* The position of the first vertex. */
+	Point vertex;
+
+	/* The edges from the first vertex to the second and the third vertex. */
+	Direction edge1, edge2;
+
+	/* The geometric normal, facing the side of the vertex normals. */
+	Direction normal;
+};
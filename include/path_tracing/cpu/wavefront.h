@@ -0,0 +1,178 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+
+#include <path_tracing_scene.h>
+#include <sampler.h>
+#include <utils.h>
+
+/**
+ * @enum WavefrontStage
+ * @brief Defines the stages a wave of paths passes through, used to index the stage timings.
+ */
+enum class WavefrontStage
+{
+	Generate,	/* Camera rays are generated for every path. */
+	Extend,		/* The closest hits of all path rays are found. */
+	Shade,		/* The hits are shaded per material and the next rays are sampled. */
+	Connect,	/* The shadow rays towards light samples are traced. */
+	Accumulate, /* The path radiance is added to the frame buffer. */
+	Count		/* Number of stages. */
+};
+
+/**
+ * @class WavefrontIntegrator
+ * @brief Traces a wave of paths stage by stage instead of one path at a time.
+ *
+ * The state of every path lives in its own array indexed by path (structure of arrays). Each bounce first finds the
+ * closest hits of all live paths as one ray stream, then shades the hits in one queue per material, and finally
+ * traces all shadow rays of the bounce as one stream of any-hit queries. Paths carry their sampler state, so every
+ * path draws the same sample dimensions as in PathTracingScene::shader and the images match.
+ */
+class WavefrontIntegrator
+{
+public:
+	/**
+	 * @brief Default constructor for WavefrontIntegrator.
+	 */
+	WavefrontIntegrator() = default;
+
+	/**
+	 * @brief Removes all paths of the previous wave, keeping the allocated memory.
+	 */
+	void clear();
+
+	/**
+	 * @brief Adds a path starting with a camera ray.
+	 *
+	 * @param[in] ray The camera ray.
+	 * @param[in] pixel The index of the pixel in the frame buffer.
+	 * @param[in] sampler The sampler positioned after the dimensions used by the camera ray.
+	 */
+	void addPath(const Ray& ray, const int pixel, const Sampler& sampler);
+
+	/**
+	 * @brief Traces all paths of the wave until they leave the scene, hit a light or exceed the maximum depth.
+	 *
+	 * @param[in,out] scene The scene to be rendered.
+	 * @param[in,out] sampler The sampler of the calling thread, used for every path in turn.
+	 * @return The number of path segments traced.
+	 */
+	uint64_t trace(PathTracingScene& scene, Sampler& sampler);
+
+	/**
+	 * @brief Adds the weighted radiance of every path to its pixel, in the order the paths were added.
+	 *
+	 * @param[in,out] frame_buffer The frame buffer.
+	 * @param[in] weight The weight of one path, e.g. one over the samples per pixel.
+	 */
+	void accumulate(std::vector<Vector3f>& frame_buffer, const float weight);
+
+	/**
+	 * @brief Adds the stage timings of another integrator, e.g. of another render thread.
+	 *
+	 * @param[in] other The other integrator.
+	 */
+	void addStageTimes(const WavefrontIntegrator& other);
+
+	/**
+	 * @brief Prints the time spent in every stage.
+	 */
+	void outputStatistics() const;
+
+	/* The time spent in every stage, indexed by WavefrontStage. */
+	std::array<std::chrono::steady_clock::duration, size_t(WavefrontStage::Count)> stage_time{};
+
+private:
+	/**
+	 * @brief Finds the closest hits of the ray queue.
+	 *
+	 * @param[in] scene The scene.
+	 */
+	void extend(const PathTracingScene& scene);
+
+	/**
+	 * @brief Terminates the paths that missed or hit a light and sorts the others into the material queues.
+	 *
+	 * @param[in] scene The scene.
+	 */
+	void sortHits(const PathTracingScene& scene);
+
+	/**
+	 * @brief Samples a light point and the next direction for every hit in a material queue.
+	 *
+	 * The hits of a queue share their BSDF parameters, and the kernels of the material type are called directly.
+	 *
+	 * @tparam type The material type of the queue.
+	 * @param[in,out] scene The scene.
+	 * @param[in,out] sampler The sampler, restored from and saved back to the state of every path.
+	 * @param[in] material The compiled material of the queue, an index into the scene bsdfs.
+	 * @param[in] depth The number of bounces before the hits, used for Russian roulette.
+	 */
+	template <MaterialType type>
+	void shade(PathTracingScene& scene, Sampler& sampler, const int material, const int depth);
+
+	/**
+	 * @brief Traces the shadow queue and adds the contribution of every unoccluded light sample.
+	 *
+	 * @param[in] scene The scene.
+	 */
+	void connect(const PathTracingScene& scene);
+
+	/* ========== Path state, indexed by path ========== */
+
+	/* The product of the BSDF weights along the path. */
+	std::vector<Vector3f> throughput;
+
+	/* The radiance gathered by the path. */
+	std::vector<Vector3f> radiance;
+
+	/* The density the BSDF sampled the next ray with, 0 for camera rays and after specular vertices. */
+	std::vector<float> bsdf_pdf;
+
+	/* The point and normal the next ray leaves from, light hits are weighted against light samples taken there. */
+	std::vector<Point> previous_point;
+	std::vector<Direction> previous_normal;
+
+	/* The index of the pixel of the path in the frame buffer. */
+	std::vector<int> pixel;
+
+	/* The sampler state of the path. */
+	std::vector<SamplerState> sampler_state;
+
+	/* ========== Ray queue, indexed by queue entry ========== */
+
+	/* The path of every ray. */
+	std::vector<int> ray_path;
+
+	/* The rays of the live paths. */
+	std::vector<Ray> rays;
+
+	/* The closest hit of every ray. */
+	std::vector<IntersectResult> hits;
+
+	/* The ray queue entries whose hit has the given compiled material, indexed by bsdf_index. */
+	std::vector<std::vector<int>> material_queue;
+
+	/* The path and ray of the next bounce of every path that continues. */
+	std::vector<int> next_ray_path;
+	std::vector<Ray> next_rays;
+
+	/* ========== Shadow queue, indexed by queue entry ========== */
+
+	/* The path of every shadow ray. */
+	std::vector<int> shadow_path;
+
+	/* The shadow rays, ray.t is the distance to the light sample. */
+	std::vector<Ray> shadow_rays;
+
+	/* The radiance added to the path if the shadow ray is unoccluded. */
+	std::vector<Vector3f> shadow_contribution;
+
+	/* 1 for every occluded shadow ray, 0 otherwise. */
+	std::vector<uint8_t> shadow_occluded;
+
+	/* Scratch space of the closest-hit stream query. */
+	std::vector<int> order;
+};
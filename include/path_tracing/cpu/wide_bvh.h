@@ -0,0 +1,627 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+
+#include <bvh.h>
+#include <ray.h>
+#include <ray_packet.h>
+#include <simd.h>
+
+/* Maximum depth of a BVH that can be traversed with the fixed-size node stack. */
+constexpr int MAX_TRAVERSAL_DEPTH = 64;
+
+/* Packets with at most this many active lanes left are traversed one ray at a time. */
+constexpr int SINGLE_RAY_LANES = 3;
+
+/* Number of children per wide BVH node, 8 when the library is built with AVX2 and 4 (SSE) otherwise. */
+#if defined(__AVX2__)
+constexpr int BVH_WIDTH = 8;
+#else
+constexpr int BVH_WIDTH = 4;
+#endif
+
+/**
+ * @struct WideBVHNode
+ * @brief A BVH node with Width children whose bounds are stored as structure of arrays.
+ *
+ * bounds[0..2] hold the minimum x, y and z of every child and bounds[3..5] the maximum, so one SIMD register covers
+ * the same plane of all children. Unused slots have empty bounds and are never hit.
+ */
+template <int Width>
+struct alignas(64) WideBVHNode
+{
+	/* The child bounds, minimum x, y, z followed by maximum x, y, z. */
+	float bounds[6][Width];
+
+	/* Interior child: the index of its node. Leaf child: the first entry in the primitive index array. */
+	int offset[Width];
+
+	/* The number of primitives of a leaf child, 0 for interior children and unused slots. */
+	uint16_t count[Width];
+};
+
+/**
+ * @class WideBVH
+ * @brief A BVH4/BVH8 collapsed from a binary BVH, traversed with SIMD slab tests against all children of a node.
+ *
+ * Every node tests its children at once and pushes the hit ones ordered by entry distance, so the nearest child is
+ * visited first and nodes whose entry lies beyond the closest hit found so far (ray.t) are skipped when popped.
+ */
+template <int Width>
+class WideBVH
+{
+public:
+	/**
+	 * @brief Default constructor for WideBVH.
+	 */
+	WideBVH() = default;
+
+	/**
+	 * @brief Collapses a binary BVH into a wide BVH.
+	 *
+	 * @param[in] nodes The binary BVH nodes, the root is nodes[0].
+	 * @param[in] get_primitives Appends the primitive indices stored in a leaf node to a vector.
+	 */
+	template <typename Node, typename GetPrimitives>
+	void build(const std::vector<Node>& nodes, GetPrimitives get_primitives)
+	{
+		this->nodes.clear();
+		this->primitive_indices.clear();
+		if (nodes.empty())
+		{
+			return;
+		}
+
+		this->nodes.reserve(nodes.size() / (Width - 1) + 1);
+		this->collapse(nodes, 0, get_primitives);
+	}
+
+	/**
+	 * @brief Finds the closest primitive hit along a ray.
+	 *
+	 * @param[in,out] ray The ray to test, ray.t limits the search and has to be shortened by the callback on a hit.
+	 * @param[in] intersect_primitive Tests one primitive index and returns true if it was hit closer than ray.t.
+	 * @return True if any primitive was hit.
+	 */
+	template <typename IntersectPrimitive>
+	bool intersect(Ray& ray, IntersectPrimitive intersect_primitive) const
+	{
+		return this->traverse<false>(0, ray, intersect_primitive);
+	}
+
+	/**
+	 * @brief Tests whether a ray hits any primitive within ray.t, traversal stops at the first hit.
+	 *
+	 * @param[in,out] ray The ray to test, ray.t is the maximum hit distance.
+	 * @param[in] intersect_primitive Tests one primitive index and returns true if it was hit within ray.t.
+	 * @return True if any primitive was hit.
+	 */
+	template <typename IntersectPrimitive>
+	bool occluded(Ray& ray, IntersectPrimitive intersect_primitive) const
+	{
+		return this->traverse<true>(0, ray, intersect_primitive);
+	}
+
+	/**
+	 * @brief Finds the closest primitive hit of every active lane of a ray packet.
+	 *
+	 * @param[in,out] packet The rays to test, the callback has to shorten packet.t of the lanes it hits.
+	 * @param[in] mask The active lanes.
+	 * @param[in] intersect_primitive Tests one primitive index against a lane mask and returns the lanes hit closer
+	 * than their t.
+	 * @return The mask of the lanes that hit any primitive.
+	 */
+	template <typename IntersectPrimitive>
+	int intersect(RayPacket& packet, const int mask, IntersectPrimitive intersect_primitive) const
+	{
+		return this->traversePacket(packet, mask, intersect_primitive);
+	}
+
+	/* The nodes in depth-first order, the root is nodes[0]. */
+	std::vector<WideBVHNode<Width>> nodes;
+
+	/* The primitive indices referenced by the leaves. */
+	std::vector<int> primitive_indices;
+
+private:
+	struct StackEntry
+	{
+		int offset;
+		int count;
+		float t;
+	};
+
+	struct PacketStackEntry
+	{
+		int offset;
+		int count;
+		int mask;
+		float t;
+	};
+
+	/**
+	 * @brief Traverses the subtree below a node with a single ray.
+	 *
+	 * @param[in] root The node to start at.
+	 * @param[in,out] ray The ray to test, ray.t limits the search.
+	 * @param[in] intersect_primitive Tests one primitive index and returns true if it was hit within ray.t.
+	 * @return True if any primitive was hit, in any-hit mode traversal stops at the first one.
+	 */
+	template <bool AnyHit, typename IntersectPrimitive>
+	bool traverse(const int root, Ray& ray, IntersectPrimitive& intersect_primitive) const
+	{
+		if (this->nodes.empty())
+		{
+			return false;
+		}
+
+		Vector3f inverse_direction = 1.0f / ray.direction;
+		int near_plane[3], far_plane[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			near_plane[axis] = inverse_direction[axis] < 0.0f ? axis + 3 : axis;
+			far_plane[axis] = inverse_direction[axis] < 0.0f ? axis : axis + 3;
+		}
+
+		/* Every visited level pushes at most Width entries */
+		StackEntry stack[MAX_TRAVERSAL_DEPTH * Width];
+		int stack_size = 0;
+		stack[stack_size++] = StackEntry{root, 0, 0.0f};
+
+		bool hit = false;
+		while (stack_size > 0)
+		{
+			StackEntry entry = stack[--stack_size];
+			if (entry.t > ray.t)
+			{
+				continue;
+			}
+
+			if (entry.count > 0)
+			{
+				for (int i = 0; i < entry.count; i++)
+				{
+					hit |= intersect_primitive(this->primitive_indices[entry.offset + i]);
+					if (AnyHit && hit)
+					{
+						return true;
+					}
+				}
+				continue;
+			}
+
+			const WideBVHNode<Width>& node = this->nodes[entry.offset];
+			alignas(32) float t_enter[Width];
+			int mask = intersectChildren(node, ray, inverse_direction, near_plane, far_plane, t_enter);
+
+			/* Insert the hit children farthest first, so the nearest one is popped next */
+			int first = stack_size;
+			for (int slot = 0; mask != 0; slot++, mask >>= 1)
+			{
+				if ((mask & 1) == 0)
+				{
+					continue;
+				}
+
+				StackEntry child{node.offset[slot], node.count[slot], t_enter[slot]};
+				int i = stack_size++;
+				while (i > first && stack[i - 1].t < child.t)
+				{
+					stack[i] = stack[i - 1];
+					i--;
+				}
+				stack[i] = child;
+			}
+		}
+
+		return hit;
+	}
+
+	/**
+	 * @brief Traverses the BVH with all lanes of a packet, children are visited if any lane hits them.
+	 *
+	 * Children are ordered by the smallest entry distance over their lanes. Subtrees reached by at most
+	 * SINGLE_RAY_LANES lanes are finished with single-ray traversal.
+	 *
+	 * @param[in,out] packet The rays to test.
+	 * @param[in] mask The active lanes.
+	 * @param[in] intersect_primitive Tests one primitive index against a lane mask and returns the lanes that hit.
+	 * @return The mask of the lanes that hit any primitive.
+	 */
+	template <typename IntersectPrimitive>
+	int traversePacket(RayPacket& packet, int mask, IntersectPrimitive& intersect_primitive) const
+	{
+		if (this->nodes.empty() || mask == 0)
+		{
+			return 0;
+		}
+
+		int octant = packet.getOctant(mask);
+
+		PacketStackEntry stack[MAX_TRAVERSAL_DEPTH * Width];
+		int stack_size = 0;
+		stack[stack_size++] = PacketStackEntry{0, 0, mask, 0.0f};
+
+		int hit = 0;
+		while (stack_size > 0)
+		{
+			PacketStackEntry entry = stack[--stack_size];
+			int active = packet.getLanesBeyond(entry.t, entry.mask & mask);
+			if (active == 0)
+			{
+				continue;
+			}
+
+			/* Packets that lost their coherence continue with one ray per remaining lane */
+			if (entry.count == 0 && countLanes(active) <= SINGLE_RAY_LANES)
+			{
+				for (int lane = 0; lane < PACKET_SIZE; lane++)
+				{
+					if (((active >> lane) & 1) == 0)
+					{
+						continue;
+					}
+
+					Ray ray = packet.getRay(lane);
+					auto intersect_lane = [&](const int index) {
+						bool lane_hit = intersect_primitive(index, 1 << lane) != 0;
+						ray.t = packet.t[lane];
+						return lane_hit;
+					};
+					if (this->traverse<false>(entry.offset, ray, intersect_lane))
+					{
+						hit |= 1 << lane;
+					}
+				}
+				continue;
+			}
+
+			if (entry.count > 0)
+			{
+				for (int i = 0; i < entry.count; i++)
+				{
+					hit |= intersect_primitive(this->primitive_indices[entry.offset + i], active);
+				}
+				continue;
+			}
+
+			const WideBVHNode<Width>& node = this->nodes[entry.offset];
+			int lanes[Width];
+			float t_enter[Width];
+			intersectChildren(node, packet, active, octant, lanes, t_enter);
+
+			/* Insert farthest first, so the nearest child is popped next */
+			int first = stack_size;
+			for (int slot = 0; slot < Width; slot++)
+			{
+				if (lanes[slot] == 0)
+				{
+					continue;
+				}
+
+				PacketStackEntry child{node.offset[slot], node.count[slot], lanes[slot], t_enter[slot]};
+				int i = stack_size++;
+				while (i > first && stack[i - 1].t < child.t)
+				{
+					stack[i] = stack[i - 1];
+					i--;
+				}
+				stack[i] = child;
+			}
+		}
+
+		return hit;
+	}
+
+	/**
+	 * @brief Appends a wide node for a binary BVH subtree and, recursively, for all of its interior children.
+	 *
+	 * The children are gathered by repeatedly opening the interior binary node with the largest surface area until
+	 * Width children are found or only leaves remain.
+	 *
+	 * @param[in] nodes The binary BVH nodes.
+	 * @param[in] index The root of the subtree.
+	 * @param[in] get_primitives Appends the primitive indices stored in a leaf node to a vector.
+	 * @param[in] depth The depth of the subtree root.
+	 * @return The index of the wide node.
+	 */
+	template <typename Node, typename GetPrimitives>
+	int collapse(const std::vector<Node>& nodes, const int index, GetPrimitives& get_primitives, const int depth = 0)
+	{
+		if (depth >= MAX_TRAVERSAL_DEPTH)
+		{
+			throw std::runtime_error("BVH is too deep for stack traversal!");
+		}
+
+		int children[Width];
+		int child_count = 0;
+		if (nodes[index].leaf_node_flag)
+		{
+			children[child_count++] = index;
+		}
+		else
+		{
+			children[child_count++] = nodes[index].left;
+			children[child_count++] = nodes[index].right;
+			while (child_count < Width)
+			{
+				int largest = -1;
+				float largest_area = -1.0f;
+				for (int i = 0; i < child_count; i++)
+				{
+					auto& child = nodes[children[i]];
+					float area = child.bounding_box.getSurfaceArea();
+					if (!child.leaf_node_flag && area > largest_area)
+					{
+						largest = i;
+						largest_area = area;
+					}
+				}
+				if (largest == -1)
+				{
+					break;
+				}
+
+				auto& opened = nodes[children[largest]];
+				children[largest] = opened.left;
+				children[child_count++] = opened.right;
+			}
+		}
+
+		int wide_index = int(this->nodes.size());
+		this->nodes.emplace_back();
+
+		WideBVHNode<Width> wide_node;
+		for (int slot = 0; slot < Width; slot++)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				wide_node.bounds[axis][slot] = std::numeric_limits<float>::infinity();
+				wide_node.bounds[axis + 3][slot] = -std::numeric_limits<float>::infinity();
+			}
+			wide_node.offset[slot] = -1;
+			wide_node.count[slot] = 0;
+		}
+
+		for (int slot = 0; slot < child_count; slot++)
+		{
+			auto& child = nodes[children[slot]];
+			if (child.leaf_node_flag)
+			{
+				int offset = int(this->primitive_indices.size());
+				get_primitives(child, this->primitive_indices);
+				int count = int(this->primitive_indices.size()) - offset;
+				if (count == 0)
+				{
+					continue;
+				}
+				wide_node.offset[slot] = offset;
+				wide_node.count[slot] = uint16_t(count);
+			}
+			else
+			{
+				wide_node.offset[slot] = this->collapse(nodes, children[slot], get_primitives, depth + 1);
+			}
+
+			Vector3f min = child.bounding_box.getMin();
+			Vector3f max = child.bounding_box.getMax();
+			for (int axis = 0; axis < 3; axis++)
+			{
+				wide_node.bounds[axis][slot] = min[axis];
+				wide_node.bounds[axis + 3][slot] = max[axis];
+			}
+		}
+
+		this->nodes[wide_index] = wide_node;
+		return wide_index;
+	}
+
+	/**
+	 * @brief Slab test of the active lanes of a ray packet against all children of a node, limited to [0, t].
+	 *
+	 * @param[in] node The node whose children are tested.
+	 * @param[in] packet The rays to test.
+	 * @param[in] mask The active lanes.
+	 * @param[in] octant The octant shared by the active lanes from RayPacket::getOctant, or -1.
+	 * @param[out] lanes The mask of the lanes that hit every child.
+	 * @param[out] t_enter The smallest entry distance over the lanes that hit every child.
+	 */
+	static void intersectChildren(const WideBVHNode<Width>& node,
+								  const RayPacket& packet,
+								  const int mask,
+								  const int octant,
+								  int lanes[Width],
+								  float t_enter[Width])
+	{
+		constexpr float robust = 1.0f + 2.0f * 3.0f * std::numeric_limits<float>::epsilon() * 0.5f;
+		constexpr float infinity = std::numeric_limits<float>::infinity();
+
+		for (int slot = 0; slot < Width; slot++)
+		{
+			lanes[slot] = 0;
+			t_enter[slot] = infinity;
+		}
+
+#if defined(PATH_TRACING_SSE)
+		constexpr int group_mask = (1 << SIMD_WIDTH) - 1;
+		for (int group = 0; group < PACKET_SIZE; group += SIMD_WIDTH)
+		{
+			if (((mask >> group) & group_mask) == 0)
+			{
+				continue;
+			}
+
+			SIMDFloat origin[3], inverse[3], negative[3];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				origin[axis] = simdLoad(packet.origin[axis] + group);
+				inverse[axis] = simdLoad(packet.inverse_direction[axis] + group);
+				negative[axis] = simdLess(inverse[axis], simdSet(0.0f));
+			}
+			SIMDFloat t = simdLoad(packet.t + group);
+
+			for (int slot = 0; slot < Width; slot++)
+			{
+				if (node.count[slot] == 0 && node.offset[slot] < 0)
+				{
+					continue;
+				}
+
+				SIMDFloat enter = simdSet(0.0f);
+				SIMDFloat exit = t;
+				for (int axis = 0; axis < 3; axis++)
+				{
+					float min = node.bounds[axis][slot];
+					float max = node.bounds[axis + 3][slot];
+					SIMDFloat t_near, t_far;
+					if (octant >= 0)
+					{
+						/* All lanes enter through the same plane, no per-lane selection needed */
+						bool is_negative = (octant >> axis) & 1;
+						t_near = simdMul(simdSub(simdSet(is_negative ? max : min), origin[axis]), inverse[axis]);
+						t_far = simdMul(simdSub(simdSet(is_negative ? min : max), origin[axis]), inverse[axis]);
+					}
+					else
+					{
+						SIMDFloat t0 = simdMul(simdSub(simdSet(min), origin[axis]), inverse[axis]);
+						SIMDFloat t1 = simdMul(simdSub(simdSet(max), origin[axis]), inverse[axis]);
+						t_near = simdSelect(negative[axis], t1, t0);
+						t_far = simdSelect(negative[axis], t0, t1);
+					}
+
+					/* The running interval is the second operand, so NaN from 0 * inf keeps it */
+					enter = simdMax(t_near, enter);
+					exit = simdMin(simdMul(t_far, simdSet(robust)), exit);
+				}
+
+				int hit = simdMask(simdLessEqual(enter, exit)) & (mask >> group) & group_mask;
+				if (hit == 0)
+				{
+					continue;
+				}
+				lanes[slot] |= hit << group;
+
+				alignas(32) float distances[SIMD_WIDTH];
+				simdStore(distances, enter);
+				for (int lane = 0; lane < SIMD_WIDTH; lane++)
+				{
+					t_enter[slot] = (hit >> lane) & 1 ? std::min(t_enter[slot], distances[lane]) : t_enter[slot];
+				}
+			}
+		}
+#else
+		for (int lane = 0; lane < PACKET_SIZE; lane++)
+		{
+			if (((mask >> lane) & 1) == 0)
+			{
+				continue;
+			}
+
+			for (int slot = 0; slot < Width; slot++)
+			{
+				float enter = 0.0f;
+				float exit = packet.t[lane];
+				for (int axis = 0; axis < 3; axis++)
+				{
+					float inverse = packet.inverse_direction[axis][lane];
+					float t0 = (node.bounds[axis][slot] - packet.origin[axis][lane]) * inverse;
+					float t1 = (node.bounds[axis + 3][slot] - packet.origin[axis][lane]) * inverse;
+					float t_near = inverse < 0.0f ? t1 : t0;
+					float t_far = (inverse < 0.0f ? t0 : t1) * robust;
+					enter = t_near > enter ? t_near : enter;
+					exit = t_far < exit ? t_far : exit;
+				}
+
+				if (enter <= exit)
+				{
+					lanes[slot] |= 1 << lane;
+					t_enter[slot] = std::min(t_enter[slot], enter);
+				}
+			}
+		}
+#endif
+	}
+
+	/**
+	 * @brief Slab test of a ray against all children of a node, limited to [0, ray.t].
+	 *
+	 * Comparisons are ordered so that NaN from 0 * inf keeps the previous interval, and the exit distance is widened
+	 * slightly so rounding never culls a box that is touched exactly.
+	 *
+	 * @param[in] node The node whose children are tested.
+	 * @param[in] ray The ray to test.
+	 * @param[in] inverse_direction The reciprocal of the ray direction.
+	 * @param[in] near_plane The bounds row of the entry plane per axis.
+	 * @param[in] far_plane The bounds row of the exit plane per axis.
+	 * @param[out] t_enter The entry distance of every child.
+	 * @return A bit mask of the hit children.
+	 */
+	static int intersectChildren(const WideBVHNode<Width>& node,
+								 const Ray& ray,
+								 const Vector3f& inverse_direction,
+								 const int near_plane[3],
+								 const int far_plane[3],
+								 float* t_enter)
+	{
+		constexpr float robust = 1.0f + 2.0f * 3.0f * std::numeric_limits<float>::epsilon() * 0.5f;
+
+#if defined(__AVX2__)
+		if constexpr (Width == 8)
+		{
+			__m256 enter = _mm256_setzero_ps();
+			__m256 exit = _mm256_set1_ps(ray.t);
+			for (int axis = 0; axis < 3; axis++)
+			{
+				__m256 origin = _mm256_set1_ps(ray.origin[axis]);
+				__m256 inverse = _mm256_set1_ps(inverse_direction[axis]);
+				__m256 t_near = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[near_plane[axis]]), origin), inverse);
+				__m256 t_far = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.bounds[far_plane[axis]]), origin), inverse);
+				enter = _mm256_max_ps(t_near, enter);
+				exit = _mm256_min_ps(_mm256_mul_ps(t_far, _mm256_set1_ps(robust)), exit);
+			}
+			_mm256_store_ps(t_enter, enter);
+			return _mm256_movemask_ps(_mm256_cmp_ps(enter, exit, _CMP_LE_OQ));
+		}
+#endif
+#if defined(PATH_TRACING_SSE)
+		if constexpr (Width % 4 == 0)
+		{
+			int mask = 0;
+			for (int group = 0; group < Width; group += 4)
+			{
+				__m128 enter = _mm_setzero_ps();
+				__m128 exit = _mm_set1_ps(ray.t);
+				for (int axis = 0; axis < 3; axis++)
+				{
+					__m128 origin = _mm_set1_ps(ray.origin[axis]);
+					__m128 inverse = _mm_set1_ps(inverse_direction[axis]);
+					__m128 t_near = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[near_plane[axis]] + group), origin), inverse);
+					__m128 t_far = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[far_plane[axis]] + group), origin), inverse);
+					enter = _mm_max_ps(t_near, enter);
+					exit = _mm_min_ps(_mm_mul_ps(t_far, _mm_set1_ps(robust)), exit);
+				}
+				_mm_store_ps(t_enter + group, enter);
+				mask |= _mm_movemask_ps(_mm_cmple_ps(enter, exit)) << group;
+			}
+			return mask;
+		}
+#endif
+		int mask = 0;
+		for (int slot = 0; slot < Width; slot++)
+		{
+			float enter = 0.0f;
+			float exit = ray.t;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float t_near = (node.bounds[near_plane[axis]][slot] - ray.origin[axis]) * inverse_direction[axis];
+				float t_far = (node.bounds[far_plane[axis]][slot] - ray.origin[axis]) * inverse_direction[axis] * robust;
+				enter = t_near > enter ? t_near : enter;
+				exit = t_far < exit ? t_far : exit;
+			}
+			t_enter[slot] = enter;
+			mask |= (enter <= exit ? 1 : 0) << slot;
+		}
+		return mask;
+	}
+};
@@ -398,7 +398,7 @@ public:
 	VkDescriptorSetLayout descriptorSetLayout;
 	void createDescriptorSetLayout()
 	{
-		std::array<VkDescriptorSetLayoutBinding, 11> layoutBindings{};
+		std::array<VkDescriptorSetLayoutBinding, 15> layoutBindings{};
 
 		/* Used for compute shader data input buffer */
 		for (size_t i = 0; i < 8; i++)
@@ -431,6 +431,16 @@ public:
 		layoutBindings[10].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
 		layoutBindings[10].pImmutableSamplers = nullptr;
 
+		/* Used for compute shader light sampling alias tables and light tree */
+		for (size_t i = 11; i < 15; i++)
+		{
+			layoutBindings[i].binding = i;
+			layoutBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			layoutBindings[i].descriptorCount = 1;
+			layoutBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+			layoutBindings[i].pImmutableSamplers = nullptr;
+		}
+
 		VkDescriptorSetLayoutCreateInfo layoutInfo{};
 		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 		layoutInfo.pNext = nullptr;
@@ -450,7 +460,7 @@ public:
 	{
 		std::array<VkDescriptorPoolSize, 3> pool_sizes;
 		pool_sizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-		pool_sizes[0].descriptorCount = 8;
+		pool_sizes[0].descriptorCount = 12;
 
 		pool_sizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
 		pool_sizes[1].descriptorCount = 3;
@@ -487,10 +497,11 @@ public:
 			throw std::runtime_error("Failed to allocate descriptor sets!");
 		}
 
-		std::array<VkDescriptorBufferInfo, 8> bufferInfo{};
-		for (size_t i = 0; i < 8; i++)
+		/* Bindings 11 to 14 read the light sampling buffers, which follow the scene buffers */
+		std::array<VkDescriptorBufferInfo, 12> bufferInfo{};
+		for (size_t i = 0; i < 12; i++)
 		{
-			bufferInfo[i].buffer = this->bufferManager.buffers[i];
+			bufferInfo[i].buffer = this->bufferManager.buffers[i < 8 ? i : i + 1];
 			bufferInfo[i].offset = 0;
 			bufferInfo[i].range = VK_WHOLE_SIZE;
 		}
@@ -513,8 +524,8 @@ public:
 			textureInfo[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 		}
 
-		std::array<VkWriteDescriptorSet, 11> descriptorWrites{};
-		for (size_t i = 0; i < 11; i++)
+		std::array<VkWriteDescriptorSet, 15> descriptorWrites{};
+		for (size_t i = 0; i < 15; i++)
 		{
 			descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 			descriptorWrites[i].pNext = nullptr;
@@ -548,6 +559,14 @@ public:
 		descriptorWrites[10].pImageInfo = textureInfo.data();
 		descriptorWrites[10].pTexelBufferView = nullptr;
 
+		for (size_t i = 11; i < 15; i++)
+		{
+			descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			descriptorWrites[i].pBufferInfo = &bufferInfo[i - 3];
+			descriptorWrites[i].pImageInfo = nullptr;
+			descriptorWrites[i].pTexelBufferView = nullptr;
+		}
+
 		vkUpdateDescriptorSets(context_manager.device,
 							   static_cast<uint32_t>(descriptorWrites.size()),
 							   descriptorWrites.data(),
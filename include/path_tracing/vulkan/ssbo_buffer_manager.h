@@ -48,16 +48,82 @@ struct SSBOTriangle
 	alignas(16) glm::vec3 normal;
 	float area;
 
-	void operator=(const Triangle& triangle)
+	/* The index of the triangle in its mesh, also its slot in the triangle alias table and among the emitters */
+	int index;
+
+	void set(const PathTracingMesh& mesh, const int index)
 	{
-		this->vertex1 = triangle.vertex1;
-		this->vertex2 = triangle.vertex2;
-		this->vertex3 = triangle.vertex3;
+		this->vertex1 = mesh.getVertex(index, 0);
+		this->vertex2 = mesh.getVertex(index, 1);
+		this->vertex3 = mesh.getVertex(index, 2);
+
+		const TriangleRecord& triangle = mesh.getTriangle(index);
 		this->normal = triangle.normal;
-		this->area = triangle.area;
+		this->area = triangle.getArea();
+		this->index = index;
+	}
+};
+
+struct SSBOAliasEntry
+{
+	float probability;
+	int alias;
+	float pmf;
+
+	/* The light object or -1 minus the point light emitter of an entry of the light table, the triangle of an entry
+	   of a triangle table */
+	int index;
+
+	void set(const AliasEntry& entry, const int index)
+	{
+		this->probability = entry.probability;
+		this->alias = entry.alias;
+		this->pmf = entry.pmf;
+		this->index = index;
+	}
+};
+
+struct SSBOLightTreeNode
+{
+	alignas(16) glm::vec3 min;
+	float power;
+	alignas(16) glm::vec3 max;
+	float cos_theta_o;
+	alignas(16) glm::vec3 axis;
+	float cos_theta_e;
+	int child_or_light;
+	int is_leaf;
+
+	void operator=(const LightTreeNode& node)
+	{
+		this->min = node.bounds.bounding_box.getMin();
+		this->power = node.bounds.power;
+		this->max = node.bounds.bounding_box.getMax();
+		this->cos_theta_o = node.bounds.cos_theta_o;
+		this->axis = node.bounds.axis;
+		this->cos_theta_e = node.bounds.cos_theta_e;
+		this->child_or_light = node.child_or_light;
+		this->is_leaf = node.leaf_node_flag ? 1 : 0;
 	}
 };
 
+struct SSBOLightEmitter
+{
+	/* The position and intensity of a point light, the direction and irradiance of a directional light, unused for
+	   triangles */
+	alignas(16) glm::vec3 position;
+	int object_index;
+	alignas(16) glm::vec3 intensity;
+	int triangle_index;
+
+	/* The low and high 32 bits of the path from the root of the light tree to the emitter */
+	uint32_t bit_trail_low;
+	uint32_t bit_trail_high;
+
+	/* The power a directional light is picked by against the light tree, unused for the lights in the tree */
+	float power;
+};
+
 struct SSBOOMaterial
 {
 	alignas(16) glm::vec3 ka;
@@ -90,6 +156,12 @@ struct SSBOObject
 	int material_index;
 	int bvh_index;
 	bool is_light;
+	int alias_index;
+	int triangle_count;
+
+	/* The position of a light object in the light table and of its first triangle among the light emitters */
+	int light_index;
+	int emitter_offset;
 
 	void operator=(const Object& object)
 	{
@@ -98,6 +170,10 @@ struct SSBOObject
 		this->is_light = object.is_light;
 		this->radiance = object.radiance;
 		this->bvh_index = 0;
+		this->alias_index = -1;
+		this->triangle_count = 0;
+		this->light_index = -1;
+		this->emitter_offset = -1;
 	}
 };
 
@@ -114,6 +190,9 @@ struct SSBOScene
 	int height;
 	int max_depth;
 	int spp;
+	int russian_roulette_depth;
+	int light_sampler_type;
+	int infinite_light_count;
 };
 
 class SSBOBufferManager : public BufferManager
@@ -125,13 +204,17 @@ public:
 		this->context_manager_sptr = context_manager_sptr;
 		this->command_manager_sptr = command_manager_sptr;
 	}
-	std::array<VkBuffer, 9> buffers;
-	std::array<VkDeviceMemory, 9> memories;
+	std::array<VkBuffer, 13> buffers;
+	std::array<VkDeviceMemory, 13> memories;
 
-	std::vector<float> random_table;
+	std::vector<float> blue_noise_mask;
 	std::vector<SSBOBVH> bvhs;
 	std::vector<SSBOBVH> scene_bvhs;
 	std::vector<int> light_object_indexs;
+	std::vector<SSBOAliasEntry> light_aliases;
+	std::vector<SSBOAliasEntry> triangle_aliases;
+	std::vector<SSBOLightTreeNode> light_tree_nodes;
+	std::vector<SSBOLightEmitter> light_emitters;
 	std::vector<SSBOTriangle> triangles;
 	std::vector<SSBOObject> objects;
 	std::vector<SSBOOMaterial> materials;
@@ -151,38 +234,65 @@ public:
 		this->scene.height = scene.camera.height;
 		this->scene.max_depth = scene.max_depth;
 		this->scene.spp = spp;
+		this->scene.russian_roulette_depth = scene.russian_roulette_depth;
+		this->scene.light_sampler_type = int(scene.light_sampler_type);
+		this->scene.infinite_light_count = scene.light_tree.infinite_count;
 
 		this->scene_name = scene.name;
 
-		for (int i = 0; i < scene.camera.width * scene.camera.height; i++)
-		{
-			this->random_table.push_back(getRandomNumber(0, 1));
-		}
+		this->blue_noise_mask = getBlueNoiseMask();
 
+		/* Objects instancing the same mesh share its nodes, triangles and triangle alias table */
+		std::vector<int> mesh_bvh_index(scene.meshes.size(), -1);
+		std::vector<int> mesh_alias_index(scene.meshes.size(), -1);
+		std::vector<std::vector<int>> mesh_triangle_index(scene.meshes.size());
 		for (auto& object : scene.objects)
 		{
-			int begin_size = this->bvhs.size();
-
-			SSBOBVH bvh;
-			SSBOTriangle triangle;
-			for (auto& node : object.bvh)
+			const PathTracingMesh& mesh = *object.geometry;
+			int begin_size = mesh_bvh_index[object.mesh_index];
+			if (begin_size == -1)
 			{
-				bvh.box = node.bounding_box;
-				bvh.left = node.left + begin_size;
-				bvh.right = node.right + begin_size;
-				bvh.area = node.area;
+				begin_size = this->bvhs.size();
+				mesh_bvh_index[object.mesh_index] = begin_size;
 
-				if (node.leaf_node_flag)
+				SSBOBVH bvh;
+				for (auto& node : mesh.bvh)
 				{
-					triangle = node.triangle;
-					this->triangles.push_back(triangle);
-					bvh.index = this->triangles.size() - 1;
+					bvh.box = node.bounding_box;
+					bvh.left = node.left + begin_size;
+					bvh.right = node.right + begin_size;
+					bvh.area = node.area;
+					bvh.index = -1;
+					this->bvhs.push_back(bvh);
 				}
-				else
+
+				/* The shader expects one triangle per leaf, larger leaves are expanded into a chain of nodes */
+				std::vector<int>& triangle_index = mesh_triangle_index[object.mesh_index];
+				triangle_index.resize(mesh.getTriangleCount());
+				for (int i = 0; i < mesh.bvh.size(); i++)
 				{
-					bvh.index = -1;
+					auto& node = mesh.bvh[i];
+					if (node.leaf_node_flag)
+					{
+						int first = this->triangles.size();
+						this->appendLeaf(begin_size + i, mesh, node.primitive_offset, node.primitive_count);
+						for (int j = 0; j < node.primitive_count; j++)
+						{
+							triangle_index[mesh.triangle_indices[node.primitive_offset + j]] = first + j;
+						}
+					}
+				}
+
+				if (!mesh.triangle_table.empty())
+				{
+					mesh_alias_index[object.mesh_index] = this->triangle_aliases.size();
+					for (int i = 0; i < mesh.triangle_table.entries.size(); i++)
+					{
+						SSBOAliasEntry entry;
+						entry.set(mesh.triangle_table.entries[i], triangle_index[i]);
+						this->triangle_aliases.push_back(entry);
+					}
 				}
-				this->bvhs.push_back(bvh);
 			}
 
 			SSBOOMaterial temp_material;
@@ -201,7 +311,11 @@ public:
 			SSBOObject temp_object;
 			temp_object = object;
 			temp_object.bvh_index = begin_size;
+			temp_object.alias_index = mesh_alias_index[object.mesh_index];
+			temp_object.triangle_count = mesh.getTriangleCount();
 			temp_object.material_index = this->materials.size() - 1;
+			temp_object.light_index = scene.light_index[this->objects.size()];
+			temp_object.emitter_offset = scene.light_emitter_offset[this->objects.size()];
 
 			this->objects.push_back(temp_object);
 		}
@@ -217,12 +331,104 @@ public:
 			this->scene_bvhs.push_back(bvh);
 		}
 		this->light_object_indexs = scene.light_object_index;
+
+		/* Point and directional lights follow the light objects in the light table, their entries point to -1 - their
+		   emitter */
+		int point_emitter =
+			int(scene.light_emitters.size() - scene.point_lights.size() - scene.direction_lights.size());
+		int light_count = int(scene.light_object_index.size());
+		for (int i = 0; i < scene.light_table.entries.size(); i++)
+		{
+			SSBOAliasEntry entry;
+			int index = i < light_count ? scene.light_object_index[i] : -1 - (point_emitter + i - light_count);
+			entry.set(scene.light_table.entries[i], index);
+			this->light_aliases.push_back(entry);
+		}
+
+		/* The light tree refers to the triangles by their index in the triangle buffer */
+		for (auto& node : scene.light_tree.nodes)
+		{
+			SSBOLightTreeNode temp_node;
+			temp_node = node;
+			this->light_tree_nodes.push_back(temp_node);
+		}
+		for (auto& emitter : scene.light_emitters)
+		{
+			SSBOLightEmitter temp_emitter{};
+			uint64_t bit_trail = scene.light_tree.bit_trails[this->light_emitters.size()];
+			temp_emitter.bit_trail_low = uint32_t(bit_trail);
+			temp_emitter.bit_trail_high = uint32_t(bit_trail >> 32);
+			temp_emitter.object_index = emitter.object_index;
+			if (emitter.object_index == -1)
+			{
+				const PointLight& light = scene.point_lights[emitter.index];
+				temp_emitter.position = light.position;
+				temp_emitter.intensity = light.color * light.intensity;
+				temp_emitter.triangle_index = -1;
+			}
+			else if (emitter.object_index == -2)
+			{
+				const DirectionLight& light = scene.direction_lights[emitter.index];
+				temp_emitter.position = glm::normalize(light.direction);
+				temp_emitter.intensity = light.color * light.intensity;
+				temp_emitter.triangle_index = -1;
+				temp_emitter.power = scene.light_tree.infinite_powers[emitter.index];
+			}
+			else
+			{
+				int mesh_index = scene.objects[emitter.object_index].mesh_index;
+				temp_emitter.triangle_index = mesh_triangle_index[mesh_index][emitter.index];
+			}
+			this->light_emitters.push_back(temp_emitter);
+		}
+	}
+
+	void appendLeaf(const int index, const PathTracingMesh& mesh, const int offset, const int count)
+	{
+		SSBOTriangle triangle;
+		triangle.set(mesh, mesh.triangle_indices[offset]);
+		this->triangles.push_back(triangle);
+
+		if (count == 1)
+		{
+			this->bvhs[index].index = this->triangles.size() - 1;
+			return;
+		}
+
+		/* Split off the first triangle as the left child, the remaining triangles form the right child */
+		SSBOBVH left, right;
+		left.box = mesh.getTriangle(mesh.triangle_indices[offset]).getBoundingBox();
+		left.left = -1;
+		left.right = -1;
+		left.index = this->triangles.size() - 1;
+		left.area = triangle.area;
+
+		BoundingBox right_box{};
+		float right_area = 0.0f;
+		for (int i = 1; i < count; i++)
+		{
+			right_box.unionBox(mesh.getTriangle(mesh.triangle_indices[offset + i]).getBoundingBox());
+			right_area += mesh.getTriangle(mesh.triangle_indices[offset + i]).getArea();
+		}
+		right.box = right_box;
+		right.left = -1;
+		right.right = -1;
+		right.index = -1;
+		right.area = right_area;
+
+		this->bvhs.push_back(left);
+		this->bvhs.push_back(right);
+		this->bvhs[index].left = this->bvhs.size() - 2;
+		this->bvhs[index].right = this->bvhs.size() - 1;
+		this->bvhs[index].index = -1;
+
+		this->appendLeaf(this->bvhs.size() - 1, mesh, offset + 1, count - 1);
 	}
 
 	void init()
 	{
-		createDeviceLocalBuffer(this->random_table.size() * sizeof(float),
-								this->random_table.data(),
+		createDeviceLocalBuffer(this->blue_noise_mask.size() * sizeof(float),
+								this->blue_noise_mask.data(),
 								VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
 								this->buffers[0],
 								this->memories[0]);
@@ -271,6 +477,30 @@ public:
 					 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 					 this->buffers[8],
 					 this->memories[8]);
+
+		createDeviceLocalBuffer(this->light_aliases.size() * sizeof(SSBOAliasEntry),
+								this->light_aliases.data(),
+								VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+								this->buffers[9],
+								this->memories[9]);
+
+		createDeviceLocalBuffer(this->triangle_aliases.size() * sizeof(SSBOAliasEntry),
+								this->triangle_aliases.data(),
+								VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+								this->buffers[10],
+								this->memories[10]);
+
+		createDeviceLocalBuffer(this->light_tree_nodes.size() * sizeof(SSBOLightTreeNode),
+								this->light_tree_nodes.data(),
+								VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+								this->buffers[11],
+								this->memories[11]);
+
+		createDeviceLocalBuffer(this->light_emitters.size() * sizeof(SSBOLightEmitter),
+								this->light_emitters.data(),
+								VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+								this->buffers[12],
+								this->memories[12]);
 	}
 
 	void clear()
@@ -99,6 +99,9 @@ private:
 
 	std::vector<VkTransformMatrixKHR> model_matrixes{};
 
+	/* The bottom level structure of every object, objects instancing the same vertices share one. */
+	std::vector<uint32_t> instance_blas{};
+
 	/* Extension Functions */
 	PFN_vkCmdTraceRaysKHR vkCmdTraceRaysKHR;
 	PFN_vkGetRayTracingShaderGroupHandlesKHR vkGetRayTracingShaderGroupHandlesKHR;
@@ -71,6 +71,14 @@ public:
 		{
 			auto& object = scene.objects[i];
 
+			/* Instances draw the vertices and indices of the object they share them with */
+			if (object.mesh_source != -1)
+			{
+				VkDrawIndexedIndirectCommand command = this->indirect_buffer_manager.commands[object.mesh_source];
+				this->indirect_buffer_manager.commands.push_back(command);
+				continue;
+			}
+
 			VkDrawIndexedIndirectCommand command{};
 			command.indexCount = static_cast<uint32_t>(object.indices.size());
 			command.instanceCount = 1;
@@ -4,12 +4,14 @@
 
 #define GLFW_INCLUDE_VULKAN
 #include <data_io.h>
+#include <benchmark.h>
 #include <data_loader.h>
 #include <GLFW/glfw3.h>
 #include <path_tracing_scene.h>
 #include <render.h>
 #include <renderer.h>
 #include <scene.h>
+#include <scene_cache.h>
 #include <utils.h>
 
 #include <cpu_rasterizer_renderer.h>
@@ -89,35 +91,169 @@ void pathTracingRender()
 
 	auto start = std::chrono::system_clock::now();
 	std::string path = std::string(ROOT_DIR) + "/models/" + name[scene_index] + "/";
-	InputOutput io(name[scene_index]);
-	io.loadObjFile(path);
-	io.loadXmlFile(path);
-	Scene temp_scene;
-	io.generateScene(temp_scene);
-	scene = temp_scene;
+	std::string cache_path = path + name[scene_index] + ".cache";
+	if (loadSceneCache(cache_path, scene))
+	{
+		auto end = std::chrono::system_clock::now();
+		outputTimeUse("Load Scene Cache", end - start);
+	}
+	else
+	{
+		InputOutput io(name[scene_index]);
+		io.loadObjFile(path);
+		io.loadXmlFile(path);
+		Scene temp_scene;
+		io.generateScene(temp_scene);
+		scene = temp_scene;
 
-	auto end = std::chrono::system_clock::now();
-	outputTimeUse("Load Data", end - start);
+		auto end = std::chrono::system_clock::now();
+		outputTimeUse("Load Data", end - start);
 
-	scene.setData(io.objects, io.camera);
+		scene.setData(io.objects, io.camera);
 
-	start = std::chrono::system_clock::now();
-	scene.initBVH();
-	end = std::chrono::system_clock::now();
-	outputTimeUse("Build BVH", end - start);
+		start = std::chrono::system_clock::now();
+		scene.initBVH();
+		end = std::chrono::system_clock::now();
+		outputTimeUse("Build BVH", end - start);
+
+		std::string source = path + name[scene_index];
+		saveSceneCache(cache_path, scene, {source + ".obj", source + ".mtl", source + ".xml"});
+	}
+	scene.outputBVHStatistics();
 
 	pathTracingGPU(scene, spp);
 
 	start = std::chrono::system_clock::now();
 	renderer.render(scene);
-	end = std::chrono::system_clock::now();
+	auto end = std::chrono::system_clock::now();
 	outputTimeUse("Render CPU", end - start);
 
 	return;
 }
 
-int main()
+void traversalBenchmark()
+{
+	for (auto& [scene_index, scene_name] : name)
+	{
+		std::string path = std::string(ROOT_DIR) + "/models/" + scene_name + "/";
+		InputOutput io(scene_name);
+		io.loadObjFile(path);
+		io.loadXmlFile(path);
+		Scene temp_scene;
+		io.generateScene(temp_scene);
+
+		PathTracingScene scene;
+		scene = temp_scene;
+		scene.name = scene_name;
+		scene.initBVH();
+
+		benchmarkTraversal(scene, 1 << 20);
+		benchmarkPacketTraversal(scene, 1 << 20);
+	}
+}
+
+void animationBenchmark()
+{
+	for (auto& [scene_index, scene_name] : name)
+	{
+		std::string path = std::string(ROOT_DIR) + "/models/" + scene_name + "/";
+		InputOutput io(scene_name);
+		io.loadObjFile(path);
+		io.loadXmlFile(path);
+		Scene temp_scene;
+		io.generateScene(temp_scene);
+
+		PathTracingScene scene;
+		scene = temp_scene;
+		scene.name = scene_name;
+		scene.initBVH();
+
+		benchmarkAnimation(scene, 64);
+	}
+}
+
+void lightSamplingBenchmark()
+{
+	for (auto& [scene_index, scene_name] : name)
+	{
+		std::string path = std::string(ROOT_DIR) + "/models/" + scene_name + "/";
+		InputOutput io(scene_name);
+		io.loadObjFile(path);
+		io.loadXmlFile(path);
+		Scene temp_scene;
+		io.generateScene(temp_scene);
+
+		PathTracingScene scene;
+		scene = temp_scene;
+		scene.name = scene_name;
+		scene.initBVH();
+
+		benchmarkLightSampling(scene, 4096, 64);
+	}
+}
+
+void loaderBenchmark()
 {
+	for (auto& [scene_index, scene_name] : name)
+	{
+		benchmarkObjLoader(std::string(ROOT_DIR) + "/models/" + scene_name + "/", scene_name);
+	}
+}
+
+void distributedRender(const bool is_coordinator, const std::string& host, const int port)
+{
+	int scene_index = 0;
+	std::string path = std::string(ROOT_DIR) + "/models/" + name[scene_index] + "/";
+	InputOutput io(name[scene_index]);
+	io.loadObjFile(path);
+	io.loadXmlFile(path);
+	Scene temp_scene;
+	io.generateScene(temp_scene);
+
+	PathTracingScene scene;
+	scene = temp_scene;
+	scene.name = name[scene_index];
+	scene.max_depth = 5;
+	scene.setData(io.objects, io.camera);
+
+	Renderer renderer;
+	if (is_coordinator)
+	{
+		/* The coordinator only merges tiles, the workers load and trace the scene */
+		renderer.spp = 256;
+		renderer.distributed_task_spp = 64;
+		renderer.renderCoordinator(scene, port);
+	}
+	else
+	{
+		scene.initBVH();
+		renderer.renderWorker(scene, host, port);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	/* "--coordinator PORT" and "--worker HOST PORT" start the processes of a distributed render */
+	std::vector<std::string> arguments(argv + 1, argv + argc);
+	if (arguments.size() == 2 && arguments[0] == "--coordinator")
+	{
+		distributedRender(true, "", std::stoi(arguments[1]));
+		return 0;
+	}
+	if (arguments.size() == 3 && arguments[0] == "--worker")
+	{
+		distributedRender(false, arguments[1], std::stoi(arguments[2]));
+		return 0;
+	}
+
+	//traversalBenchmark();
+
+	//animationBenchmark();
+
+	//lightSamplingBenchmark();
+
+	//loaderBenchmark();
+
 	//rasterRenderCPU();
 
 	//pathTracingRender();
@@ -80,6 +80,18 @@ float BoundingBox::getLengthZ() const
 	return this->z_max - this->z_min;
 }
 
+float BoundingBox::getSurfaceArea() const
+{
+	float x = this->getLengthX();
+	float y = this->getLengthY();
+	float z = this->getLengthZ();
+	if (x < 0.0f || y < 0.0f || z < 0.0f)
+	{
+		return 0.0f;
+	}
+	return 2.0f * (x * y + y * z + z * x);
+}
+
 bool BoundingBox::overlaps(const BoundingBox& other) const
 {
 	if (this->x_min > other.x_max || this->x_max < other.x_min)
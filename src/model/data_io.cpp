@@ -7,6 +7,106 @@
 #include <tiny_obj_loader.h>
 #include <tinyxml2.h>
 
+namespace
+{
+/**
+ * @brief An open-addressing hash map from OBJ index triples to deduplicated vertex indices.
+ *
+ * The slots are reserved up front for the expected number of vertices, and a lookup and an insertion share one linear
+ * probe sequence. The table doubles when it becomes half full.
+ */
+class VertexIndexMap
+{
+public:
+	/**
+	 * @brief Reserves the slots for a number of keys.
+	 *
+	 * @param[in] capacity The number of keys expected.
+	 */
+	explicit VertexIndexMap(const size_t capacity)
+	{
+		size_t size = 16;
+		while (size < 2 * capacity)
+		{
+			size *= 2;
+		}
+		this->slots.assign(size, Slot{});
+	}
+
+	/**
+	 * @brief Finds the vertex index of a key or inserts a new one.
+	 *
+	 * @param[in] key The position, normal and texture coordinate indices of the OBJ file.
+	 * @param[in] value The vertex index stored if the key is new.
+	 * @return The vertex index of the key.
+	 */
+	Index insert(const tinyobj::index_t& key, const Index value)
+	{
+		/* At most half of the slots are used, so probe sequences stay short */
+		if (2 * (this->count + 1) > this->slots.size())
+		{
+			this->grow();
+		}
+
+		Slot& slot = this->find(key);
+		if (slot.value == -1)
+		{
+			slot.key = key;
+			slot.value = value;
+			this->count++;
+		}
+		return slot.value;
+	}
+
+private:
+	struct Slot
+	{
+		tinyobj::index_t key{-1, -1, -1};
+
+		/* The vertex index, -1 for empty slots */
+		Index value{-1};
+	};
+
+	/* Returns the slot holding the key, or the empty slot where it belongs */
+	Slot& find(const tinyobj::index_t& key)
+	{
+		uint32_t hash = uint32_t(key.vertex_index) * 0x9e3779b1u;
+		hash = (hash ^ uint32_t(key.normal_index)) * 0x85ebca77u;
+		hash = (hash ^ uint32_t(key.texcoord_index)) * 0xc2b2ae3du;
+		hash ^= hash >> 16;
+
+		size_t mask = this->slots.size() - 1;
+		for (size_t i = hash & mask;; i = (i + 1) & mask)
+		{
+			Slot& slot = this->slots[i];
+			if (slot.value == -1 || (slot.key.vertex_index == key.vertex_index &&
+									 slot.key.normal_index == key.normal_index &&
+									 slot.key.texcoord_index == key.texcoord_index))
+			{
+				return slot;
+			}
+		}
+	}
+
+	void grow()
+	{
+		std::vector<Slot> old_slots(2 * this->slots.size());
+		old_slots.swap(this->slots);
+		for (auto& slot : old_slots)
+		{
+			if (slot.value != -1)
+			{
+				this->find(slot.key) = slot;
+			}
+		}
+	}
+
+	std::vector<Slot> slots;
+
+	size_t count{0};
+};
+} // namespace
+
 InputOutput::InputOutput(const std::string& name)
 {
 	this->name = name;
@@ -27,24 +127,42 @@ void InputOutput::loadObjFile(const std::string& path)
 	}
 
 	this->objects.resize(shapes.size());
-	/* Processing object data */
-	for (size_t i = 0; i < shapes.size(); i++)
+	/* Processing object data, every shape writes only its own object */
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int i = 0; i < int(shapes.size()); i++)
 	{
 		auto& shape = shapes[i];
+		auto& object = this->objects[i];
 
 		/* Object name */
-		this->objects[i].name = shape.name;
+		object.name = shape.name;
 
 		/* Object Material */
-		this->objects[i].material_index = shape.mesh.material_ids[0];
-
-		std::map<std::tuple<int, int, int>, Index> deduplication_index;
-		deduplication_index.clear();
+		object.material_index = shape.mesh.material_ids[0];
+
+		/* Object vertex indices, the first use of every index triple creates a vertex. Closed triangle meshes have
+		   about one vertex per six indices, so a quarter of the index count rarely needs to grow */
+		const auto& indices = shape.mesh.indices;
+		VertexIndexMap deduplication_index(indices.size() / 4);
+		std::vector<tinyobj::index_t> unique_indices;
+		unique_indices.reserve(indices.size());
+		object.indices.resize(indices.size());
+		for (size_t j = 0; j < indices.size(); j++)
+		{
+			Index vertex_index = deduplication_index.insert(indices[j], Index(unique_indices.size()));
+			if (vertex_index == Index(unique_indices.size()))
+			{
+				unique_indices.push_back(indices[j]);
+			}
+			object.indices[j] = vertex_index;
+		}
 
-		/* Object vertices and vertex indices */
-		for (const auto& index : shape.mesh.indices)
+		/* Object vertices */
+		object.vertices.resize(unique_indices.size());
+		for (size_t j = 0; j < unique_indices.size(); j++)
 		{
-			Vertex vertex{};
+			const auto& index = unique_indices[j];
+			Vertex& vertex = object.vertices[j];
 
 			if (index.vertex_index != -1)
 			{
@@ -65,18 +183,6 @@ void InputOutput::loadObjFile(const std::string& path)
 				vertex.texture = {attrib.texcoords[2 * index.texcoord_index + 0],
 								  1.0f - attrib.texcoords[2 * index.texcoord_index + 1]};
 			}
-
-			auto key = std::make_tuple(index.vertex_index, index.normal_index, index.texcoord_index);
-			if (deduplication_index.find(key) != deduplication_index.end())
-			{
-				this->objects[i].indices.push_back(deduplication_index[key]);
-			}
-			else
-			{
-				this->objects[i].vertices.push_back(vertex);
-				this->objects[i].indices.push_back(this->objects[i].vertices.size() - 1);
-				deduplication_index[key] = static_cast<uint32_t>(this->objects[i].vertices.size() - 1);
-			}
 		}
 	}
 
@@ -434,6 +540,9 @@ void InputOutput::loadGlbFile(const std::string& path)
 		}
 	};
 
+	/* The object holding the vertices of every primitive of a mesh, later nodes referencing the mesh instance it */
+	std::vector<std::vector<Index>> mesh_objects(model.meshes.size());
+
 	/* Parsing node data */
 	for (auto& node : model.nodes)
 	{
@@ -470,13 +579,38 @@ void InputOutput::loadGlbFile(const std::string& path)
 			}
 			else if (light.type == "directional")
 			{
+				DirectionLight direction_light;
+
+				direction_light.color = Vector3f(light.color[0], light.color[1], light.color[2]);
+				direction_light.intensity = static_cast<float>(light.intensity);
 
+				/* Directional lights shine along the negative z axis of their node */
+				Matrix4f model = get_model_matrix(node);
+				Vector4f position = model * Vector4f(Vector3f(0.0f), 1.0f);
+				direction_light.position = position / position.w;
+				direction_light.direction = glm::normalize(Vector3f(model * Vector4f(0.0f, 0.0f, -1.0f, 0.0f)));
+
+				this->direction_lights.push_back(direction_light);
 			}
 		}
 		/* Loading model data */
 		else if (node.mesh >= 0)
 		{
 			auto& mesh = model.meshes[node.mesh];
+			if (!mesh_objects[node.mesh].empty())
+			{
+				for (size_t i = 0; i < mesh.primitives.size(); i++)
+				{
+					Object object;
+					object.name = mesh.name;
+					object.model = get_model_matrix(node);
+					object.material_index = mesh.primitives[i].material;
+					object.mesh_source = mesh_objects[node.mesh][i];
+					this->objects.push_back(object);
+				}
+				continue;
+			}
+
 			for (auto& primitive : mesh.primitives)
 			{
 				Object object;
@@ -600,6 +734,7 @@ void InputOutput::loadGlbFile(const std::string& path)
 
 				object.model = get_model_matrix(node);
 				object.material_index = primitive.material;
+				mesh_objects[node.mesh].push_back(Index(this->objects.size()));
 				this->objects.push_back(object);
 			}
 		}
@@ -617,6 +752,7 @@ void InputOutput::generateScene(Scene& scene)
 	scene.objects = std::move(this->objects);
 	scene.materials = std::move(this->materials);
 	scene.point_lights = std::move(this->point_lights);
+	scene.direction_lights = std::move(this->direction_lights);
 
 	if (this->textures.empty())
 	{
@@ -0,0 +1,74 @@
+#include <random_generator.h>
+
+RandomGenerator::RandomGenerator(const uint64_t sequence, const uint64_t seed)
+{
+	this->setSequence(sequence, seed);
+}
+
+void RandomGenerator::setSequence(const uint64_t sequence, const uint64_t seed)
+{
+	this->state = 0u;
+	this->increment = (sequence << 1u) | 1u;
+	this->nextUInt();
+	this->state += seed;
+	this->nextUInt();
+}
+
+uint32_t RandomGenerator::nextUInt()
+{
+	uint64_t old_state = this->state;
+	this->state = old_state * 0x5851f42d4c957f2dULL + this->increment;
+	uint32_t xor_shifted = uint32_t(((old_state >> 18u) ^ old_state) >> 27u);
+	uint32_t rotate = uint32_t(old_state >> 59u);
+	return (xor_shifted >> rotate) | (xor_shifted << ((~rotate + 1u) & 31u));
+}
+
+float RandomGenerator::nextFloat()
+{
+	/* 2^-32, clamped so that the result never rounds up to 1 */
+	float value = float(this->nextUInt()) * 2.3283064365386963e-10f;
+	return value < 0.99999994f ? value : 0.99999994f;
+}
+
+float RandomGenerator::nextFloat(const float min, const float max)
+{
+	return min + (max - min) * this->nextFloat();
+}
+
+void RandomGenerator::advance(const int64_t delta)
+{
+	uint64_t multiplier = 0x5851f42d4c957f2dULL;
+	uint64_t increment = this->increment;
+	uint64_t accumulate_multiplier = 1u;
+	uint64_t accumulate_increment = 0u;
+	uint64_t steps = uint64_t(delta);
+
+	while (steps > 0)
+	{
+		if (steps & 1u)
+		{
+			accumulate_multiplier *= multiplier;
+			accumulate_increment = accumulate_increment * multiplier + increment;
+		}
+		increment = (multiplier + 1u) * increment;
+		multiplier *= multiplier;
+		steps /= 2u;
+	}
+
+	this->state = accumulate_multiplier * this->state + accumulate_increment;
+}
+
+uint64_t mixBits(uint64_t value)
+{
+	value ^= (value >> 31u);
+	value *= 0x7fb5d329728ea185ULL;
+	value ^= (value >> 27u);
+	value *= 0x81dadef4bc2dd44dULL;
+	value ^= (value >> 33u);
+	return value;
+}
+
+uint64_t hashSeed(const uint64_t pixel, const uint64_t sample, const uint64_t frame)
+{
+	return mixBits(pixel ^ mixBits(sample + 0x9e3779b97f4a7c15ULL * (frame + 1u)));
+}
@@ -29,10 +29,10 @@ BoundingBox Triangle::getBoundingBox() const
 	return this->bounding_box;
 }
 
-void Triangle::sample(Point& point, float& pdf) const
+void Triangle::sample(Point& point, float& pdf, const Vector2f& u) const
 {
-	float x = std::sqrt(getRandomNumber(0.0f, 1.0f));
-	float y = getRandomNumber(0.0f, 1.0f);
+	float x = std::sqrt(u.x);
+	float y = u.y;
 	point = this->vertex1.position * (1.0f - x) + this->vertex2.position * (x * (1.0f - y)) +
 			this->vertex3.position * (x * y);
 	pdf = 1.0f / this->area;
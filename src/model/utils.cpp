@@ -7,11 +7,9 @@ float clamp(const float& min, const float& max, const float& n)
 
 float getRandomNumber(const float min, const float max)
 {
-	std::random_device device;
-	std::mt19937 generate(device());
-	std::uniform_real_distribution<float> distribution(min, max);
+	thread_local RandomGenerator generator{std::random_device{}(), std::random_device{}()};
 
-	return distribution(generate);
+	return generator.nextFloat(min, max);
 }
 
 void outputProgress(float progress)
@@ -0,0 +1,52 @@
+#include <alias_table.h>
+
+void AliasTable::build(const std::vector<float>& weights)
+{
+	size_t count = weights.size();
+	this->entries.assign(count, AliasEntry{});
+	if (count == 0)
+	{
+		return;
+	}
+
+	double total = 0.0;
+	for (auto& weight : weights)
+	{
+		total += weight;
+	}
+
+	/* Every slot holds the average weight, slots below it are filled up by the alias of a slot above it */
+	std::vector<double> scaled(count);
+	std::vector<int> small, large;
+	for (size_t i = 0; i < count; i++)
+	{
+		double pmf = total > 0.0 ? weights[i] / total : 1.0 / double(count);
+		this->entries[i].pmf = float(pmf);
+		this->entries[i].alias = int(i);
+		scaled[i] = pmf * double(count);
+		(scaled[i] < 1.0 ? small : large).push_back(int(i));
+	}
+
+	while (!small.empty() && !large.empty())
+	{
+		int below = small.back();
+		small.pop_back();
+		int above = large.back();
+		large.pop_back();
+
+		this->entries[below].probability = float(scaled[below]);
+		this->entries[below].alias = above;
+		scaled[above] = (scaled[above] + scaled[below]) - 1.0;
+		(scaled[above] < 1.0 ? small : large).push_back(above);
+	}
+
+	/* What is left is full up to rounding */
+	for (auto& index : small)
+	{
+		this->entries[index].probability = 1.0f;
+	}
+	for (auto& index : large)
+	{
+		this->entries[index].probability = 1.0f;
+	}
+}
@@ -0,0 +1,46 @@
+#include <allocation_counter.h>
+
+#include <cstdlib>
+#include <new>
+
+#ifndef NDEBUG
+
+namespace
+{
+/* Counted per thread, so the render threads do not contend on a shared counter */
+thread_local uint64_t allocation_count = 0;
+} // namespace
+
+void* operator new(std::size_t size)
+{
+	allocation_count++;
+	if (void* pointer = std::malloc(size == 0 ? 1 : size))
+	{
+		return pointer;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+uint64_t getAllocationCount()
+{
+	return allocation_count;
+}
+
+#else
+
+uint64_t getAllocationCount()
+{
+	return 0;
+}
+
+#endif
@@ -0,0 +1,408 @@
+#include <benchmark.h>
+
+namespace
+{
+std::vector<Ray> generateCameraRays(const Camera& camera, const int ray_count, RandomGenerator& random)
+{
+	float scale = std::tan(camera.fov * pi / 360.0f);
+	float image_aspect_ratio = float(camera.width) / float(camera.height);
+	Direction n = camera.look - camera.position;
+
+	Vector3f local_y = glm::normalize(camera.up);
+	Vector3f local_x = glm::normalize(glm::cross(n, local_y));
+
+	float t = scale * glm::length(n);
+	float r = t * image_aspect_ratio;
+	Point begin = camera.look + local_y * t - local_x * r;
+
+	std::vector<Ray> rays;
+	rays.reserve(ray_count);
+	for (int i = 0; i < ray_count; i++)
+	{
+		Point image_point = begin + local_x * (2.0f * r * random.nextFloat()) - local_y * (2.0f * t * random.nextFloat());
+		rays.emplace_back(camera.position, glm::normalize(image_point - camera.position));
+	}
+	return rays;
+}
+
+Ray generateDiffuseRay(const IntersectResult& hit, RandomGenerator& random)
+{
+	Direction normal = glm::normalize(hit.normal);
+	if (glm::dot(normal, hit.ray.direction) > 0.0f)
+	{
+		normal = -normal;
+	}
+
+	float phi = 2.0f * pi * random.nextFloat();
+	float v = random.nextFloat();
+	float sin_theta = std::sqrt(1.0f - v);
+
+	Vector3f tangent = std::abs(normal.z) > 0.999f ? Vector3f(1, 0, 0)
+												   : glm::normalize(glm::cross(normal, Vector3f(0, 0, 1)));
+	Vector3f bitangent = glm::cross(normal, tangent);
+	Direction direction = tangent * (std::cos(phi) * sin_theta) + bitangent * (std::sin(phi) * sin_theta) +
+						  normal * std::sqrt(v);
+
+	return Ray{hit.point + normal * 1e-4f, glm::normalize(direction)};
+}
+
+/* Camera rays through the pixel centers in scanline order, the coherent case packets are meant for */
+std::vector<Ray> generateScanlineRays(const Camera& camera, const int ray_count)
+{
+	float scale = std::tan(camera.fov * pi / 360.0f);
+	float image_aspect_ratio = float(camera.width) / float(camera.height);
+	Direction n = camera.look - camera.position;
+
+	Vector3f local_y = glm::normalize(camera.up);
+	Vector3f local_x = glm::normalize(glm::cross(n, local_y));
+
+	float t = scale * glm::length(n);
+	float r = t * image_aspect_ratio;
+	Point begin = camera.look + local_y * t - local_x * r;
+
+	std::vector<Ray> rays;
+	rays.reserve(ray_count);
+	for (int i = 0; i < ray_count; i++)
+	{
+		int pixel = i % (camera.width * camera.height);
+		float x = (float(pixel % camera.width) + 0.5f) / float(camera.width);
+		float y = (float(pixel / camera.width) + 0.5f) / float(camera.height);
+		Point image_point = begin + local_x * (2.0f * r * x) - local_y * (2.0f * t * y);
+		rays.emplace_back(camera.position, glm::normalize(image_point - camera.position));
+	}
+	return rays;
+}
+
+/* Returns the best time of several runs in seconds */
+template <typename Run>
+double measureBest(Run run)
+{
+	double best = std::numeric_limits<double>::infinity();
+	for (int i = 0; i < 3; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		run();
+		best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+	return best;
+}
+
+/* Returns the best throughput of several runs in millions of rays per second */
+template <typename Trace>
+double measure(const std::vector<Ray>& rays, std::vector<float>& distances, Trace trace)
+{
+	distances.resize(rays.size());
+
+	double best = 0.0;
+	for (int run = 0; run < 3; run++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < rays.size(); i++)
+		{
+			Ray ray = rays[i];
+			distances[i] = trace(ray).t;
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		best = std::max(best, seconds > 0.0 ? double(rays.size()) / seconds * 1e-6 : 0.0);
+	}
+	return best;
+}
+} // namespace
+
+void benchmarkTraversal(const PathTracingScene& scene, const int ray_count)
+{
+	RandomGenerator random{0};
+
+	/* Camera rays plus one diffuse bounce from every camera hit */
+	std::vector<Ray> rays = generateCameraRays(scene.camera, ray_count, random);
+	for (int i = 0; i < ray_count; i++)
+	{
+		Ray ray = rays[i];
+		auto hit = scene.intersect(ray);
+		if (hit.is_intersect)
+		{
+			rays.push_back(generateDiffuseRay(hit, random));
+		}
+	}
+
+	std::vector<float> recursive_distances, wide_distances;
+	double recursive = measure(rays, recursive_distances, [&](Ray& ray) { return scene.traverse(0, ray); });
+	double wide = measure(rays, wide_distances, [&](Ray& ray) { return scene.intersect(ray); });
+
+	int mismatches = 0;
+	for (size_t i = 0; i < rays.size(); i++)
+	{
+		float a = recursive_distances[i];
+		float b = wide_distances[i];
+		if (std::isinf(a) != std::isinf(b) || (!std::isinf(a) && std::abs(a - b) > 1e-4f * std::max(1.0f, a)))
+		{
+			mismatches++;
+		}
+	}
+
+	std::cout << "Scene: " << scene.name << " , Rays: " << rays.size() << " (" << ray_count << " camera, "
+			  << rays.size() - ray_count << " diffuse)" << std::endl;
+	std::cout << "  Recursive BVH: " << recursive << " Mrays/s" << std::endl;
+	std::cout << "  Wide BVH" << BVH_WIDTH << "   : " << wide
+			  << " Mrays/s , Speedup: " << (recursive > 0.0 ? wide / recursive : 0.0) << "x , Mismatches: " << mismatches
+			  << std::endl;
+}
+
+void benchmarkPacketTraversal(PathTracingScene& scene, const int ray_count)
+{
+	RandomGenerator random{0};
+
+	/* Coherent camera rays, then one shadow ray from every camera hit towards a point on a light */
+	std::vector<Ray> camera_rays = generateScanlineRays(scene.camera, ray_count);
+	std::vector<Ray> shadow_rays;
+	for (auto& camera_ray : camera_rays)
+	{
+		Ray ray = camera_ray;
+		auto hit = scene.intersect(ray);
+		if (!hit.is_intersect)
+		{
+			continue;
+		}
+
+		LightSample light;
+		scene.sampleLight(light, hit.point, hit.normal, random.nextFloat(),
+						  Vector2f{random.nextFloat(), random.nextFloat()});
+		if (light.pdf == 0.0f)
+		{
+			continue;
+		}
+		Ray shadow_ray{hit.point, light.direction};
+		shadow_ray.t = light.distance - 0.001f;
+		shadow_rays.push_back(shadow_ray);
+	}
+
+	std::vector<IntersectResult> single_results(camera_rays.size()), packet_results;
+	std::vector<int> order;
+	double single_camera = measureBest([&]() {
+		for (size_t i = 0; i < camera_rays.size(); i++)
+		{
+			Ray ray = camera_rays[i];
+			single_results[i] = scene.intersect(ray);
+		}
+	});
+	double packet_camera = measureBest([&]() {
+		std::vector<Ray> rays = camera_rays;
+		scene.intersect(rays, packet_results, order);
+	});
+
+	std::vector<uint8_t> closest_occluded(shadow_rays.size()), single_occluded(shadow_rays.size());
+	double closest_shadow = measureBest([&]() {
+		for (size_t i = 0; i < shadow_rays.size(); i++)
+		{
+			Ray ray = shadow_rays[i];
+			float t_max = ray.t;
+			ray.t = std::numeric_limits<float>::infinity();
+			closest_occluded[i] = scene.intersect(ray).t < t_max ? 1 : 0;
+		}
+	});
+	double single_shadow = measureBest([&]() {
+		for (size_t i = 0; i < shadow_rays.size(); i++)
+		{
+			single_occluded[i] = scene.occluded(shadow_rays[i], shadow_rays[i].t) ? 1 : 0;
+		}
+	});
+
+	int mismatches = 0;
+	for (size_t i = 0; i < camera_rays.size(); i++)
+	{
+		float a = single_results[i].t;
+		float b = packet_results[i].t;
+		if (std::isinf(a) != std::isinf(b) || (!std::isinf(a) && std::abs(a - b) > 1e-4f * std::max(1.0f, a)))
+		{
+			mismatches++;
+		}
+	}
+	for (size_t i = 0; i < shadow_rays.size(); i++)
+	{
+		mismatches += closest_occluded[i] != single_occluded[i] ? 1 : 0;
+	}
+
+	auto throughput = [](const size_t count, const double seconds) { return double(count) / seconds * 1e-6; };
+	std::cout << "Scene: " << scene.name << " , Rays: " << camera_rays.size() << " camera, " << shadow_rays.size()
+			  << " shadow" << std::endl;
+	std::cout << "  Camera single : " << throughput(camera_rays.size(), single_camera) << " Mrays/s" << std::endl;
+	std::cout << "  Camera packet : " << throughput(camera_rays.size(), packet_camera)
+			  << " Mrays/s , Speedup: " << single_camera / packet_camera << "x" << std::endl;
+	std::cout << "  Shadow closest: " << throughput(shadow_rays.size(), closest_shadow) << " Mrays/s" << std::endl;
+	std::cout << "  Shadow any-hit: " << throughput(shadow_rays.size(), single_shadow)
+			  << " Mrays/s , Speedup: " << closest_shadow / single_shadow << "x , Mismatches: " << mismatches
+			  << std::endl;
+}
+
+void benchmarkObjLoader(const std::string& path, const std::string& name)
+{
+	size_t triangles = 0;
+	size_t vertices = 0;
+	double seconds = measureBest([&]() {
+		InputOutput io(name);
+		io.loadObjFile(path);
+
+		triangles = 0;
+		vertices = 0;
+		for (auto& object : io.objects)
+		{
+			triangles += object.indices.size() / 3;
+			vertices += object.vertices.size();
+		}
+	});
+
+	std::cout << "Model: " << name << " , Triangles: " << triangles << " , Vertices: " << vertices << std::endl;
+	std::cout << "  Load OBJ: " << seconds * 1000.0 << " ms , "
+			  << (seconds > 0.0 ? double(triangles) / seconds * 1e-6 : 0.0) << " Mtriangles/s" << std::endl;
+}
+
+void benchmarkAnimation(PathTracingScene& scene, const int frame_count)
+{
+	/* The rest pose of every mesh in the vertex order of its source object */
+	std::vector<std::vector<Vertex>> rest(scene.meshes.size());
+	std::vector<float> amplitude(scene.meshes.size(), 0.0f);
+	for (size_t i = 0; i < scene.meshes.size(); i++)
+	{
+		const PathTracingMesh& mesh = *scene.meshes[i];
+		if (mesh.geometry_cache != nullptr)
+		{
+			continue;
+		}
+		rest[i].resize(mesh.vertex_index.size());
+		for (size_t j = 0; j < mesh.vertex_index.size(); j++)
+		{
+			if (mesh.vertex_index[j] != -1)
+			{
+				rest[i][j] = mesh.vertices[mesh.vertex_index[j]];
+			}
+		}
+		amplitude[i] = 0.02f * glm::length(mesh.bounding_box.getMax() - mesh.bounding_box.getMin());
+	}
+	std::vector<Matrix4f> models;
+	for (auto& object : scene.objects)
+	{
+		models.push_back(object.model);
+	}
+
+	int refits = scene.refit_count, rebuilds = scene.rebuild_count;
+	double update_seconds = 0.0;
+	std::vector<Vertex> vertices;
+	for (int frame = 1; frame <= frame_count; frame++)
+	{
+		float phase = 2.0f * pi * float(frame) / float(frame_count);
+		for (size_t i = 0; i < scene.meshes.size(); i++)
+		{
+			if (rest[i].empty())
+			{
+				continue;
+			}
+			vertices = rest[i];
+			for (auto& vertex : vertices)
+			{
+				vertex.position += vertex.normal * (amplitude[i] * std::sin(phase + vertex.position.y / amplitude[i]));
+			}
+			scene.setVertices(int(i), vertices);
+		}
+		if (frame % 2 == 0)
+		{
+			for (size_t i = 0; i < scene.objects.size(); i += 2)
+			{
+				Matrix4f model = models[i];
+				model[3] += Vector4f{Vector3f{std::sin(phase), 0.0f, std::cos(phase)} * 0.05f, 0.0f};
+				scene.setTransform(int(i), model);
+			}
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		scene.updateBVH();
+		update_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+	float update_cost = scene.getSAHCost();
+
+	auto start = std::chrono::steady_clock::now();
+	scene.initBVH();
+	double build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::cout << "Scene: " << scene.name << " , Frames: " << frame_count << " , Meshes: " << scene.meshes.size()
+			  << " , Objects: " << scene.objects.size() << std::endl;
+	std::cout << "  Update : " << update_seconds / frame_count * 1000.0 << " ms/frame , Refits: "
+			  << scene.refit_count - refits << " , Rebuilds: " << scene.rebuild_count - rebuilds
+			  << " , SAH cost: " << update_cost << std::endl;
+	std::cout << "  Rebuild: " << build_seconds * 1000.0 << " ms , SAH cost: " << scene.getSAHCost() << std::endl;
+}
+
+void benchmarkLightSampling(PathTracingScene& scene, const int point_count, const int sample_count)
+{
+	/* The shading points, camera hits with their normal facing the camera */
+	RandomGenerator random{0};
+	std::vector<IntersectResult> points;
+	for (auto& camera_ray : generateCameraRays(scene.camera, point_count, random))
+	{
+		Ray ray = camera_ray;
+		IntersectResult hit = scene.intersect(ray);
+		if (hit.is_intersect && !scene.objects[hit.object_index].is_light)
+		{
+			hit.normal = glm::normalize(hit.normal);
+			if (glm::dot(hit.normal, ray.direction) > 0.0f)
+			{
+				hit.normal = -hit.normal;
+			}
+			points.push_back(hit);
+		}
+	}
+
+	std::cout << "Scene: " << scene.name << " , Points: " << points.size()
+			  << " , Lights: " << scene.light_emitters.size() << " , Tree nodes: " << scene.light_tree.nodes.size()
+			  << std::endl;
+
+	LightSamplerType scene_type = scene.light_sampler_type;
+	std::pair<LightSamplerType, const char*> types[] = {{LightSamplerType::Power, "Power"},
+														  {LightSamplerType::Tree, "Tree "}};
+	for (auto& [type, type_name] : types)
+	{
+		scene.light_sampler_type = type;
+
+		std::vector<LightSample> samples(size_t(sample_count) * points.size());
+		RandomGenerator sample_random{1};
+		auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < samples.size(); i++)
+		{
+			const IntersectResult& point = points[i / sample_count];
+			scene.sampleLight(samples[i], point.point, point.normal, sample_random.nextFloat(),
+							  Vector2f{sample_random.nextFloat(), sample_random.nextFloat()});
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		/* The variance of every point is relative to its squared mean, so bright and dark points count alike */
+		double relative_variance = 0.0;
+		int lit_points = 0;
+		for (size_t i = 0; i < points.size(); i++)
+		{
+			double sum = 0.0, square_sum = 0.0;
+			for (int j = 0; j < sample_count; j++)
+			{
+				const LightSample& light = samples[i * sample_count + j];
+				float cos_theta = glm::dot(points[i].normal, light.direction);
+				double estimate = 0.0;
+				if (light.pdf > 0.0f && cos_theta > 0.0f &&
+					!scene.occluded(Ray{points[i].point, light.direction}, light.distance - 0.001f))
+				{
+					estimate = glm::dot(light.radiance, Vector3f{0.2126f, 0.7152f, 0.0722f}) * cos_theta / light.pdf;
+				}
+				sum += estimate;
+				square_sum += estimate * estimate;
+			}
+
+			double mean = sum / sample_count;
+			if (mean > 0.0)
+			{
+				relative_variance += (square_sum / sample_count - mean * mean) / (mean * mean);
+				lit_points++;
+			}
+		}
+
+		std::cout << "  " << type_name << ": " << seconds * 1e9 / double(samples.size())
+				  << " ns/sample , Relative variance: " << relative_variance / std::max(lit_points, 1) << std::endl;
+	}
+	scene.light_sampler_type = scene_type;
+}
@@ -0,0 +1,121 @@
+#include <bsdf.h>
+
+namespace
+{
+template <MaterialType type>
+constexpr BSDFKernels getKernels()
+{
+	return BSDFKernels{BSDF<type>::sample, BSDF<type>::evaluate, BSDF<type>::pdf, BSDF<type>::delta};
+}
+} // namespace
+
+const std::array<BSDFKernels, 4> BSDF_KERNELS = {getKernels<MaterialType::Diffuse>(),
+												  getKernels<MaterialType::Specular>(),
+												  getKernels<MaterialType::Refraction>(),
+												  getKernels<MaterialType::Glossy>()};
+
+BSDFParameters::BSDFParameters(const Material& material)
+{
+	this->kd = material.kd;
+	this->ks = material.ks;
+	this->ns = material.ns;
+	this->ni = material.ni;
+	this->textured = material.diffuse_texture != -1;
+	this->type = material.type;
+
+	/* Glossy samples pick the lobe by its share of the luminance */
+	const Vector3f luminance{0.2126f, 0.7152f, 0.0722f};
+	float diffuse = glm::dot(material.kd, luminance);
+	float specular = glm::dot(material.ks, luminance);
+	if (diffuse + specular > 0.0f)
+	{
+		this->specular_probability = specular / (diffuse + specular);
+	}
+}
+
+Vector3f diffuseSample(const Direction& normal, const Vector2f& u)
+{
+	/* Cosine-weighted solid angle distribution */
+	float phi = 2 * pi * u.x;
+	float cos_theta = std::sqrt(u.y);
+	float sin_theta = std::sqrt(1 - u.y);
+	float x = std::cos(phi) * sin_theta;
+	float y = std::sin(phi) * sin_theta;
+	float z = cos_theta;
+
+	/* Calculate the local coordinate system */
+	Vector3f tangent, bitangent;
+	if (std::abs(normal.z) > 0.999f)
+	{
+		tangent = Vector3f(1, 0, 0);
+	}
+	else
+	{
+		tangent = glm::normalize(glm::cross(normal, Vector3f(0, 0, 1)));
+	}
+	bitangent = glm::cross(normal, tangent);
+
+	/* Transform to world coordinates */
+	return tangent * x + bitangent * y + normal * z;
+}
+
+Vector3f glossySample(const Direction& wi, const Direction& normal, const float ns, const Vector2f& u)
+{
+	// Compute the reflection direction and ensure normalization
+	Direction reflect_direction = glm::normalize(glm::reflect(wi, normal));
+
+	// Compute Phong cosine-weighted sampling
+	float exponent = std::max(ns, 0.0f); // Ensure the exponent is non-negative
+	float cos_theta = std::pow(std::max(u.x, 1e-6f), 1.0f / (exponent + 1));
+	float sin_theta = std::sqrt(1 - cos_theta * cos_theta);
+	float phi = 2.0f * pi * u.y;
+
+	// Convert to local coordinate system
+	float x = sin_theta * std::cos(phi);
+	float y = sin_theta * std::sin(phi);
+	float z = cos_theta;
+
+	// Construct an orthonormal basis around the reflection direction
+	Vector3f tangent = (std::abs(reflect_direction.z) > 0.999f) ? Vector3f(1, 0, 0)
+																: // If too close to the Z-axis, use (1,0,0) as tangent
+						   glm::normalize(glm::cross(reflect_direction, Vector3f(0, 0, 1)));
+	Vector3f bitangent = glm::normalize(glm::cross(tangent, reflect_direction));
+
+	// Transform the sampled direction from local to world space and return
+	return glm::normalize(tangent * x + bitangent * y + reflect_direction * z);
+}
+
+Vector3f refractionSample(const Direction& wi, const Direction& normal, const float ni)
+{
+	float cos_theta_i = glm::dot(-wi, normal);
+	float eta_i = 1.0f; // Refractive index of air
+	float eta_t = ni;	// Refractive Index of material
+
+	Direction n;
+	/* Determine whether the light is entering from the outside or emitting from the inside */
+	if (cos_theta_i < 0)
+	{
+		cos_theta_i = -cos_theta_i;
+		n = -normal;
+		std::swap(eta_i, eta_t);
+	}
+	else
+	{
+		n = normal;
+	}
+
+	float eta = eta_i / eta_t;
+	float sin_theta_i = std::sqrt(1.0f - cos_theta_i * cos_theta_i);
+	float sin_theta_t = eta * sin_theta_i;
+
+	/* Check for total internal reflection */
+	if (sin_theta_t >= 1.0f)
+	{
+		return glm::reflect(wi, n);
+	}
+
+	float cos_theta_t = std::sqrt(1.0f - sin_theta_t * sin_theta_t);
+
+	/* Calculating reflected light */
+	return eta * wi + (eta * cos_theta_i - cos_theta_t) * n;
+}
@@ -1 +1,284 @@
-﻿#include <bvh.h>
+﻿#include <atomic>
+
+#include <bvh.h>
+#include <wide_bvh.h>
+
+namespace
+{
+/* Depth after which splits fall back to the object median, which bounds the depth of degenerate inputs */
+constexpr int MEDIAN_SPLIT_DEPTH = MAX_TRAVERSAL_DEPTH / 2;
+
+/* Minimal inline bounds, the builder touches them too often to go through BoundingBox calls */
+struct Bounds
+{
+	Vector3f min{std::numeric_limits<float>::infinity()};
+	Vector3f max{-std::numeric_limits<float>::infinity()};
+
+	void unionBounds(const Bounds& other)
+	{
+		this->min = glm::min(this->min, other.min);
+		this->max = glm::max(this->max, other.max);
+	}
+
+	void unionPoint(const Point& point)
+	{
+		this->min = glm::min(this->min, point);
+		this->max = glm::max(this->max, point);
+	}
+
+	float getSurfaceArea() const
+	{
+		Vector3f extent = this->max - this->min;
+		if (extent.x < 0.0f || extent.y < 0.0f || extent.z < 0.0f)
+		{
+			return 0.0f;
+		}
+		return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+	}
+};
+
+struct Bin
+{
+	Bounds bounds;
+	Bounds centroid_bounds;
+	float area = 0.0f;
+	int count = 0;
+};
+
+struct BuildContext
+{
+	const BVHBuilder& builder;
+	const std::vector<float>& areas;
+	std::vector<Bounds> bounds;
+	std::vector<Point> centroids;
+	std::vector<BVH>& nodes;
+	std::vector<int>& indices;
+	std::atomic<int> node_count{1};
+};
+
+void setNode(BVH& node, const Bounds& bounds, const float area)
+{
+	node.bounding_box = BoundingBox{bounds.min, bounds.max};
+	node.area = area;
+}
+
+void makeLeaf(BVH& node, const int begin, const int end)
+{
+	node.leaf_node_flag = true;
+	node.primitive_offset = begin;
+	node.primitive_count = end - begin;
+}
+
+void buildNode(BuildContext& context,
+			   const int index,
+			   const int begin,
+			   const int end,
+			   const Bounds& bounds,
+			   const Bounds& centroid_bounds,
+			   const int depth)
+{
+	const BVHBuilder& builder = context.builder;
+	BVH& node = context.nodes[index];
+	int count = end - begin;
+
+	/* Split along the largest centroid extent */
+	Vector3f extent = centroid_bounds.max - centroid_bounds.min;
+	int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+	float axis_min = centroid_bounds.min[axis];
+
+	/* All centroids coincide, no plane can separate them */
+	if (count == 1 || !(extent[axis] > 0.0f))
+	{
+		if (count <= std::numeric_limits<uint16_t>::max())
+		{
+			makeLeaf(node, begin, end);
+			return;
+		}
+	}
+
+	int bin_count = std::max(builder.bin_count, 2);
+	std::vector<Bin> bins(bin_count);
+	float bin_scale = extent[axis] > 0.0f ? float(bin_count) / extent[axis] : 0.0f;
+	auto getBin = [&](const int primitive) {
+		int bin = int((context.centroids[primitive][axis] - axis_min) * bin_scale);
+		return std::min(std::max(bin, 0), bin_count - 1);
+	};
+
+	for (int i = begin; i < end; i++)
+	{
+		int primitive = context.indices[i];
+		Bin& bin = bins[getBin(primitive)];
+		bin.bounds.unionBounds(context.bounds[primitive]);
+		bin.centroid_bounds.unionPoint(context.centroids[primitive]);
+		bin.area += context.areas[primitive];
+		bin.count++;
+	}
+
+	/* Sweep from the right to get the cost of every candidate plane, then from the left to evaluate it */
+	std::vector<float> right_cost(bin_count, 0.0f);
+	Bounds right_bounds;
+	int right_count = 0;
+	for (int i = bin_count - 1; i > 0; i--)
+	{
+		right_bounds.unionBounds(bins[i].bounds);
+		right_count += bins[i].count;
+		right_cost[i] = right_bounds.getSurfaceArea() * float(right_count);
+	}
+
+	int best_split = -1;
+	float best_cost = std::numeric_limits<float>::infinity();
+	Bounds left_bounds;
+	int left_count = 0;
+	for (int i = 1; i < bin_count; i++)
+	{
+		left_bounds.unionBounds(bins[i - 1].bounds);
+		left_count += bins[i - 1].count;
+		if (left_count == 0 || left_count == count)
+		{
+			continue;
+		}
+
+		float cost = left_bounds.getSurfaceArea() * float(left_count) + right_cost[i];
+		if (cost < best_cost)
+		{
+			best_cost = cost;
+			best_split = i;
+		}
+	}
+
+	float node_area = bounds.getSurfaceArea();
+	float split_cost = node_area > 0.0f ? builder.traversal_cost + builder.intersection_cost * best_cost / node_area
+										: std::numeric_limits<float>::infinity();
+	float leaf_cost = builder.intersection_cost * float(count);
+	if (count <= builder.max_leaf_size && (best_split == -1 || leaf_cost <= split_cost))
+	{
+		makeLeaf(node, begin, end);
+		return;
+	}
+
+	/* Bounds of both halves, taken from the bins when the binned split is used */
+	Bounds child_bounds[2], child_centroid_bounds[2];
+	float child_area[2] = {0.0f, 0.0f};
+	int middle;
+	if (best_split != -1 && depth < MEDIAN_SPLIT_DEPTH)
+	{
+		middle = int(std::partition(context.indices.begin() + begin,
+									context.indices.begin() + end,
+									[&](const int primitive) { return getBin(primitive) < best_split; }) -
+					 context.indices.begin());
+
+		for (int i = 0; i < bin_count; i++)
+		{
+			int side = i < best_split ? 0 : 1;
+			child_bounds[side].unionBounds(bins[i].bounds);
+			child_centroid_bounds[side].unionBounds(bins[i].centroid_bounds);
+			child_area[side] += bins[i].area;
+		}
+	}
+	else
+	{
+		/* Object median, used for deep or inseparable ranges */
+		middle = begin + count / 2;
+		std::nth_element(context.indices.begin() + begin,
+						 context.indices.begin() + middle,
+						 context.indices.begin() + end,
+						 [&](const int a, const int b) { return context.centroids[a][axis] < context.centroids[b][axis]; });
+
+		for (int i = begin; i < end; i++)
+		{
+			int primitive = context.indices[i];
+			int side = i < middle ? 0 : 1;
+			child_bounds[side].unionBounds(context.bounds[primitive]);
+			child_centroid_bounds[side].unionPoint(context.centroids[primitive]);
+			child_area[side] += context.areas[primitive];
+		}
+	}
+
+	int left = context.node_count.fetch_add(2);
+	node.left = left;
+	node.right = left + 1;
+	node.leaf_node_flag = false;
+	setNode(context.nodes[left], child_bounds[0], child_area[0]);
+	setNode(context.nodes[left + 1], child_bounds[1], child_area[1]);
+
+	if (count > builder.task_threshold)
+	{
+#pragma omp task default(none) shared(context) firstprivate(left, begin, middle, child_bounds, child_centroid_bounds, depth)
+		buildNode(context, left, begin, middle, child_bounds[0], child_centroid_bounds[0], depth + 1);
+	}
+	else
+	{
+		buildNode(context, left, begin, middle, child_bounds[0], child_centroid_bounds[0], depth + 1);
+	}
+	buildNode(context, left + 1, middle, end, child_bounds[1], child_centroid_bounds[1], depth + 1);
+}
+} // namespace
+
+void BVHBuilder::build(const std::vector<BoundingBox>& boxes,
+					   const std::vector<float>& areas,
+					   std::vector<BVH>& nodes,
+					   std::vector<int>& indices) const
+{
+	int count = int(boxes.size());
+	nodes.clear();
+	indices.resize(count);
+	if (count == 0)
+	{
+		return;
+	}
+
+	BuildContext context{*this, areas, std::vector<Bounds>(count), std::vector<Point>(count), nodes, indices};
+
+	Bounds bounds, centroid_bounds;
+	float area = 0.0f;
+	for (int i = 0; i < count; i++)
+	{
+		indices[i] = i;
+		context.bounds[i].min = boxes[i].getMin();
+		context.bounds[i].max = boxes[i].getMax();
+		context.centroids[i] = (context.bounds[i].min + context.bounds[i].max) * 0.5f;
+		bounds.unionBounds(context.bounds[i]);
+		centroid_bounds.unionPoint(context.centroids[i]);
+		area += areas[i];
+	}
+
+	/* A binary tree over n primitives has at most 2n - 1 nodes */
+	nodes.resize(2 * size_t(count) - 1);
+	setNode(nodes[0], bounds, area);
+
+#pragma omp parallel if (count > this->task_threshold)
+#pragma omp single
+	buildNode(context, 0, 0, count, bounds, centroid_bounds, 0);
+
+	nodes.resize(context.node_count);
+	nodes.shrink_to_fit();
+}
+
+float BVHBuilder::getSAHCost(const std::vector<BVH>& nodes) const
+{
+	if (nodes.empty())
+	{
+		return 0.0f;
+	}
+
+	float root_area = nodes[0].bounding_box.getSurfaceArea();
+	if (root_area <= 0.0f)
+	{
+		return 0.0f;
+	}
+
+	float cost = 0.0f;
+	for (auto& node : nodes)
+	{
+		float probability = node.bounding_box.getSurfaceArea() / root_area;
+		if (node.leaf_node_flag)
+		{
+			cost += probability * this->intersection_cost * float(node.primitive_count);
+		}
+		else
+		{
+			cost += probability * this->traversal_cost;
+		}
+	}
+	return cost;
+}
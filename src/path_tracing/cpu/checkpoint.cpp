@@ -0,0 +1,104 @@
+#include <checkpoint.h>
+
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+/* "PTCK" followed by the format version, checked before anything else is read */
+constexpr uint32_t CHECKPOINT_MAGIC = 0x4b435450;
+constexpr uint32_t CHECKPOINT_VERSION = 3;
+
+template <typename T>
+void writeValue(std::ofstream& file, const T& value)
+{
+	file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+void readValue(std::ifstream& file, T& value)
+{
+	file.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+} // namespace
+
+bool RenderCheckpoint::save(const std::string& path) const
+{
+	std::string temporary_path = path + ".tmp";
+	{
+		std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			return false;
+		}
+
+		writeValue(file, CHECKPOINT_MAGIC);
+		writeValue(file, CHECKPOINT_VERSION);
+		writeValue(file, this->width);
+		writeValue(file, this->height);
+		writeValue(file, int(this->sampler_type));
+		writeValue(file, this->spp);
+		writeValue(file, this->seed);
+		writeValue(file, this->max_depth);
+		writeValue(file, this->russian_roulette_depth);
+		writeValue(file, int(this->light_sampler_type));
+		writeValue(file, this->passes);
+		writeValue(file, this->elapsed);
+
+		size_t pixel_count = size_t(this->width) * size_t(this->height);
+		file.write(reinterpret_cast<const char*>(this->sample_counts.data()), pixel_count * sizeof(uint32_t));
+		file.write(reinterpret_cast<const char*>(this->accumulation.data()), pixel_count * sizeof(Vector3f));
+		if (!file)
+		{
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary_path, path, error);
+	return !error;
+}
+
+bool RenderCheckpoint::load(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	readValue(file, magic);
+	readValue(file, version);
+	if (magic != CHECKPOINT_MAGIC || version != CHECKPOINT_VERSION)
+	{
+		return false;
+	}
+
+	int type = 0;
+	int light_type = 0;
+	readValue(file, this->width);
+	readValue(file, this->height);
+	readValue(file, type);
+	readValue(file, this->spp);
+	readValue(file, this->seed);
+	readValue(file, this->max_depth);
+	readValue(file, this->russian_roulette_depth);
+	readValue(file, light_type);
+	readValue(file, this->passes);
+	readValue(file, this->elapsed);
+	this->sampler_type = SamplerType(type);
+	this->light_sampler_type = LightSamplerType(light_type);
+	if (!file || this->width <= 0 || this->height <= 0)
+	{
+		return false;
+	}
+
+	size_t pixel_count = size_t(this->width) * size_t(this->height);
+	this->sample_counts.resize(pixel_count);
+	this->accumulation.resize(pixel_count);
+	file.read(reinterpret_cast<char*>(this->sample_counts.data()), pixel_count * sizeof(uint32_t));
+	file.read(reinterpret_cast<char*>(this->accumulation.data()), pixel_count * sizeof(Vector3f));
+	return bool(file);
+}
@@ -0,0 +1,448 @@
+#include <distributed.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifdef _WIN32
+using SocketHandle = SOCKET;
+
+void closeSocket(const SocketHandle socket)
+{
+	closesocket(socket);
+}
+
+/* Winsock has to be started once per process before the first socket call */
+void initSockets()
+{
+	static bool initialized = []() {
+		WSADATA data;
+		return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+	}();
+	(void)initialized;
+}
+#else
+using SocketHandle = int;
+
+void closeSocket(const SocketHandle socket)
+{
+	::close(socket);
+}
+
+void initSockets()
+{
+}
+#endif
+
+/*
+ * Keep-alive probes detect peers whose host died without closing the connection, and a receive timeout keeps a peer
+ * that stops in the middle of a message from blocking the other side forever
+ */
+void setSocketOptions(const SocketHandle socket, const int receive_timeout)
+{
+	int flag = 1;
+	setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&flag), sizeof(flag));
+	setsockopt(socket, SOL_SOCKET, SO_KEEPALIVE, reinterpret_cast<const char*>(&flag), sizeof(flag));
+	if (receive_timeout > 0)
+	{
+#ifdef _WIN32
+		DWORD timeout = DWORD(receive_timeout) * 1000;
+#else
+		timeval timeout{receive_timeout, 0};
+#endif
+		setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+	}
+}
+
+/* Writing to a worker that died must fail the send instead of killing the coordinator with SIGPIPE */
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+bool sendAll(const int64_t handle, const char* data, size_t size)
+{
+	while (size > 0)
+	{
+		int sent = ::send(SocketHandle(handle), data, int(std::min<size_t>(size, 1 << 30)), SEND_FLAGS);
+		if (sent <= 0)
+		{
+			return false;
+		}
+		data += sent;
+		size -= size_t(sent);
+	}
+	return true;
+}
+
+bool receiveAll(const int64_t handle, char* data, size_t size)
+{
+	while (size > 0)
+	{
+		int received = ::recv(SocketHandle(handle), data, int(std::min<size_t>(size, 1 << 30)), 0);
+		if (received <= 0)
+		{
+			return false;
+		}
+		data += received;
+		size -= size_t(received);
+	}
+	return true;
+}
+
+/* The state of one connected worker */
+struct Worker
+{
+	Connection connection;
+
+	/* The task the worker is rendering, -1 if it is idle */
+	int task{-1};
+
+	/* The time by which the task has to be returned */
+	std::chrono::steady_clock::time_point deadline;
+};
+} // namespace
+
+Connection::Connection(const int64_t handle)
+{
+	this->handle = handle;
+}
+
+Connection::Connection(Connection&& other) noexcept
+{
+	this->handle = other.handle;
+	other.handle = -1;
+}
+
+Connection& Connection::operator=(Connection&& other) noexcept
+{
+	if (this != &other)
+	{
+		this->close();
+		this->handle = other.handle;
+		other.handle = -1;
+	}
+	return *this;
+}
+
+Connection::~Connection()
+{
+	this->close();
+}
+
+bool Connection::open(const std::string& host, const int port)
+{
+	initSockets();
+	this->close();
+
+	addrinfo hints{};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* addresses = nullptr;
+	if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0)
+	{
+		return false;
+	}
+
+	for (addrinfo* address = addresses; address != nullptr; address = address->ai_next)
+	{
+		SocketHandle socket = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+		if (socket == SocketHandle(-1))
+		{
+			continue;
+		}
+		if (::connect(socket, address->ai_addr, int(address->ai_addrlen)) == 0)
+		{
+			/* Task messages are small and answered at once, so they must not wait for Nagle's algorithm; workers wait
+			   for tasks as long as the coordinator needs, so their receives have no timeout */
+			setSocketOptions(socket, 0);
+			this->handle = int64_t(socket);
+			break;
+		}
+		closeSocket(socket);
+	}
+	freeaddrinfo(addresses);
+	return this->isOpen();
+}
+
+void Connection::close()
+{
+	if (this->isOpen())
+	{
+		closeSocket(SocketHandle(this->handle));
+		this->handle = -1;
+	}
+}
+
+bool Connection::isOpen() const
+{
+	return this->handle != -1;
+}
+
+bool Connection::send(const MessageType type, const void* data, const size_t size)
+{
+	uint32_t header[2] = {uint32_t(type), uint32_t(size)};
+	bool sent = sendAll(this->handle, reinterpret_cast<const char*>(header), sizeof(header)) &&
+				sendAll(this->handle, static_cast<const char*>(data), size);
+	if (!sent)
+	{
+		this->close();
+	}
+	return sent;
+}
+
+bool Connection::receive(MessageType& type, std::vector<char>& data)
+{
+	uint32_t header[2];
+	if (!receiveAll(this->handle, reinterpret_cast<char*>(header), sizeof(header)))
+	{
+		this->close();
+		return false;
+	}
+
+	type = MessageType(header[0]);
+	data.resize(header[1]);
+	if (!receiveAll(this->handle, data.data(), data.size()))
+	{
+		this->close();
+		return false;
+	}
+	return true;
+}
+
+RenderCoordinator::~RenderCoordinator()
+{
+	if (this->listen_handle != -1)
+	{
+		closeSocket(SocketHandle(this->listen_handle));
+	}
+}
+
+bool RenderCoordinator::listen(const int port)
+{
+	initSockets();
+
+	SocketHandle socket = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (socket == SocketHandle(-1))
+	{
+		return false;
+	}
+
+	int flag = 1;
+	setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&flag), sizeof(flag));
+
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(uint16_t(port));
+	if (::bind(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(socket, 64) != 0)
+	{
+		closeSocket(socket);
+		return false;
+	}
+
+	this->listen_handle = int64_t(socket);
+	return true;
+}
+
+void RenderCoordinator::render(const RenderSettings& settings,
+							   const int tile_size,
+							   const int task_spp,
+							   std::vector<Vector3f>& frame_buffer)
+{
+	/* Split every tile into ranges of sample indices */
+	std::vector<RenderTask> tasks;
+	int samples = task_spp > 0 ? task_spp : settings.spp;
+	for (int y = 0; y < settings.height; y += tile_size)
+	{
+		for (int x = 0; x < settings.width; x += tile_size)
+		{
+			for (int sample = 0; sample < settings.spp; sample += samples)
+			{
+				RenderTask task;
+				task.index = int(tasks.size());
+				task.x_begin = x;
+				task.y_begin = y;
+				task.x_end = std::min(x + tile_size, settings.width);
+				task.y_end = std::min(y + tile_size, settings.height);
+				task.sample_begin = sample;
+				task.sample_end = std::min(sample + samples, settings.spp);
+				tasks.push_back(task);
+			}
+		}
+	}
+
+	std::deque<int> pending;
+	for (auto& task : tasks)
+	{
+		pending.push_back(task.index);
+	}
+
+	std::vector<uint8_t> completed(tasks.size(), 0);
+	std::vector<int> timeouts(tasks.size(), 0);
+	std::vector<Vector3f> accumulation(size_t(settings.width) * size_t(settings.height), Vector3f{0.0f});
+	std::vector<Worker> workers;
+	std::vector<char> message;
+	int completed_count = 0;
+
+	while (completed_count < int(tasks.size()))
+	{
+		/* Hand a pending task to every idle worker */
+		for (auto& worker : workers)
+		{
+			if (worker.task == -1 && !pending.empty() && worker.connection.isOpen())
+			{
+				/* Every time a task timed out its next worker gets twice as long */
+				int index = pending.front();
+				if (worker.connection.send(MessageType::Task, &tasks[index], sizeof(RenderTask)))
+				{
+					worker.task = index;
+					worker.deadline = std::chrono::steady_clock::now() +
+									  std::chrono::seconds(int64_t(this->task_timeout) << timeouts[index]);
+					pending.pop_front();
+				}
+			}
+		}
+
+		/* Workers that missed their deadline are presumed hung and dropped, like workers whose connection broke,
+		   and give their task back */
+		auto now = std::chrono::steady_clock::now();
+		for (auto& worker : workers)
+		{
+			if (worker.task != -1 && now > worker.deadline)
+			{
+				worker.connection.close();
+				if (++timeouts[worker.task] > this->max_task_timeouts)
+				{
+					throw std::runtime_error("A distributed task keeps timing out, task_timeout is too short!");
+				}
+			}
+			if (!worker.connection.isOpen() && worker.task != -1)
+			{
+				pending.push_front(worker.task);
+				worker.task = -1;
+				this->reissued++;
+			}
+		}
+		workers.erase(std::remove_if(workers.begin(), workers.end(),
+									 [](const Worker& worker) { return !worker.connection.isOpen(); }),
+					  workers.end());
+
+		/* Wait for new workers and results */
+		fd_set read_set;
+		FD_ZERO(&read_set);
+		FD_SET(SocketHandle(this->listen_handle), &read_set);
+		int64_t max_handle = this->listen_handle;
+		for (auto& worker : workers)
+		{
+			FD_SET(SocketHandle(worker.connection.handle), &read_set);
+			max_handle = std::max(max_handle, worker.connection.handle);
+		}
+		timeval timeout{1, 0};
+		if (select(int(max_handle + 1), &read_set, nullptr, nullptr, &timeout) <= 0)
+		{
+			continue;
+		}
+
+		if (FD_ISSET(SocketHandle(this->listen_handle), &read_set))
+		{
+			SocketHandle socket = ::accept(SocketHandle(this->listen_handle), nullptr, nullptr);
+			if (socket != SocketHandle(-1))
+			{
+				setSocketOptions(socket, this->task_timeout);
+
+				Worker worker;
+				worker.connection = Connection(int64_t(socket));
+				if (worker.connection.send(MessageType::Setup, &settings, sizeof(RenderSettings)))
+				{
+					workers.push_back(std::move(worker));
+					this->worker_count++;
+				}
+			}
+		}
+
+		for (auto& worker : workers)
+		{
+			if (!FD_ISSET(SocketHandle(worker.connection.handle), &read_set))
+			{
+				continue;
+			}
+
+			MessageType type;
+			if (!worker.connection.receive(type, message) || type != MessageType::Result ||
+				message.size() < sizeof(int32_t))
+			{
+				worker.connection.close();
+				continue;
+			}
+
+			/* Only the task the worker holds is accepted, an idle worker has none to return */
+			int32_t index;
+			std::memcpy(&index, message.data(), sizeof(int32_t));
+			if (worker.task == -1 || index < 0 || index >= int(tasks.size()) || index != worker.task)
+			{
+				worker.connection.close();
+				continue;
+			}
+
+			const RenderTask& task = tasks[index];
+			size_t pixel_count = size_t(task.x_end - task.x_begin) * size_t(task.y_end - task.y_begin);
+			if (message.size() != sizeof(int32_t) + pixel_count * sizeof(Vector3f))
+			{
+				worker.connection.close();
+				continue;
+			}
+			worker.task = -1;
+
+			/* A task is only merged once, even if it was handed out again */
+			if (completed[index] != 0)
+			{
+				continue;
+			}
+			completed[index] = 1;
+			completed_count++;
+
+			const char* data = message.data() + sizeof(int32_t);
+			for (int y = task.y_begin; y < task.y_end; y++)
+			{
+				for (int x = task.x_begin; x < task.x_end; x++)
+				{
+					Vector3f radiance;
+					std::memcpy(&radiance, data, sizeof(Vector3f));
+					accumulation[size_t(y) * settings.width + x] += radiance;
+					data += sizeof(Vector3f);
+				}
+			}
+			outputProgress(float(completed_count) / float(tasks.size()));
+		}
+	}
+
+	for (auto& worker : workers)
+	{
+		worker.connection.send(MessageType::Finish, nullptr, 0);
+	}
+
+	frame_buffer.resize(accumulation.size());
+	for (size_t i = 0; i < accumulation.size(); i++)
+	{
+		frame_buffer[i] = accumulation[i] / float(settings.spp);
+	}
+}
@@ -0,0 +1,186 @@
+#include <geometry_cache.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+std::atomic<uint64_t> next_cache_id{1};
+
+/* The page each thread used last, kept alive while the thread reads its elements */
+struct PagePin
+{
+	uint64_t cache_id{0};
+	uint64_t key{0};
+	std::shared_ptr<const std::vector<char>> page;
+};
+
+thread_local PagePin pin;
+
+uint64_t getPageKey(const int array, const int page)
+{
+	return (uint64_t(uint32_t(array)) << 32) | uint32_t(page);
+}
+
+/* Reads a range of the file at an offset, several threads may read the same handle at once */
+bool readAt(const int64_t handle, const size_t offset, void* data, const size_t size)
+{
+	char* destination = static_cast<char*>(data);
+	size_t done = 0;
+	while (done < size)
+	{
+#ifdef _WIN32
+		OVERLAPPED overlapped{};
+		overlapped.Offset = DWORD(uint64_t(offset + done) & 0xffffffffu);
+		overlapped.OffsetHigh = DWORD(uint64_t(offset + done) >> 32);
+		DWORD read = 0;
+		DWORD chunk = DWORD(std::min<size_t>(size - done, size_t(1) << 30));
+		if (!ReadFile(HANDLE(handle), destination + done, chunk, &read, &overlapped) || read == 0)
+		{
+			return false;
+		}
+#else
+		ssize_t read = pread(int(handle), destination + done, size - done, off_t(offset + done));
+		if (read <= 0)
+		{
+			return false;
+		}
+#endif
+		done += size_t(read);
+	}
+	return true;
+}
+} // namespace
+
+GeometryCache::GeometryCache(const size_t capacity)
+{
+	this->capacity = std::max(capacity, GEOMETRY_PAGE_SIZE);
+	this->id = next_cache_id++;
+}
+
+GeometryCache::~GeometryCache()
+{
+	if (this->handle != -1)
+	{
+#ifdef _WIN32
+		CloseHandle(HANDLE(this->handle));
+#else
+		::close(int(this->handle));
+#endif
+	}
+}
+
+bool GeometryCache::open(const std::string& path)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(
+		path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+#else
+	int file = ::open(path.c_str(), O_RDONLY);
+	if (file == -1)
+	{
+		return false;
+	}
+#endif
+	this->handle = int64_t(file);
+	return true;
+}
+
+int GeometryCache::addArray(const size_t offset, const int count, const size_t element_size)
+{
+	int page_elements = int(std::max<size_t>(GEOMETRY_PAGE_SIZE / element_size, 1));
+	this->arrays.push_back(GeometryArray{offset, count, element_size, page_elements});
+	return int(this->arrays.size()) - 1;
+}
+
+int GeometryCache::getCount(const int array) const
+{
+	return this->arrays[array].count;
+}
+
+void GeometryCache::outputStatistics() const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	std::cout << "Geometry cache: " << this->page_loads << " page loads, " << this->evictions << " evictions, peak "
+			  << double(this->peak_bytes) / (1024.0 * 1024.0) << " MB of " << double(this->capacity) / (1024.0 * 1024.0)
+			  << " MB resident" << std::endl;
+}
+
+const char* GeometryCache::getElement(const int array, const int index) const
+{
+	const GeometryArray& geometry = this->arrays[array];
+	int page = index / geometry.page_elements;
+	uint64_t key = getPageKey(array, page);
+	if (pin.cache_id != this->id || pin.key != key)
+	{
+		pin.page = this->getPage(array, page);
+		pin.cache_id = this->id;
+		pin.key = key;
+	}
+	return pin.page->data() + size_t(index % geometry.page_elements) * geometry.element_size;
+}
+
+std::shared_ptr<const std::vector<char>> GeometryCache::getPage(const int array, const int page) const
+{
+	uint64_t key = getPageKey(array, page);
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		auto entry = this->page_data.find(key);
+		if (entry != this->page_data.end())
+		{
+			this->pages.splice(this->pages.begin(), this->pages, entry->second.second);
+			return entry->second.first;
+		}
+	}
+
+	/* The file is read without holding the lock, so threads missing different pages read in parallel */
+	const GeometryArray& geometry = this->arrays[array];
+	int first = page * geometry.page_elements;
+	int count = std::min(geometry.page_elements, geometry.count - first);
+	auto bytes = std::make_shared<std::vector<char>>(size_t(count) * geometry.element_size);
+	if (!readAt(this->handle, geometry.offset + size_t(first) * geometry.element_size, bytes->data(), bytes->size()))
+	{
+		throw std::runtime_error("Failed to read out-of-core geometry!");
+	}
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+	auto entry = this->page_data.find(key);
+	if (entry != this->page_data.end())
+	{
+		/* Another thread read the same page meanwhile */
+		this->pages.splice(this->pages.begin(), this->pages, entry->second.second);
+		return entry->second.first;
+	}
+
+	this->pages.push_front(key);
+	this->page_data[key] = {bytes, this->pages.begin()};
+	this->resident_bytes += bytes->size();
+	this->page_loads++;
+
+	while (this->pages.size() > 1 && this->resident_bytes > this->capacity)
+	{
+		auto evicted = this->page_data.find(this->pages.back());
+		this->resident_bytes -= evicted->second.first->size();
+		this->page_data.erase(evicted);
+		this->pages.pop_back();
+		this->evictions++;
+	}
+	this->peak_bytes = std::max(this->peak_bytes, this->resident_bytes);
+	return bytes;
+}
@@ -0,0 +1,419 @@
+#include <light_tree.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+/* The number of buckets the centroids are binned into along every axis when a node is split */
+constexpr int LIGHT_TREE_BUCKETS = 12;
+
+/* The depth below which nodes are split at the median, so the bit trails fit in 64 bits */
+constexpr int LIGHT_TREE_MEDIAN_DEPTH = 40;
+
+float safeSqrt(const float value)
+{
+	return std::sqrt(std::max(value, 0.0f));
+}
+
+float safeAcos(const float value)
+{
+	return std::acos(std::clamp(value, -1.0f, 1.0f));
+}
+
+/* The cosine of max(0, a - b) from the sines and cosines of a and b */
+float cosSubClamped(const float sin_a, const float cos_a, const float sin_b, const float cos_b)
+{
+	return cos_a > cos_b ? 1.0f : cos_a * cos_b + sin_a * sin_b;
+}
+
+/* The sine of max(0, a - b) from the sines and cosines of a and b */
+float sinSubClamped(const float sin_a, const float cos_a, const float sin_b, const float cos_b)
+{
+	return cos_a > cos_b ? 0.0f : sin_a * cos_b - cos_a * sin_b;
+}
+
+/* Rotates a vector around a unit axis (Rodrigues' formula) */
+Direction rotate(const Direction& vector, const Direction& axis, const float angle)
+{
+	float cos_angle = std::cos(angle), sin_angle = std::sin(angle);
+	return vector * cos_angle + glm::cross(axis, vector) * sin_angle +
+		   axis * glm::dot(axis, vector) * (1.0f - cos_angle);
+}
+
+Point getCenter(const BoundingBox& box)
+{
+	return Point{box.x_min + box.x_max, box.y_min + box.y_max, box.z_min + box.z_max} * 0.5f;
+}
+
+/* The cost of a split side by the surface area orientation heuristic: power times the solid angle measure of the
+   emission directions times the box area, with long boxes split across their long axis penalized by Kr */
+float getSAOHCost(const LightBounds& bounds, const BoundingBox& node_box, const int axis)
+{
+	float theta_o = safeAcos(bounds.cos_theta_o), theta_e = safeAcos(bounds.cos_theta_e);
+	float theta_w = std::min(theta_o + theta_e, pi);
+	float sin_theta_o = safeSqrt(1.0f - bounds.cos_theta_o * bounds.cos_theta_o);
+	float m_omega = 2.0f * pi * (1.0f - bounds.cos_theta_o) +
+					pi / 2.0f *
+						(2.0f * theta_w * sin_theta_o - std::cos(theta_o - 2.0f * theta_w) -
+						 2.0f * theta_o * sin_theta_o + bounds.cos_theta_o);
+
+	Vector3f diagonal = node_box.getMax() - node_box.getMin();
+	float kr = std::max(diagonal.x, std::max(diagonal.y, diagonal.z)) / diagonal[axis];
+	return bounds.power * m_omega * kr * bounds.bounding_box.getSurfaceArea();
+}
+
+/* Picks the second child with a probability, remapping the sample so it can be used again below */
+bool pickSecond(const float probability_first, float& u)
+{
+	if (u < probability_first)
+	{
+		u = std::min(u / probability_first, 0.99999994f);
+		return false;
+	}
+	u = std::min((u - probability_first) / (1.0f - probability_first), 0.99999994f);
+	return true;
+}
+} // namespace
+
+float LightBounds::getImportance(const Point& point, const Direction& normal) const
+{
+	if (this->power == 0.0f)
+	{
+		return 0.0f;
+	}
+
+	/* The distance to the center is clamped to the bounding sphere, points close to or inside the bounds see every
+	   light at the smallest possible distance */
+	const BoundingBox& box = this->bounding_box;
+	Point center = getCenter(box);
+	Vector3f half_diagonal = Point{box.x_max, box.y_max, box.z_max} - center;
+	float radius_squared = glm::dot(half_diagonal, half_diagonal);
+	Vector3f to_point = point - center;
+	float distance_squared = glm::dot(to_point, to_point);
+	float clamped_distance_squared = std::max(distance_squared, radius_squared);
+
+	Direction wi = distance_squared > 0.0f ? to_point * (1.0f / std::sqrt(distance_squared)) : Direction{0.0f};
+	float cos_theta_w = glm::dot(this->axis, wi);
+	float sin_theta_w = safeSqrt(1.0f - cos_theta_w * cos_theta_w);
+
+	/* The cone of directions from the point to the bounding sphere */
+	float cos_theta_b = -1.0f, sin_theta_b = 0.0f;
+	if (distance_squared > radius_squared)
+	{
+		float sin_squared_theta_b = radius_squared / distance_squared;
+		cos_theta_b = std::sqrt(1.0f - sin_squared_theta_b);
+		sin_theta_b = std::sqrt(sin_squared_theta_b);
+	}
+
+	/* The smallest angle between the point and any emitter normal, reduced by the extent of the bounds */
+	float sin_theta_o = safeSqrt(1.0f - this->cos_theta_o * this->cos_theta_o);
+	float cos_theta_x = cosSubClamped(sin_theta_w, cos_theta_w, sin_theta_o, this->cos_theta_o);
+	float sin_theta_x = sinSubClamped(sin_theta_w, cos_theta_w, sin_theta_o, this->cos_theta_o);
+	float cos_theta_p = cosSubClamped(sin_theta_x, cos_theta_x, sin_theta_b, cos_theta_b);
+	if (cos_theta_p <= this->cos_theta_e)
+	{
+		return 0.0f;
+	}
+
+	float importance = this->power * cos_theta_p / clamped_distance_squared;
+
+	/* The smallest angle between the receiver normal and the directions to the bounds, either side of the surface */
+	if (normal != Direction{0.0f})
+	{
+		float cos_theta_i = std::abs(glm::dot(wi, normal));
+		float sin_theta_i = safeSqrt(1.0f - cos_theta_i * cos_theta_i);
+		importance *= cosSubClamped(sin_theta_i, cos_theta_i, sin_theta_b, cos_theta_b);
+	}
+	return std::max(importance, 0.0f);
+}
+
+void LightBounds::unionBounds(const LightBounds& other)
+{
+	if (other.power == 0.0f)
+	{
+		return;
+	}
+	if (this->power == 0.0f)
+	{
+		*this = other;
+		return;
+	}
+
+	this->bounding_box.unionBox(other.bounding_box);
+	this->power += other.power;
+	this->cos_theta_e = std::min(this->cos_theta_e, other.cos_theta_e);
+
+	/* The smallest cone around both normal cones, one of them may already contain the other */
+	float theta_a = safeAcos(this->cos_theta_o), theta_b = safeAcos(other.cos_theta_o);
+	float theta_d = safeAcos(glm::dot(this->axis, other.axis));
+	if (std::min(theta_d + theta_b, pi) <= theta_a)
+	{
+		return;
+	}
+	if (std::min(theta_d + theta_a, pi) <= theta_b)
+	{
+		this->axis = other.axis;
+		this->cos_theta_o = other.cos_theta_o;
+		return;
+	}
+
+	float theta_o = (theta_a + theta_d + theta_b) / 2.0f;
+	Direction rotation_axis = glm::cross(this->axis, other.axis);
+	if (theta_o >= pi || glm::dot(rotation_axis, rotation_axis) == 0.0f)
+	{
+		this->cos_theta_o = -1.0f;
+		return;
+	}
+	this->axis = glm::normalize(rotate(this->axis, glm::normalize(rotation_axis), theta_o - theta_a));
+	this->cos_theta_o = std::cos(theta_o);
+}
+
+void LightTree::build(const std::vector<LightBounds>& lights, const int infinite_count)
+{
+	this->nodes.clear();
+	this->bit_trails.assign(lights.size(), 0);
+	this->infinite_count = infinite_count;
+	this->infinite_powers.clear();
+	for (int i = int(lights.size()) - infinite_count; i < int(lights.size()); i++)
+	{
+		this->infinite_powers.push_back(lights[i].power);
+	}
+
+	std::vector<std::pair<int, LightBounds>> tree_lights;
+	for (int i = 0; i < int(lights.size()) - infinite_count; i++)
+	{
+		if (lights[i].power > 0.0f)
+		{
+			tree_lights.emplace_back(i, lights[i]);
+		}
+	}
+	if (!tree_lights.empty())
+	{
+		this->buildTree(tree_lights, 0, int(tree_lights.size()), 0, 0);
+	}
+}
+
+LightBounds LightTree::buildTree(std::vector<std::pair<int, LightBounds>>& lights, const int start, const int end,
+								 const uint64_t bit_trail, const int depth)
+{
+	if (end - start == 1)
+	{
+		LightTreeNode leaf;
+		leaf.bounds = lights[start].second;
+		leaf.child_or_light = lights[start].first;
+		leaf.leaf_node_flag = true;
+		this->nodes.push_back(leaf);
+		this->bit_trails[lights[start].first] = bit_trail;
+		return leaf.bounds;
+	}
+
+	BoundingBox bounding_box, centroid_box;
+	for (int i = start; i < end; i++)
+	{
+		bounding_box.unionBox(lights[i].second.bounding_box);
+		centroid_box.unionPoint(getCenter(lights[i].second.bounding_box));
+	}
+
+	/* Bin the lights by centroid and evaluate the split after every bucket on every axis */
+	float min_cost = std::numeric_limits<float>::infinity();
+	int min_bucket = -1, min_axis = -1;
+	Point centroid_min = centroid_box.getMin(), centroid_max = centroid_box.getMax();
+	auto getBucket = [&](const LightBounds& bounds, const int axis) {
+		float offset = (getCenter(bounds.bounding_box)[axis] - centroid_min[axis]) /
+					   (centroid_max[axis] - centroid_min[axis]);
+		return std::clamp(int(offset * LIGHT_TREE_BUCKETS), 0, LIGHT_TREE_BUCKETS - 1);
+	};
+	for (int axis = 0; depth < LIGHT_TREE_MEDIAN_DEPTH && axis < 3; axis++)
+	{
+		if (centroid_max[axis] == centroid_min[axis])
+		{
+			continue;
+		}
+
+		LightBounds buckets[LIGHT_TREE_BUCKETS];
+		for (int i = start; i < end; i++)
+		{
+			buckets[getBucket(lights[i].second, axis)].unionBounds(lights[i].second);
+		}
+
+		for (int split = 0; split < LIGHT_TREE_BUCKETS - 1; split++)
+		{
+			LightBounds below, above;
+			for (int i = 0; i <= split; i++)
+			{
+				below.unionBounds(buckets[i]);
+			}
+			for (int i = split + 1; i < LIGHT_TREE_BUCKETS; i++)
+			{
+				above.unionBounds(buckets[i]);
+			}
+
+			float cost = getSAOHCost(below, bounding_box, axis) + getSAOHCost(above, bounding_box, axis);
+			if (cost < min_cost)
+			{
+				min_cost = cost;
+				min_bucket = split;
+				min_axis = axis;
+			}
+		}
+	}
+
+	int middle = (start + end) / 2;
+	if (min_axis != -1)
+	{
+		auto split = std::partition(lights.begin() + start, lights.begin() + end, [&](const auto& light) {
+			return getBucket(light.second, min_axis) <= min_bucket;
+		});
+		int split_index = int(split - lights.begin());
+		if (split_index != start && split_index != end)
+		{
+			middle = split_index;
+		}
+	}
+
+	int index = int(this->nodes.size());
+	this->nodes.emplace_back();
+	LightBounds bounds = this->buildTree(lights, start, middle, bit_trail, depth + 1);
+	this->nodes[index].child_or_light = int(this->nodes.size());
+	bounds.unionBounds(this->buildTree(lights, middle, end, bit_trail | (uint64_t(1) << depth), depth + 1));
+	this->nodes[index].bounds = bounds;
+	return bounds;
+}
+
+float LightTree::getInfiniteProbability() const
+{
+	/* The infinite lights are weighed against the tree by power, the root bounds hold the power of all its lights */
+	float infinite_power = this->getInfinitePower();
+	float total_power = infinite_power + (this->nodes.empty() ? 0.0f : this->nodes[0].bounds.power);
+	return total_power > 0.0f ? infinite_power / total_power : 0.0f;
+}
+
+float LightTree::getInfinitePower() const
+{
+	float power = 0.0f;
+	for (auto& infinite_power : this->infinite_powers)
+	{
+		power += infinite_power;
+	}
+	return power;
+}
+
+int LightTree::sample(const Point& point, const Direction& normal, float u, float& pmf) const
+{
+	float infinite_probability = this->getInfiniteProbability();
+	if (!pickSecond(infinite_probability, u))
+	{
+		/* The remapped sample picks an infinite light by its share of their power, lights without power never */
+		float infinite_power = this->getInfinitePower();
+		float remaining = u * infinite_power;
+		int light = -1;
+		for (int i = 0; i < this->infinite_count; i++)
+		{
+			if (this->infinite_powers[i] > 0.0f)
+			{
+				light = i;
+				if (remaining < this->infinite_powers[i])
+				{
+					break;
+				}
+			}
+			remaining -= this->infinite_powers[i];
+		}
+		pmf = infinite_probability * this->infinite_powers[light] / infinite_power;
+		return int(this->bit_trails.size()) - this->infinite_count + light;
+	}
+
+	pmf = 1.0f - infinite_probability;
+	if (this->nodes.empty())
+	{
+		return -1;
+	}
+
+	int index = 0;
+	while (!this->nodes[index].leaf_node_flag)
+	{
+		const LightTreeNode& node = this->nodes[index];
+		float first = this->nodes[index + 1].bounds.getImportance(point, normal);
+		float second = this->nodes[node.child_or_light].bounds.getImportance(point, normal);
+		if (first + second == 0.0f)
+		{
+			return -1;
+		}
+
+		float probability_first = first / (first + second);
+		if (pickSecond(probability_first, u))
+		{
+			pmf *= 1.0f - probability_first;
+			index = node.child_or_light;
+		}
+		else
+		{
+			pmf *= probability_first;
+			index = index + 1;
+		}
+	}
+
+	/* A single light is only sampled if it reaches the point, deeper leaves were checked by their parent */
+	if (index == 0 && this->nodes[0].bounds.getImportance(point, normal) == 0.0f)
+	{
+		return -1;
+	}
+	return this->nodes[index].child_or_light;
+}
+
+float LightTree::getPMF(const Point& point, const Direction& normal, const int light) const
+{
+	float infinite_probability = this->getInfiniteProbability();
+	int first_infinite = int(this->bit_trails.size()) - this->infinite_count;
+	if (light >= first_infinite)
+	{
+		float infinite_power = this->getInfinitePower();
+		if (infinite_power == 0.0f)
+		{
+			return 0.0f;
+		}
+		return infinite_probability * this->infinite_powers[light - first_infinite] / infinite_power;
+	}
+	if (this->nodes.empty())
+	{
+		return 0.0f;
+	}
+
+	uint64_t bit_trail = this->bit_trails[light];
+	float pmf = 1.0f - infinite_probability;
+	int index = 0;
+	while (!this->nodes[index].leaf_node_flag)
+	{
+		const LightTreeNode& node = this->nodes[index];
+		float first = this->nodes[index + 1].bounds.getImportance(point, normal);
+		float second = this->nodes[node.child_or_light].bounds.getImportance(point, normal);
+		if (first + second == 0.0f)
+		{
+			return 0.0f;
+		}
+
+		if (bit_trail & 1)
+		{
+			pmf *= second / (first + second);
+			index = node.child_or_light;
+		}
+		else
+		{
+			pmf *= first / (first + second);
+			index = index + 1;
+		}
+		bit_trail >>= 1;
+	}
+
+	if (this->nodes[index].child_or_light != light)
+	{
+		return 0.0f;
+	}
+	if (index == 0 && this->nodes[0].bounds.getImportance(point, normal) == 0.0f)
+	{
+		return 0.0f;
+	}
+	return pmf;
+}
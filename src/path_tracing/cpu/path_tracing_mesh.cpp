@@ -0,0 +1,218 @@
+#include <path_tracing_mesh.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+PathTracingMesh::PathTracingMesh(Object& object)
+{
+	this->vertices = std::move(object.vertices);
+	this->indices = std::move(object.indices);
+
+	this->triangles.reserve(this->indices.size() / 3);
+	for (size_t i = 0; i + 2 < this->indices.size(); i += 3)
+	{
+		auto& vertex1 = this->vertices[this->indices[i + 0]];
+		auto& vertex2 = this->vertices[this->indices[i + 1]];
+		auto& vertex3 = this->vertices[this->indices[i + 2]];
+
+		this->triangles.emplace_back(vertex1, vertex2, vertex3);
+		this->bounding_box.unionBox(this->triangles.back().getBoundingBox());
+		this->area += this->triangles.back().getArea();
+	}
+}
+
+void PathTracingMesh::initBVH(const BVHBuilder& builder)
+{
+	std::vector<BoundingBox> boxes(this->triangles.size());
+	std::vector<float> areas(this->triangles.size());
+	for (int i = 0; i < int(this->triangles.size()); i++)
+	{
+		boxes[i] = this->triangles[i].getBoundingBox();
+		areas[i] = this->triangles[i].getArea();
+	}
+
+	builder.build(boxes, areas, this->bvh, this->triangle_indices);
+	this->sah_cost = builder.getSAHCost(this->bvh);
+	this->build_sah_cost = this->sah_cost;
+
+	/* Store the triangles in leaf order, the leaves then reference consecutive triangles */
+	std::vector<TriangleRecord> triangles(this->triangles.size());
+	std::vector<Index> indices(this->indices.size());
+	for (size_t i = 0; i < this->triangle_indices.size(); i++)
+	{
+		int triangle = this->triangle_indices[i];
+		triangles[i] = this->triangles[triangle];
+		std::copy_n(this->indices.begin() + 3 * size_t(triangle), 3, indices.begin() + 3 * i);
+		this->triangle_indices[i] = int(i);
+	}
+	this->triangles.swap(triangles);
+
+	/* Number the vertices in the order the leaves first use them, so the corners shaded together share cache lines */
+	std::vector<Index> vertex_order(this->vertices.size(), -1);
+	std::vector<Vertex> vertices;
+	vertices.reserve(this->vertices.size());
+	for (auto& index : indices)
+	{
+		if (vertex_order[index] == -1)
+		{
+			vertex_order[index] = Index(vertices.size());
+			vertices.push_back(this->vertices[index]);
+		}
+		index = vertex_order[index];
+	}
+	this->vertices.swap(vertices);
+	this->indices.swap(indices);
+
+	/* A rebuild renumbers the vertices again, the source vertices follow them */
+	if (this->vertex_index.empty())
+	{
+		this->vertex_index.swap(vertex_order);
+	}
+	else
+	{
+		for (auto& index : this->vertex_index)
+		{
+			index = index == -1 ? -1 : vertex_order[index];
+		}
+	}
+
+	this->wide_bvh.build(this->bvh, [&](const BVH& node, std::vector<int>& primitives) {
+		auto begin = this->triangle_indices.begin() + node.primitive_offset;
+		primitives.insert(primitives.end(), begin, begin + node.primitive_count);
+	});
+
+	if (!this->triangle_table.empty())
+	{
+		this->initTriangleTable();
+	}
+}
+
+void PathTracingMesh::setVertices(const std::vector<Vertex>& vertices)
+{
+	if (this->geometry_cache != nullptr)
+	{
+		throw std::runtime_error("Out-of-core meshes cannot be updated!");
+	}
+	if (vertices.size() != this->vertex_index.size())
+	{
+		throw std::runtime_error("The vertex count of a mesh cannot change!");
+	}
+
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		if (this->vertex_index[i] != -1)
+		{
+			this->vertices[this->vertex_index[i]] = vertices[i];
+		}
+	}
+
+	for (size_t i = 0; i < this->triangles.size(); i++)
+	{
+		const Index* corner = &this->indices[3 * i];
+		this->triangles[i] =
+			TriangleRecord(this->vertices[corner[0]], this->vertices[corner[1]], this->vertices[corner[2]]);
+	}
+}
+
+void PathTracingMesh::refit(const BVHBuilder& builder)
+{
+	if (this->bvh.empty())
+	{
+		return;
+	}
+
+	refitBVH(this->bvh, [&](BVH& node) {
+		node.bounding_box = BoundingBox{};
+		node.area = 0.0f;
+		for (int i = 0; i < node.primitive_count; i++)
+		{
+			const TriangleRecord& triangle = this->getTriangle(this->triangle_indices[node.primitive_offset + i]);
+			node.bounding_box.unionBox(triangle.getBoundingBox());
+			node.area += triangle.getArea();
+		}
+	});
+	this->bounding_box = this->bvh[0].bounding_box;
+	this->area = this->bvh[0].area;
+	this->sah_cost = builder.getSAHCost(this->bvh);
+
+	this->wide_bvh.build(this->bvh, [&](const BVH& node, std::vector<int>& primitives) {
+		auto begin = this->triangle_indices.begin() + node.primitive_offset;
+		primitives.insert(primitives.end(), begin, begin + node.primitive_count);
+	});
+
+	if (!this->triangle_table.empty())
+	{
+		this->initTriangleTable();
+	}
+}
+
+void PathTracingMesh::initTriangleTable()
+{
+	std::vector<float> areas(this->getTriangleCount());
+	for (int i = 0; i < int(areas.size()); i++)
+	{
+		areas[i] = this->getTriangle(i).getArea();
+	}
+	this->triangle_table.build(areas);
+}
+
+int PathTracingMesh::intersect(Ray& ray, float hit[4]) const
+{
+	int hit_index = -1;
+	this->wide_bvh.intersect(ray, [&](const int index) {
+		float result[4];
+		if (ray.intersectTriangle(this->getTriangle(index), result) && result[3] < ray.t)
+		{
+			ray.t = result[3];
+			hit_index = index;
+			std::copy(result, result + 4, hit);
+			return true;
+		}
+		return false;
+	});
+	return hit_index;
+}
+
+bool PathTracingMesh::occluded(const Ray& ray, const float t_max) const
+{
+	Ray shadow_ray = ray;
+	shadow_ray.t = t_max;
+	return this->wide_bvh.occluded(shadow_ray, [&](const int index) {
+		float result[4];
+		return ray.intersectTriangle(this->getTriangle(index), result) && result[3] < t_max;
+	});
+}
+
+int PathTracingMesh::intersect8(RayPacket& packet, const int mask, PacketHit& hit) const
+{
+	return this->wide_bvh.intersect(packet, mask, [&](const int index, const int lanes) {
+		alignas(32) float result[4][PACKET_SIZE];
+		int hit_lanes = packet.intersectTriangle(this->getTriangle(index), lanes, result);
+		for (int lane = 0; lane < PACKET_SIZE; lane++)
+		{
+			if ((hit_lanes >> lane) & 1)
+			{
+				packet.t[lane] = result[3][lane];
+				hit.barycentric[0][lane] = result[0][lane];
+				hit.barycentric[1][lane] = result[1][lane];
+				hit.barycentric[2][lane] = result[2][lane];
+				hit.primitive[lane] = index;
+			}
+		}
+		return hit_lanes;
+	});
+}
+
+int PathTracingMesh::sample(IntersectResult& result, float& pdf, const float u, const Vector2f& u_point) const
+{
+	float pmf, u_triangle;
+	int triangle_index = this->triangle_table.sample(u, pmf, u_triangle);
+
+	auto& triangle = this->getTriangle(triangle_index);
+	triangle.sample(result.point, pdf, u_point);
+	result.normal = triangle.normal;
+
+	/* The triangle is picked with probability proportional to its area, so the density is uniform over the mesh */
+	pdf *= pmf;
+	return triangle_index;
+}
@@ -1,201 +1,243 @@
 #include <path_tracing_object.h>
 
-bool sortByX(const Triangle& triangle1, const Triangle& triangle2)
-{
-	return triangle1.bounding_box.getMin().x < triangle2.bounding_box.getMin().x;
-}
+#include <cmath>
 
-bool sortByY(const Triangle& triangle1, const Triangle& triangle2)
+PathTracingObject::PathTracingObject(const Object& object, std::shared_ptr<PathTracingMesh> geometry)
 {
-	return triangle1.bounding_box.getMin().y < triangle2.bounding_box.getMin().y;
+	this->name = object.name;
+	this->is_light = object.is_light;
+	this->radiance = object.radiance;
+	this->geometry = std::move(geometry);
+	this->setModel(object.model);
 }
 
-bool sortByZ(const Triangle& triangle1, const Triangle& triangle2)
+void PathTracingObject::setModel(const Matrix4f& model)
 {
-	return triangle1.bounding_box.getMin().z < triangle2.bounding_box.getMin().z;
-}
+	this->model = model;
+	this->transformed = this->model != Matrix4f{1.0f};
+	if (!this->transformed)
+	{
+		this->inverse_model = Matrix4f{1.0f};
+		this->normal_model = Matrix3f{1.0f};
+		this->bounding_box = this->geometry->bounding_box;
+		this->area = this->geometry->area;
+		return;
+	}
 
-PathTracingObject::PathTracingObject(Object& object)
-{
-	this->name = std::move(object.name);
-	this->mesh = std::move(object.mesh);
-
-	this->material = object.material;
-	this->bounding_box = std::move(object.bounding_box);
-	this->area = std::move(object.area);
-	this->is_light = std::move(object.is_light);
-	this->radiance = std::move(object.radiance);
-}
+	this->inverse_model = glm::inverse(this->model);
+	this->normal_model = glm::transpose(glm::inverse(Matrix3f{this->model}));
 
-void PathTracingObject::initBVH()
-{
-	BVH bvh_node;
-	this->bvh.clear();
-	this->bvh.push_back(bvh_node);
-	this->bvh[0].area = this->area;
-	this->buildBVH(0, this->mesh, this->bounding_box);
-}
-
-void PathTracingObject::buildBVH(const int index, std::vector<Triangle>& triangles, const BoundingBox& bounding_box)
-{
-	this->bvh[index].bounding_box = bounding_box;
+	/* The world space box bounds the eight transformed corners of the object space box */
+	this->bounding_box = BoundingBox{};
+	if (this->geometry->getTriangleCount() > 0)
+	{
+		Point corners[2] = {this->geometry->bounding_box.getMin(), this->geometry->bounding_box.getMax()};
+		for (int i = 0; i < 8; i++)
+		{
+			Point corner{corners[i & 1].x, corners[(i >> 1) & 1].y, corners[(i >> 2) & 1].z};
+			this->bounding_box.unionPoint(Point{this->model * Vector4f{corner, 1.0f}});
+		}
+	}
 
-	if (triangles.size() == 1)
+	Matrix3f linear{this->model};
+	if (this->is_light)
 	{
-		this->bvh[index].triangle = triangles[0];
-		this->bvh[index].leaf_node_flag = true;
-		this->bvh[index].area = triangles[0].area;
-		return;
+		this->area = 0.0f;
+		for (int i = 0; i < this->geometry->getTriangleCount(); i++)
+		{
+			const TriangleRecord& triangle = this->geometry->getTriangle(i);
+			this->area += glm::length(glm::cross(linear * triangle.edge1, linear * triangle.edge2)) * 0.5f;
+		}
 	}
 	else
 	{
-		this->bvh[index].leaf_node_flag = false;
+		this->area = this->geometry->area * std::pow(std::abs(glm::determinant(linear)), 2.0f / 3.0f);
 	}
+}
 
-	BVH left_node;
-	this->bvh.push_back(left_node);
-	this->bvh[index].left = int(this->bvh.size()) - 1;
-
-	BVH right_node;
-	this->bvh.push_back(right_node);
-	this->bvh[index].right = int(this->bvh.size()) - 1;
+Ray PathTracingObject::toObject(const Ray& ray) const
+{
+	Ray object_ray{Point{this->inverse_model * Vector4f{ray.origin, 1.0f}},
+				   Direction{this->inverse_model * Vector4f{ray.direction, 0.0f}}};
+	object_ray.t = ray.t;
+	return object_ray;
+}
 
-	if (triangles.size() == 2)
+RayPacket PathTracingObject::toObject(const RayPacket& packet, const int mask) const
+{
+	RayPacket object_packet = packet;
+	for (int lane = 0; lane < PACKET_SIZE; lane++)
 	{
-		std::vector<Triangle> temp;
-		temp.push_back(triangles[0]);
-		buildBVH(this->bvh[index].left, temp, triangles[0].getBoundingBox());
-
-		temp.clear();
-		temp.push_back(triangles[1]);
-		buildBVH(this->bvh[index].right, temp, triangles[1].getBoundingBox());
-		return;
+		if ((mask >> lane) & 1)
+		{
+			object_packet.setRay(lane, this->toObject(packet.getRay(lane)));
+		}
 	}
+	return object_packet;
+}
 
-	float x_length = bounding_box.getLengthX();
-	float y_length = bounding_box.getLengthY();
-	float z_length = bounding_box.getLengthZ();
-
-	if (x_length > y_length && x_length > z_length)
-	{
-		std::sort(triangles.begin(), triangles.end(), sortByX);
-	}
-	else if (y_length > x_length && y_length > z_length)
+IntersectResult PathTracingObject::intersect(Ray& ray) const
+{
+	float hit[4];
+	int hit_index = -1;
+	if (this->transformed)
 	{
-		std::sort(triangles.begin(), triangles.end(), sortByY);
+		Ray object_ray = this->toObject(ray);
+		hit_index = this->geometry->intersect(object_ray, hit);
+		ray.t = object_ray.t;
 	}
 	else
 	{
-		std::sort(triangles.begin(), triangles.end(), sortByZ);
+		hit_index = this->geometry->intersect(ray, hit);
 	}
 
-	int middle = triangles.size() / 2;
-	std::vector<Triangle> left_triangles(triangles.begin(), triangles.begin() + middle);
-	std::vector<Triangle> right_triangles(triangles.begin() + middle, triangles.end());
-
-	BoundingBox left_bounding_box{}, right_bounding_box{};
-	float left_area = 0.0f, right_area = 0.0f;
-	for (auto& triangle : left_triangles)
-	{
-		left_bounding_box.unionBox(triangle.getBoundingBox());
-		left_area += triangle.area;
-	}
-	for (auto& triangle : right_triangles)
+	if (hit_index == -1)
 	{
-		right_bounding_box.unionBox(triangle.getBoundingBox());
-		right_area += triangle.area;
+		return IntersectResult{};
 	}
-
-	this->bvh[this->bvh[index].left].area = left_area;
-	this->bvh[this->bvh[index].right].area = right_area;
-
-	buildBVH(this->bvh[index].left, left_triangles, left_bounding_box);
-	buildBVH(this->bvh[index].right, right_triangles, right_bounding_box);
-
-	return;
+	return this->getIntersectResult(ray, hit_index, hit);
 }
 
-IntersectResult PathTracingObject::intersect(Ray& ray) const
+bool PathTracingObject::occluded(const Ray& ray, const float t_max) const
 {
-	return this->traverse(0, ray);
+	return this->transformed ? this->geometry->occluded(this->toObject(ray), t_max)
+							 : this->geometry->occluded(ray, t_max);
 }
 
-IntersectResult PathTracingObject::traverse(const int index, Ray& ray) const
+int PathTracingObject::intersect8(RayPacket& packet, const int mask, PacketHit& hit) const
 {
-	auto& root = this->bvh[index];
-	auto bounding_box = root.bounding_box;
-	IntersectResult intersect_result;
-	if (ray.intersectBoundingBox(bounding_box))
+	if (!this->transformed)
+	{
+		return this->geometry->intersect8(packet, mask, hit);
+	}
+
+	RayPacket object_packet = this->toObject(packet, mask);
+	int hit_lanes = this->geometry->intersect8(object_packet, mask, hit);
+	for (int lane = 0; lane < PACKET_SIZE; lane++)
 	{
-		if (!root.leaf_node_flag)
+		if ((hit_lanes >> lane) & 1)
 		{
-			auto temp_result1 = this->traverse(root.left, ray);
-			auto temp_result2 = this->traverse(root.right, ray);
-			intersect_result = temp_result1.t < temp_result2.t ? temp_result1 : temp_result2;
+			packet.t[lane] = object_packet.t[lane];
 		}
-		else
+	}
+	return hit_lanes;
+}
+
+IntersectResult PathTracingObject::getIntersectResult(const Ray& ray, const int index, const float hit[4]) const
+{
+	IntersectResult intersect_result;
+	intersect_result.is_intersect = true;
+	auto b1 = hit[0];
+	auto b2 = hit[1];
+	auto b3 = hit[2];
+
+	auto interpolate = [&](const Vertex& vertex1, const Vertex& vertex2, const Vertex& vertex3) {
+		if (this->material.diffuse_texture != -1)
 		{
-			auto triangle = root.triangle;
-			float result[4];
-			if (ray.intersectTriangle(triangle, result))
-			{
-				intersect_result.is_intersect = true;
-				auto b1 = result[0];
-				auto b2 = result[1];
-				auto b3 = result[2];
-
-				if (this->material.diffuse_texture != -1)
-				{
-					Coordinate2D coordinate =
-						triangle.vertex1.texture * b1 + triangle.vertex2.texture * b2 + triangle.vertex3.texture * b3;
-					intersect_result.uv = Coordinate2D(coordinate.x, coordinate.y);
-				}
-
-				intersect_result.normal =
-					triangle.vertex1.normal * b1 + triangle.vertex2.normal * b2 + triangle.vertex3.normal * b3;
-
-				intersect_result.t = result[3];
-				ray.t = std::min(intersect_result.t, ray.t);
-				intersect_result.point = ray.spread(intersect_result.t);
-				intersect_result.ray = ray;
-			}
+			Coordinate2D coordinate = vertex1.texture * b1 + vertex2.texture * b2 + vertex3.texture * b3;
+			intersect_result.uv = Coordinate2D(coordinate.x, coordinate.y);
 		}
+		intersect_result.normal = vertex1.normal * b1 + vertex2.normal * b2 + vertex3.normal * b3;
+	};
+
+	const PathTracingMesh& mesh = *this->geometry;
+	if (mesh.geometry_cache == nullptr)
+	{
+		const Index* corner = &mesh.indices[3 * size_t(index)];
+		interpolate(mesh.vertices[corner[0]], mesh.vertices[corner[1]], mesh.vertices[corner[2]]);
+	}
+	else
+	{
+		/* Out-of-core vertices are copied, a reference into the geometry cache is invalidated by the next read */
+		interpolate(mesh.getVertex(index, 0), mesh.getVertex(index, 1), mesh.getVertex(index, 2));
+	}
+
+	if (this->transformed)
+	{
+		intersect_result.normal = glm::normalize(this->normal_model * intersect_result.normal);
 	}
 
+	/* The object space ray shares the distance of the world space ray, so the point is found along the latter */
+	intersect_result.t = hit[3];
+	intersect_result.point = ray.spread(intersect_result.t);
+	intersect_result.triangle_index = index;
+	intersect_result.ray = ray;
 	return intersect_result;
 }
 
-void PathTracingObject::sample(IntersectResult& result, float& pdf)
+void PathTracingObject::sample(IntersectResult& result, float& pdf, const float u, const Vector2f& u_point) const
 {
-	auto& root = this->bvh[0];
-	float p = getRandomNumber(0.0f, 1.0f) * root.area;
-	this->traverse(0, p, result, pdf);
-	pdf /= root.area;
-	return;
+	int triangle_index = this->geometry->sample(result, pdf, u, u_point);
+	if (!this->transformed)
+	{
+		return;
+	}
+
+	/* The triangle keeps its selection probability, its point density changes with the area scale of the triangle */
+	TriangleRecord triangle = this->geometry->getTriangle(triangle_index);
+	Matrix3f linear{this->model};
+	float world_area = glm::length(glm::cross(linear * triangle.edge1, linear * triangle.edge2)) * 0.5f;
+	pdf *= triangle.getArea() / world_area;
+
+	result.point = Point{this->model * Vector4f{result.point, 1.0f}};
+	result.normal = glm::normalize(this->normal_model * result.normal);
 }
 
-void PathTracingObject::traverse(const int index, float p, IntersectResult& result, float& pdf)
+float PathTracingObject::getTriangleArea(const int index, Direction& normal) const
 {
-	auto& root = this->bvh[index];
-	if (root.leaf_node_flag)
+	TriangleRecord triangle = this->geometry->getTriangle(index);
+	normal = triangle.normal;
+	if (!this->transformed)
 	{
-		Point sample_point;
-
-		root.triangle.sample(sample_point, pdf);
+		return triangle.getArea();
+	}
 
-		result.point = sample_point;
-		result.normal = root.triangle.normal;
-		pdf *= root.area;
+	Matrix3f linear{this->model};
+	normal = glm::normalize(this->normal_model * normal);
+	return glm::length(glm::cross(linear * triangle.edge1, linear * triangle.edge2)) * 0.5f;
+}
 
+void PathTracingObject::sampleTriangle(const int index, IntersectResult& result, float& pdf,
+									   const Vector2f& u_point) const
+{
+	TriangleRecord triangle = this->geometry->getTriangle(index);
+	triangle.sample(result.point, pdf, u_point);
+	result.normal = triangle.normal;
+	if (!this->transformed)
+	{
 		return;
 	}
 
-	if (p < this->bvh[root.left].area)
+	Matrix3f linear{this->model};
+	pdf = 2.0f / glm::length(glm::cross(linear * triangle.edge1, linear * triangle.edge2));
+	result.point = Point{this->model * Vector4f{result.point, 1.0f}};
+	result.normal = glm::normalize(this->normal_model * result.normal);
+}
+
+LightBounds PathTracingObject::getLightBounds(const int index) const
+{
+	TriangleRecord triangle = this->geometry->getTriangle(index);
+	Point corners[3] = {triangle.vertex, triangle.vertex + triangle.edge1, triangle.vertex + triangle.edge2};
+	Direction normal = triangle.normal;
+	float area = triangle.getArea();
+	if (this->transformed)
 	{
-		traverse(root.left, p, result, pdf);
+		for (auto& corner : corners)
+		{
+			corner = Point{this->model * Vector4f{corner, 1.0f}};
+		}
+		normal = glm::normalize(this->normal_model * normal);
+		area = glm::length(glm::cross(corners[1] - corners[0], corners[2] - corners[0])) * 0.5f;
 	}
-	else
+
+	LightBounds bounds;
+	for (auto& corner : corners)
 	{
-		traverse(root.right, p - this->bvh[root.left].area, result, pdf);
+		bounds.bounding_box.unionPoint(corner);
 	}
+	bounds.power = pi * glm::dot(this->radiance, Vector3f{0.2126f, 0.7152f, 0.0722f}) * area;
+	bounds.axis = normal;
+	bounds.cos_theta_o = 1.0f;
+	bounds.cos_theta_e = 0.0f;
+	return bounds;
 }
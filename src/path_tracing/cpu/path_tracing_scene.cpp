@@ -9,11 +9,26 @@ void PathTracingScene::operator=(const Scene& scene)
 	this->materials = scene.materials;
 	this->textures = scene.textures;
 	this->point_lights = scene.point_lights;
+	this->direction_lights = scene.direction_lights;
 
-	for (auto object : scene.objects)
+	/* Objects instancing another object reuse its mesh, which appears earlier in the scene */
+	std::vector<int> mesh_index(scene.objects.size(), -1);
+	for (size_t i = 0; i < scene.objects.size(); i++)
 	{
-		object.getTriangleData();
-		PathTracingObject temp{object};
+		auto& object = scene.objects[i];
+		if (object.mesh_source == -1)
+		{
+			Object geometry = object;
+			mesh_index[i] = int(this->meshes.size());
+			this->meshes.push_back(std::make_shared<PathTracingMesh>(geometry));
+		}
+		else
+		{
+			mesh_index[i] = mesh_index[object.mesh_source];
+		}
+
+		PathTracingObject temp{object, this->meshes[mesh_index[i]]};
+		temp.mesh_index = mesh_index[i];
 		temp.material = this->materials[object.material_index];
 		this->objects.push_back(temp);
 	}
@@ -27,119 +42,455 @@ void PathTracingScene::setData(std::vector<Object>& objects, const Camera& camer
 
 void PathTracingScene::initBVH()
 {
-	float area = 0.0f;
-	std::vector<int> object_index;
-	BoundingBox bounding_box;
-	for (int i = 0; i < this->objects.size(); i++)
+	for (auto& mesh : this->meshes)
+	{
+		mesh->initBVH(this->bvh_builder);
+	}
+	this->rebuildTopLevel();
+	this->initMaterials();
+}
+
+namespace
+{
+/* Appends a subtree with one leaf per object of a range, for builder leaves holding several objects */
+int addObjectLeaves(std::vector<SceneBVH>& bvh, const std::vector<PathTracingObject>& objects, const int* object_index,
+					const int count)
+{
+	int index = int(bvh.size());
+	bvh.emplace_back();
+	if (count == 1)
 	{
-		this->objects[i].initBVH();
+		bvh[index].leaf_node_flag = true;
+		bvh[index].object_index = object_index[0];
+		bvh[index].bounding_box = objects[object_index[0]].bounding_box;
+		bvh[index].area = objects[object_index[0]].area;
+		return index;
+	}
 
-		area += objects[i].area;
-		object_index.push_back(i);
-		bounding_box.unionBox(objects[i].bounding_box);
+	int left = addObjectLeaves(bvh, objects, object_index, count / 2);
+	int right = addObjectLeaves(bvh, objects, object_index + count / 2, count - count / 2);
+	bvh[index].left = left;
+	bvh[index].right = right;
+	bvh[index].bounding_box = bvh[left].bounding_box;
+	bvh[index].bounding_box.unionBox(bvh[right].bounding_box);
+	bvh[index].area = bvh[left].area + bvh[right].area;
+	return index;
+}
 
-		if (objects[i].is_light)
+/* Appends a subtree of the BVH built over the objects to the scene BVH, children after their parent */
+int addSceneNode(std::vector<SceneBVH>& bvh, const std::vector<PathTracingObject>& objects,
+				 const std::vector<BVH>& nodes, const std::vector<int>& object_index, const int node)
+{
+	if (nodes[node].leaf_node_flag)
+	{
+		return addObjectLeaves(
+			bvh, objects, object_index.data() + nodes[node].primitive_offset, nodes[node].primitive_count);
+	}
+
+	int index = int(bvh.size());
+	bvh.emplace_back();
+	int left = addSceneNode(bvh, objects, nodes, object_index, nodes[node].left);
+	int right = addSceneNode(bvh, objects, nodes, object_index, nodes[node].right);
+	bvh[index].left = left;
+	bvh[index].right = right;
+	bvh[index].bounding_box = nodes[node].bounding_box;
+	bvh[index].area = nodes[node].area;
+	return index;
+}
+} // namespace
+
+void PathTracingScene::rebuildTopLevel()
+{
+	std::vector<BoundingBox> boxes(this->objects.size());
+	std::vector<float> areas(this->objects.size());
+	this->light_object_index.clear();
+	for (int i = 0; i < int(this->objects.size()); i++)
+	{
+		boxes[i] = this->objects[i].bounding_box;
+		areas[i] = this->objects[i].area;
+
+		if (this->objects[i].is_light)
 		{
 			this->light_object_index.push_back(i);
 		}
 	}
 
-	SceneBVH node;
+	/* The binned SAH split over the world bounds of the objects, every leaf of the scene BVH holds a single object */
+	BVHBuilder builder = this->bvh_builder;
+	builder.max_leaf_size = 1;
+	std::vector<BVH> nodes;
+	std::vector<int> object_index;
+	builder.build(boxes, areas, nodes, object_index);
+
 	this->bvh.clear();
-	this->bvh.push_back(node);
-	this->bvh[0].area = area;
+	this->bvh.reserve(2 * this->objects.size());
+	if (!nodes.empty())
+	{
+		addSceneNode(this->bvh, this->objects, nodes, object_index, 0);
+	}
 
-	this->buildBVH(0, object_index, bounding_box);
+	this->wide_bvh.build(this->bvh, [](const SceneBVH& node, std::vector<int>& primitives) {
+		primitives.push_back(node.object_index);
+	});
+	this->build_sah_cost = this->getSAHCost();
+	this->initLightSampling();
 }
 
-void PathTracingScene::buildBVH(const int index, std::vector<int>& object_index, const BoundingBox& bounding_box)
+void PathTracingScene::initLightSampling()
 {
-	this->bvh[index].bounding_box = bounding_box;
+	const Vector3f luminance{0.2126f, 0.7152f, 0.0722f};
+	std::vector<float> power;
+	std::vector<LightBounds> bounds;
+	this->light_emitters.clear();
+	for (auto& index : this->light_object_index)
+	{
+		const PathTracingObject& light = this->objects[index];
+		if (light.geometry->triangle_table.empty())
+		{
+			light.geometry->initTriangleTable();
+		}
 
-	if (object_index.size() == 1)
+		/* The Rec. 709 luminance of the radiance, emitted over the hemisphere of every point of the area */
+		power.push_back(pi * glm::dot(light.radiance, luminance) * light.area);
+
+		for (int i = 0; i < light.getTriangleCount(); i++)
+		{
+			this->light_emitters.push_back(LightEmitter{index, i});
+			bounds.push_back(light.getLightBounds(i));
+		}
+	}
+
+	/* Point lights emit their intensity in every direction */
+	for (int i = 0; i < int(this->point_lights.size()); i++)
 	{
-		this->bvh[index].object_index = object_index[0];
-		this->bvh[index].leaf_node_flag = true;
-		this->bvh[index].area = this->objects[object_index[0]].area;
-		return;
+		const PointLight& light = this->point_lights[i];
+		power.push_back(4.0f * pi * glm::dot(light.color * light.intensity, luminance));
+
+		LightBounds point_bounds;
+		point_bounds.bounding_box = BoundingBox{Point{light.position}};
+		point_bounds.power = power.back();
+		point_bounds.cos_theta_o = -1.0f;
+		point_bounds.cos_theta_e = 0.0f;
+		this->light_emitters.push_back(LightEmitter{-1, i});
+		bounds.push_back(point_bounds);
 	}
-	else
+
+	/* Directional lights reach at most the disk of the scene bounds facing them, they stay out of the tree and are
+	   weighed against it by this power */
+	float scene_radius = 0.0f;
+	if (!this->bvh.empty())
 	{
-		this->bvh[index].leaf_node_flag = false;
+		scene_radius = glm::length(this->bvh[0].bounding_box.getMax() - this->bvh[0].bounding_box.getMin()) * 0.5f;
 	}
+	for (int i = 0; i < int(this->direction_lights.size()); i++)
+	{
+		const DirectionLight& light = this->direction_lights[i];
+		power.push_back(pi * scene_radius * scene_radius * glm::dot(light.color * light.intensity, luminance));
 
-	SceneBVH left_node;
-	this->bvh.push_back(left_node);
-	this->bvh[index].left = int(this->bvh.size()) - 1;
+		LightBounds direction_bounds;
+		direction_bounds.power = power.back();
+		this->light_emitters.push_back(LightEmitter{-2, i});
+		bounds.push_back(direction_bounds);
+	}
 
-	SceneBVH right_node;
-	this->bvh.push_back(right_node);
-	this->bvh[index].right = int(this->bvh.size()) - 1;
+	this->light_table.build(power);
+	this->light_tree.build(bounds, int(this->direction_lights.size()));
+	this->initLightLookup();
+}
 
-	if (object_index.size() == 2)
+void PathTracingScene::initLightLookup()
+{
+	this->light_index.assign(this->objects.size(), -1);
+	this->light_emitter_offset.assign(this->objects.size(), -1);
+	for (int i = 0; i < int(this->light_object_index.size()); i++)
 	{
-		std::vector<int> temp;
-		temp.push_back(object_index[0]);
-		buildBVH(this->bvh[index].left, temp, this->objects[object_index[0]].bounding_box);
+		this->light_index[this->light_object_index[i]] = i;
+	}
 
-		temp.clear();
-		temp.push_back(object_index[1]);
-		buildBVH(this->bvh[index].right, temp, this->objects[object_index[1]].bounding_box);
-		return;
+	/* The triangles of every light object are consecutive emitters */
+	for (int i = int(this->light_emitters.size()) - 1; i >= 0; i--)
+	{
+		if (this->light_emitters[i].object_index >= 0)
+		{
+			this->light_emitter_offset[this->light_emitters[i].object_index] = i;
+		}
 	}
+}
+
+void PathTracingScene::initMaterials()
+{
+	this->bsdfs.clear();
+	std::vector<int> bsdf_index(this->materials.size(), -1);
+	for (auto& object : this->objects)
+	{
+		/* Objects without a scene material keep a block of their own */
+		int material = object.material_index;
+		if (material >= 0 && material < int(bsdf_index.size()) && bsdf_index[material] != -1)
+		{
+			object.bsdf_index = bsdf_index[material];
+			continue;
+		}
+
+		object.bsdf_index = int(this->bsdfs.size());
+		this->bsdfs.emplace_back(object.material);
+		if (material >= 0 && material < int(bsdf_index.size()))
+		{
+			bsdf_index[material] = object.bsdf_index;
+		}
+	}
+}
+
+void PathTracingScene::setTransform(const int object, const Matrix4f& model)
+{
+	this->objects[object].setModel(model);
+	this->moved_objects = true;
+}
+
+void PathTracingScene::setVertices(const int mesh, const std::vector<Vertex>& vertices)
+{
+	this->meshes[mesh]->setVertices(vertices);
+	this->modified_meshes.push_back(mesh);
+}
 
-	float x_length = bounding_box.getLengthX();
-	float y_length = bounding_box.getLengthY();
-	float z_length = bounding_box.getLengthZ();
+void PathTracingScene::updateBVH()
+{
+	std::sort(this->modified_meshes.begin(), this->modified_meshes.end());
+	this->modified_meshes.erase(std::unique(this->modified_meshes.begin(), this->modified_meshes.end()),
+								this->modified_meshes.end());
 
-	if (x_length > y_length && x_length > z_length)
+	std::vector<uint8_t> modified(this->meshes.size(), 0);
+	for (auto& index : this->modified_meshes)
 	{
-		std::sort(object_index.begin(), object_index.end(), [&](const int& a, const int& b) {
-			return this->objects[a].bounding_box.getMin().x < this->objects[b].bounding_box.getMin().x;
-		});
+		PathTracingMesh& mesh = *this->meshes[index];
+		mesh.refit(this->bvh_builder);
+		if (mesh.sah_cost > this->rebuild_threshold * mesh.build_sah_cost)
+		{
+			mesh.initBVH(this->bvh_builder);
+			this->rebuild_count++;
+		}
+		else
+		{
+			this->refit_count++;
+		}
+		modified[index] = 1;
 	}
-	else if (y_length > x_length && y_length > z_length)
+
+	/* The objects instancing a changed mesh keep their model matrix but get the new bounds and area of the mesh */
+	if (!this->modified_meshes.empty())
 	{
-		std::sort(object_index.begin(), object_index.end(), [&](const int& a, const int& b) {
-			return this->objects[a].bounding_box.getMin().y < this->objects[b].bounding_box.getMin().y;
-		});
+		for (auto& object : this->objects)
+		{
+			if (modified[object.mesh_index])
+			{
+				object.setModel(object.model);
+			}
+		}
 	}
-	else
+
+	if (this->moved_objects)
+	{
+		this->rebuildTopLevel();
+		this->rebuild_count++;
+	}
+	else if (!this->modified_meshes.empty())
 	{
-		std::sort(object_index.begin(), object_index.end(), [&](const int& a, const int& b) {
-			return this->objects[a].bounding_box.getMin().z < this->objects[b].bounding_box.getMin().z;
+		refitBVH(this->bvh, [&](SceneBVH& node) {
+			node.bounding_box = this->objects[node.object_index].bounding_box;
+			node.area = this->objects[node.object_index].area;
 		});
+		if (this->getSAHCost() > this->rebuild_threshold * this->build_sah_cost)
+		{
+			this->rebuildTopLevel();
+			this->rebuild_count++;
+		}
+		else
+		{
+			this->wide_bvh.build(this->bvh, [](const SceneBVH& node, std::vector<int>& primitives) {
+				primitives.push_back(node.object_index);
+			});
+			this->initLightSampling();
+			this->refit_count++;
+		}
 	}
 
-	int middle = object_index.size() / 2;
-	std::vector<int> left_objects_index(object_index.begin(), object_index.begin() + middle);
-	std::vector<int> right_objects_index(object_index.begin() + middle, object_index.end());
+	this->modified_meshes.clear();
+	this->moved_objects = false;
+}
 
-	BoundingBox left_bounding_box{}, right_bounding_box{};
-	float left_area = 0.0f, right_area = 0.0f;
-	for (auto& index : left_objects_index)
+float PathTracingScene::getSAHCost() const
+{
+	if (this->bvh.empty())
 	{
-		left_bounding_box.unionBox(this->objects[index].bounding_box);
-		left_area += this->objects[index].area;
+		return 0.0f;
 	}
-	for (auto& index : right_objects_index)
+
+	float root_area = this->bvh[0].bounding_box.getSurfaceArea();
+	if (root_area <= 0.0f)
 	{
-		right_bounding_box.unionBox(this->objects[index].bounding_box);
-		right_area += this->objects[index].area;
+		return 0.0f;
 	}
 
-	this->bvh[this->bvh[index].left].area = left_area;
-	this->bvh[this->bvh[index].right].area = right_area;
+	/* Leaves of the scene BVH continue with the mesh BVH, weighted by the chance of reaching the object */
+	float cost = 0.0f;
+	for (auto& node : this->bvh)
+	{
+		float probability = node.bounding_box.getSurfaceArea() / root_area;
+		if (node.leaf_node_flag)
+		{
+			cost += probability * this->objects[node.object_index].geometry->sah_cost;
+		}
+		else
+		{
+			cost += probability * this->bvh_builder.traversal_cost;
+		}
+	}
+	return cost;
+}
 
-	buildBVH(this->bvh[index].left, left_objects_index, left_bounding_box);
-	buildBVH(this->bvh[index].right, right_objects_index, right_bounding_box);
+void PathTracingScene::outputBVHStatistics() const
+{
+	size_t triangles = 0, nodes = 0, leaves = 0;
+	for (auto& mesh : this->meshes)
+	{
+		triangles += mesh->getTriangleCount();
+		nodes += mesh->bvh.size();
+		for (auto& node : mesh->bvh)
+		{
+			leaves += node.leaf_node_flag ? 1 : 0;
+		}
+	}
 
-	return;
+	std::cout << "BVH: " << this->objects.size() << " objects , " << this->meshes.size() << " meshes , " << triangles
+			  << " triangles , " << nodes << " nodes , " << leaves << " leaves , SAH cost: " << this->getSAHCost()
+			  << std::endl;
 }
 
 IntersectResult PathTracingScene::intersect(Ray& ray) const
 {
-	return this->traverse(0, ray);
+	IntersectResult result;
+	this->wide_bvh.intersect(ray, [&](const int index) {
+		IntersectResult temp_result = this->objects[index].intersect(ray);
+		if (temp_result.is_intersect && temp_result.t < result.t)
+		{
+			result = temp_result;
+			result.object_index = index;
+			return true;
+		}
+		return false;
+	});
+
+	return result;
+}
+
+bool PathTracingScene::occluded(const Ray& ray, const float t_max) const
+{
+	Ray shadow_ray = ray;
+	shadow_ray.t = t_max;
+	return this->wide_bvh.occluded(shadow_ray, [&](const int index) { return this->objects[index].occluded(ray, t_max); });
+}
+
+void PathTracingScene::intersect8(Ray rays[PACKET_SIZE], IntersectResult results[PACKET_SIZE], const int mask) const
+{
+	RayPacket packet;
+	for (int lane = 0; lane < PACKET_SIZE; lane++)
+	{
+		packet.setRay(lane, (mask >> lane) & 1 ? rays[lane] : Ray{Point{0.0f}, Direction{0.0f, 0.0f, 1.0f}});
+	}
+
+	PacketHit hit;
+	int hit_lanes = this->wide_bvh.intersect(packet, mask, [&](const int index, const int lanes) {
+		int object_lanes = this->objects[index].intersect8(packet, lanes, hit);
+		for (int lane = 0; lane < PACKET_SIZE; lane++)
+		{
+			if ((object_lanes >> lane) & 1)
+			{
+				hit.object[lane] = index;
+			}
+		}
+		return object_lanes;
+	});
+
+	for (int lane = 0; lane < PACKET_SIZE; lane++)
+	{
+		if (((mask >> lane) & 1) == 0)
+		{
+			continue;
+		}
+		if (((hit_lanes >> lane) & 1) == 0)
+		{
+			results[lane] = IntersectResult{};
+			continue;
+		}
+
+		rays[lane].t = packet.t[lane];
+		auto& object = this->objects[hit.object[lane]];
+		float result[4] = {hit.barycentric[0][lane], hit.barycentric[1][lane], hit.barycentric[2][lane], packet.t[lane]};
+		results[lane] = object.getIntersectResult(rays[lane], hit.primitive[lane], result);
+		results[lane].object_index = hit.object[lane];
+	}
+}
+
+namespace
+{
+/* Groups ray indices by direction octant, so the packets of a stream share their traversal order */
+void sortByOctant(const std::vector<Ray>& rays, std::vector<int>& order)
+{
+	auto getOctant = [](const Ray& ray) {
+		return (ray.direction.x < 0.0f ? 1 : 0) | (ray.direction.y < 0.0f ? 2 : 0) | (ray.direction.z < 0.0f ? 4 : 0);
+	};
+
+	int offsets[9] = {0};
+	for (auto& ray : rays)
+	{
+		offsets[getOctant(ray) + 1]++;
+	}
+	for (int i = 1; i < 9; i++)
+	{
+		offsets[i] += offsets[i - 1];
+	}
+
+	order.resize(rays.size());
+	for (size_t i = 0; i < rays.size(); i++)
+	{
+		order[offsets[getOctant(rays[i])]++] = int(i);
+	}
+}
+} // namespace
+
+void PathTracingScene::intersect(std::vector<Ray>& rays,
+								 std::vector<IntersectResult>& results,
+								 std::vector<int>& order) const
+{
+	results.resize(rays.size());
+	sortByOctant(rays, order);
+
+	Ray packet_rays[PACKET_SIZE];
+	IntersectResult packet_results[PACKET_SIZE];
+	for (size_t begin = 0; begin < order.size(); begin += PACKET_SIZE)
+	{
+		int count = std::min(PACKET_SIZE, int(order.size() - begin));
+		for (int lane = 0; lane < count; lane++)
+		{
+			packet_rays[lane] = rays[order[begin + lane]];
+		}
+
+		this->intersect8(packet_rays, packet_results, (1 << count) - 1);
+
+		for (int lane = 0; lane < count; lane++)
+		{
+			rays[order[begin + lane]].t = packet_rays[lane].t;
+			results[order[begin + lane]] = packet_results[lane];
+		}
+	}
+}
+
+void PathTracingScene::occluded(const std::vector<Ray>& rays, std::vector<uint8_t>& occluded) const
+{
+	occluded.resize(rays.size());
+	for (size_t i = 0; i < rays.size(); i++)
+	{
+		occluded[i] = this->occluded(rays[i], rays[i].t) ? 1 : 0;
+	}
 }
 
 IntersectResult PathTracingScene::traverse(const int index, Ray& ray) const
@@ -173,63 +524,195 @@ IntersectResult PathTracingScene::traverse(const int index, Ray& ray) const
 	return result;
 }
 
-void PathTracingScene::sampleLight(IntersectResult& result, float& pdf)
+void PathTracingScene::sampleLight(LightSample& sample, const Point& point, const Direction& normal, const float u,
+								   const Vector2f& u_point) const
 {
-	float emit_area_sum = 0;
-	for (int i = 0; i < this->light_object_index.size(); i++)
+	sample = LightSample{};
+
+	/* Either sampler gives a light object, a point light or a directional light, with the probability of picking it */
+	float pmf = 0.0f, pdf = 0.0f;
+	int point_light = -1, direction_light = -1;
+	IntersectResult light;
+	if (this->light_sampler_type == LightSamplerType::Tree)
 	{
-		emit_area_sum += objects[light_object_index[i]].area;
+		int emitter = this->light_tree.sample(point, normal, u, pmf);
+		if (emitter == -1)
+		{
+			return;
+		}
+
+		light.object_index = this->light_emitters[emitter].object_index;
+		if (light.object_index == -1)
+		{
+			point_light = this->light_emitters[emitter].index;
+		}
+		else if (light.object_index == -2)
+		{
+			direction_light = this->light_emitters[emitter].index;
+		}
+		else
+		{
+			this->objects[light.object_index].sampleTriangle(this->light_emitters[emitter].index, light, pdf, u_point);
+		}
 	}
+	else
+	{
+		if (this->light_table.empty())
+		{
+			return;
+		}
 
-	float p = getRandomNumber(0.0f, 1.0f) * emit_area_sum;
+		/* The part of the selection sample not used to pick the light picks the triangle on the light */
+		float u_object;
+		int index = this->light_table.sample(u, pmf, u_object);
+		int light_count = int(this->light_object_index.size());
+		int point_light_count = int(this->point_lights.size());
+		if (index >= light_count + point_light_count)
+		{
+			direction_light = index - light_count - point_light_count;
+		}
+		else if (index >= light_count)
+		{
+			point_light = index - light_count;
+		}
+		else
+		{
+			light.object_index = this->light_object_index[index];
+			this->objects[light.object_index].sample(light, pdf, u_object, u_point);
+		}
+	}
+	if (pmf == 0.0f)
+	{
+		return;
+	}
 
-	emit_area_sum = 0;
-	for (int i = 0; i < light_object_index.size(); i++)
+	if (point_light != -1)
 	{
-		emit_area_sum += objects[light_object_index[i]].area;
-		if (p <= emit_area_sum)
+		const PointLight& light_source = this->point_lights[point_light];
+		Vector3f to_light = Point{light_source.position} - point;
+		float distance_squared = glm::dot(to_light, to_light);
+		if (distance_squared == 0.0f)
 		{
-			objects[light_object_index[i]].sample(result, pdf);
-			result.object_index = light_object_index[i];
-			break;
+			return;
 		}
+		sample.point = light_source.position;
+		sample.distance = std::sqrt(distance_squared);
+		sample.direction = to_light / sample.distance;
+		sample.radiance = light_source.color * light_source.intensity / distance_squared;
+		sample.pdf = pmf;
+		return;
+	}
+
+	/* Directional lights arrive from the same direction everywhere, unattenuated and from infinitely far away */
+	if (direction_light != -1)
+	{
+		const DirectionLight& light_source = this->direction_lights[direction_light];
+		sample.direction = -glm::normalize(light_source.direction);
+		sample.distance = std::numeric_limits<float>::infinity();
+		sample.point = point + sample.direction;
+		sample.radiance = light_source.color * light_source.intensity;
+		sample.pdf = pmf;
+		return;
+	}
+
+	/* The area density becomes a solid angle density by the squared distance over the cosine at the light */
+	Vector3f to_light = light.point - point;
+	float distance_squared = glm::dot(to_light, to_light);
+	if (distance_squared == 0.0f)
+	{
+		return;
+	}
+	sample.point = light.point;
+	sample.distance = std::sqrt(distance_squared);
+	sample.direction = to_light / sample.distance;
+	float cos_theta_x = -glm::dot(light.normal, sample.direction);
+	if (cos_theta_x <= 0.0f)
+	{
+		return;
 	}
+	sample.radiance = this->objects[light.object_index].radiance;
+	sample.pdf = pmf * pdf * distance_squared / cos_theta_x;
+	sample.object_index = light.object_index;
 }
 
-Vector3f PathTracingScene::shader(Ray ray)
+float PathTracingScene::getLightPDF(const Point& point, const Direction& normal, const IntersectResult& light) const
 {
-	std::vector<std::pair<Vector3f, Vector3f>> task{};
-	int depth = 0;
-	float last = 1.0f;
-	while (true)
+	int index = this->light_index[light.object_index];
+	if (index == -1)
 	{
-		if (depth > this->max_depth)
-		{
-			task.push_back(std::make_pair(Vector3f(0.0f), Vector3f(0.0f)));
-			break;
-		}
+		return 0.0f;
+	}
+
+	/* Only the front of a triangle is sampled, as in sampleLight */
+	const PathTracingObject& object = this->objects[light.object_index];
+	Direction light_normal;
+	float area = object.getTriangleArea(light.triangle_index, light_normal);
+	Vector3f to_light = light.point - point;
+	float distance_squared = glm::dot(to_light, to_light);
+	float cos_theta_x = -glm::dot(light_normal, to_light) / std::sqrt(distance_squared);
+	if (area <= 0.0f || distance_squared == 0.0f || cos_theta_x <= 0.0f)
+	{
+		return 0.0f;
+	}
+
+	/* The tree picks the triangle itself, the alias tables pick the object by power and its triangle by area */
+	float pmf;
+	if (this->light_sampler_type == LightSamplerType::Tree)
+	{
+		int emitter = this->light_emitter_offset[light.object_index] + light.triangle_index;
+		pmf = this->light_tree.getPMF(point, normal, emitter);
+	}
+	else
+	{
+		pmf = this->light_table.getPMF(index) * object.geometry->triangle_table.getPMF(light.triangle_index);
+	}
+	return pmf / area * distance_squared / cos_theta_x;
+}
+
+Vector3f PathTracingScene::shader(Ray ray, Sampler& sampler)
+{
+	IntersectResult result = this->intersect(ray);
+	int path_length;
+	return this->shader(ray, result, sampler, path_length);
+}
 
-		Vector3f result_color{0.0f, 0.0f, 0.0f};
+Vector3f PathTracingScene::shader(Ray ray, IntersectResult result, Sampler& sampler, int& path_length)
+{
+	/* Radiance is gathered front to back, weighted by the product of the BSDF weights along the path */
+	Vector3f color{0.0f, 0.0f, 0.0f};
+	Vector3f throughput{1.0f, 1.0f, 1.0f};
+
+	/* The previous vertex and the density its BSDF sampled the ray with, 0 after the camera and specular vertices */
+	Point previous_point{0.0f};
+	Direction previous_normal{0.0f};
+	float bsdf_pdf = 0.0f;
+	path_length = 0;
+	for (int depth = 0; depth <= this->max_depth; depth++)
+	{
+		path_length++;
 
-		/* Intersection of light and scene */
-		auto result = this->intersect(ray);
+		/* Intersection of light and scene, the first one is given by the caller */
+		if (depth > 0)
+		{
+			result = this->intersect(ray);
+		}
 
 		/* No intersection */
 		if (!result.is_intersect)
 		{
-			task.push_back(std::make_pair(Vector3f(0.0f), Vector3f(0.0f, 0.0f, 0.0f)));
 			break;
 		}
 		auto& object = objects[result.object_index];
 
-		/* The intersection is a light source */
+		/* The intersection is a light source, weighted against sampling the same point from the previous vertex */
 		if (object.is_light)
 		{
-			if (depth == 0)
+			float weight = 1.0f;
+			if (bsdf_pdf > 0.0f)
 			{
-				return object.radiance;
+				weight = powerHeuristic(bsdf_pdf, this->getLightPDF(previous_point, previous_normal, result));
 			}
-			task.push_back(std::make_pair(object.radiance, Vector3f(last)));
+			color += throughput * object.radiance * weight;
 			break;
 		}
 
@@ -237,77 +720,70 @@ Vector3f PathTracingScene::shader(Ray ray)
 		Point object_point = result.point;
 		Direction object_normal = result.normal;
 		Direction wi = -ray.direction;
-		Vector3f color;
+		Vector3f color_texture;
 		if (object.material_index != -1)
 		{
-			color = this->textures[object.material_index].getColor(result.uv.x, result.uv.y);
+			color_texture = this->textures[object.material_index].getColor(result.uv.x, result.uv.y);
 		}
-		PathTracingMaterial material = object.material;
-
-		/* Sample the light source */
-		float pdf;
-		IntersectResult light;
-		this->sampleLight(light, pdf);
-		Point light_point = light.point;
-		Vector3f ws = glm::normalize(light_point - object_point);
-		Direction light_point_normal = light.normal;
-		Vector3f light_radiance = this->objects[light.object_index].radiance;
-
-		/* Check if it is blocked */
-		float distance = glm::length(light_point - object_point);
-		Ray object_to_light{object_point, ws};
-		auto test = this->intersect(object_to_light);
-
-		/* No occlusion */
-		if (test.t - distance > -0.001)
+		const BSDFParameters& bsdf = this->bsdfs[object.bsdf_index];
+		const BSDFKernels& kernels = BSDF_KERNELS[size_t(bsdf.type)];
+		bool is_specular = kernels.delta;
+
+		/* Sample the light source, specular vertices draw the samples but cannot use them */
+		float u_light = sampler.get1D();
+		Vector2f u_light_point = sampler.get2D();
+		if (!is_specular)
 		{
-			Vector3f evaluate = material.evaluate(wi, ws, object_normal, color);
-			float cos_theta = glm::dot(object_normal, ws);
-			float cos_theta_x = glm::dot(light_point_normal, -ws);
-			result_color =
-				light_radiance * evaluate * cos_theta * cos_theta_x / (float(std::pow(distance, 2.0f)) * pdf);
+			LightSample light;
+			this->sampleLight(light, object_point, object_normal, u_light, u_light_point);
+
+			/* Check if it is blocked, hits within 0.001 of the light sample belong to the light itself */
+			Ray object_to_light{object_point, light.direction};
+			if (light.pdf > 0.0f && !this->occluded(object_to_light, light.distance - 0.001f))
+			{
+				/* Point lights cannot be hit by BSDF samples, area light samples are weighted against them */
+				float weight = 1.0f;
+				if (light.object_index != -1)
+				{
+					weight = powerHeuristic(light.pdf, kernels.pdf(bsdf, wi, light.direction, object_normal));
+				}
+				Vector3f evaluate = kernels.evaluate(bsdf, wi, light.direction, object_normal, color_texture);
+				color += throughput * light.radiance * evaluate * weight / light.pdf;
+			}
 		}
 
 		/* Sampling light */
-		Vector3f wo = glm::normalize(material.sample(wi, object_normal));
+		Vector3f wo = glm::normalize(kernels.sample(bsdf, wi, object_normal, sampler.get2D()));
 		ray.origin = object_point;
 		ray.direction = wo;
 		ray.t = std::numeric_limits<float>::infinity();
 
-		/* Specular reflection */
-		if (material.type == MaterialType::Specular || material.type == MaterialType::Refraction)
-		{
-			depth++;
-			continue;
-		}
-		else if (material.type == MaterialType::Glossy)
+		/* Specular reflection keeps the throughput, the light it hits is not weighted */
+		bsdf_pdf = 0.0f;
+		if (!is_specular)
 		{
-			last = 1.0f;
+			bsdf_pdf = kernels.pdf(bsdf, wi, wo, object_normal);
+			if (bsdf_pdf <= 0.0f)
+			{
+				break;
+			}
+			previous_point = object_point;
+			previous_normal = object_normal;
+
+			Vector3f evaluate = kernels.evaluate(bsdf, wi, wo, object_normal, color_texture);
+			throughput *= evaluate / bsdf_pdf;
 		}
-		else
+
+		/* Russian roulette, paths that carry little radiance are terminated and the survivors reweighted */
+		if (depth + 1 >= this->russian_roulette_depth)
 		{
-			last = 0.0;
+			float survival = getSurvivalProbability(throughput);
+			if (sampler.get1D() >= survival)
+			{
+				break;
+			}
+			throughput /= survival;
 		}
-
-		Vector3f evaluate = material.evaluate(wi, wo, object_normal, color);
-		float pdf_O = material.pdf(wi, wo, object_normal);
-		float cos_theta = glm::dot(wo, object_normal);
-		task.push_back(std::make_pair(result_color, evaluate * cos_theta / pdf_O));
-
-		depth++;
-	}
-
-	Vector3f color{0.0f, 0.0f, 0.0f};
-
-	auto& [temp, coefficient] = task.back();
-	color = temp * coefficient;
-	task.pop_back();
-
-	while (!task.empty())
-	{
-		auto& [temp, coefficient] = task.back();
-		color = temp + color * coefficient;
-		task.pop_back();
 	}
 
 	return color;
@@ -11,7 +11,7 @@ Point Ray::spread(const float t) const
 	return this->origin + this->direction * t;
 }
 
-bool Ray::intersectTriangle(const Triangle& triangle, float result[4]) const
+bool Ray::intersectTriangle(const TriangleRecord& triangle, float result[4]) const
 {
 	/* Moller Trumbore algorithm */
 	if (glm::dot(this->direction, triangle.normal) > 0.0f)
@@ -19,7 +19,7 @@ bool Ray::intersectTriangle(const Triangle& triangle, float result[4]) const
 		return false;
 	}
 
-	Vector3f s = this->origin - triangle.vertex1.position;
+	Vector3f s = this->origin - triangle.vertex;
 	Vector3f s1 = glm::cross(this->direction, triangle.edge2);
 	Vector3f s2 = glm::cross(s, triangle.edge1);
 	float s1_dot_e1 = glm::dot(s1, triangle.edge1);
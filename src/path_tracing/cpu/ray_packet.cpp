@@ -0,0 +1,121 @@
+#include <ray_packet.h>
+
+void RayPacket::setRay(const int lane, const Ray& ray)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		this->origin[axis][lane] = ray.origin[axis];
+		this->direction[axis][lane] = ray.direction[axis];
+		this->inverse_direction[axis][lane] = 1.0f / ray.direction[axis];
+	}
+	this->t[lane] = ray.t;
+}
+
+Ray RayPacket::getRay(const int lane) const
+{
+	Ray ray{Point{this->origin[0][lane], this->origin[1][lane], this->origin[2][lane]},
+			Direction{this->direction[0][lane], this->direction[1][lane], this->direction[2][lane]}};
+	ray.t = this->t[lane];
+	return ray;
+}
+
+int RayPacket::getOctant(const int mask) const
+{
+	int octant = -1;
+	for (int lane = 0; lane < PACKET_SIZE; lane++)
+	{
+		if (((mask >> lane) & 1) == 0)
+		{
+			continue;
+		}
+
+		int lane_octant = (this->inverse_direction[0][lane] < 0.0f ? 1 : 0) |
+						  (this->inverse_direction[1][lane] < 0.0f ? 2 : 0) |
+						  (this->inverse_direction[2][lane] < 0.0f ? 4 : 0);
+		if (octant != -1 && octant != lane_octant)
+		{
+			return -1;
+		}
+		octant = lane_octant;
+	}
+	return octant;
+}
+
+int RayPacket::intersectTriangle(const TriangleRecord& triangle, const int mask, float hit[4][PACKET_SIZE]) const
+{
+	/* Same operations as Ray::intersectTriangle, so packets and single rays find the same hits */
+	const Point& v = triangle.vertex;
+	const Vector3f& e1 = triangle.edge1;
+	const Vector3f& e2 = triangle.edge2;
+	const Direction& n = triangle.normal;
+
+#if defined(PATH_TRACING_SSE)
+	constexpr int group_mask = (1 << SIMD_WIDTH) - 1;
+
+	int result = 0;
+	for (int group = 0; group < PACKET_SIZE; group += SIMD_WIDTH)
+	{
+		if (((mask >> group) & group_mask) == 0)
+		{
+			continue;
+		}
+
+		SIMDFloat dx = simdLoad(this->direction[0] + group);
+		SIMDFloat dy = simdLoad(this->direction[1] + group);
+		SIMDFloat dz = simdLoad(this->direction[2] + group);
+		SIMDFloat facing = simdAdd(simdAdd(simdMul(dx, simdSet(n.x)), simdMul(dy, simdSet(n.y))), simdMul(dz, simdSet(n.z)));
+
+		SIMDFloat sx = simdSub(simdLoad(this->origin[0] + group), simdSet(v.x));
+		SIMDFloat sy = simdSub(simdLoad(this->origin[1] + group), simdSet(v.y));
+		SIMDFloat sz = simdSub(simdLoad(this->origin[2] + group), simdSet(v.z));
+
+		SIMDFloat s1x = simdSub(simdMul(dy, simdSet(e2.z)), simdMul(simdSet(e2.y), dz));
+		SIMDFloat s1y = simdSub(simdMul(dz, simdSet(e2.x)), simdMul(simdSet(e2.z), dx));
+		SIMDFloat s1z = simdSub(simdMul(dx, simdSet(e2.y)), simdMul(simdSet(e2.x), dy));
+
+		SIMDFloat s2x = simdSub(simdMul(sy, simdSet(e1.z)), simdMul(simdSet(e1.y), sz));
+		SIMDFloat s2y = simdSub(simdMul(sz, simdSet(e1.x)), simdMul(simdSet(e1.z), sx));
+		SIMDFloat s2z = simdSub(simdMul(sx, simdSet(e1.y)), simdMul(simdSet(e1.x), sy));
+
+		auto dot = [](SIMDFloat ax, SIMDFloat ay, SIMDFloat az, SIMDFloat bx, SIMDFloat by, SIMDFloat bz) {
+			return simdAdd(simdAdd(simdMul(ax, bx), simdMul(ay, by)), simdMul(az, bz));
+		};
+		SIMDFloat s1_dot_e1 = dot(s1x, s1y, s1z, simdSet(e1.x), simdSet(e1.y), simdSet(e1.z));
+		SIMDFloat t = simdDiv(dot(s2x, s2y, s2z, simdSet(e2.x), simdSet(e2.y), simdSet(e2.z)), s1_dot_e1);
+		SIMDFloat b1 = simdDiv(dot(s1x, s1y, s1z, sx, sy, sz), s1_dot_e1);
+		SIMDFloat b2 = simdDiv(dot(s2x, s2y, s2z, dx, dy, dz), s1_dot_e1);
+		SIMDFloat b0 = simdSub(simdSub(simdSet(1.0f), b1), b2);
+
+		/* Rejections are tested positively, so NaN lanes behave like the scalar test */
+		SIMDFloat zero = simdSet(0.0f);
+		SIMDFloat one = simdSet(1.0f);
+		SIMDFloat rejected = simdOr(simdGreater(facing, zero), simdLess(t, zero));
+		rejected = simdOr(rejected, simdOr(simdLess(b1, zero), simdOr(simdLess(b2, zero), simdLess(b0, zero))));
+		rejected = simdOr(rejected, simdOr(simdGreater(b1, one), simdOr(simdGreater(b2, one), simdGreater(b0, one))));
+		int closer = simdMask(simdLess(t, simdLoad(this->t + group)));
+
+		simdStore(hit[0] + group, b0);
+		simdStore(hit[1] + group, b1);
+		simdStore(hit[2] + group, b2);
+		simdStore(hit[3] + group, t);
+		result |= (closer & ~simdMask(rejected)) << group;
+	}
+	return result & mask;
+#else
+	int result = 0;
+	for (int lane = 0; lane < PACKET_SIZE; lane++)
+	{
+		Ray ray = this->getRay(lane);
+		float lane_hit[4];
+		if (((mask >> lane) & 1) != 0 && ray.intersectTriangle(triangle, lane_hit) && lane_hit[3] < ray.t)
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				hit[i][lane] = lane_hit[i];
+			}
+			result |= 1 << lane;
+		}
+	}
+	return result;
+#endif
+}
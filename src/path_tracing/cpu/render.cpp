@@ -1,4 +1,10 @@
 #pragma once
+#include <algorithm>
+#include <cstring>
+#include <omp.h>
+#include <thread>
+
+#include <allocation_counter.h>
 #include <data_loader.h>
 #include <ray.h>
 #include <render.h>
@@ -18,13 +24,207 @@ void Renderer::render(PathTracingScene& scene)
 {
 	auto camera = scene.camera;
 
-	this->frame_buffer.resize(camera.width * camera.height);
+	this->frame_buffer.assign(camera.width * camera.height, Vector3f{0.0f});
+	this->setCamera(camera);
+
+	if (this->progressive)
+	{
+		this->renderProgressive(scene);
+		return;
+	}
+
+	if (this->adaptive_sampling)
+	{
+		this->renderAdaptive(scene);
+		this->saveResult(scene);
+		this->saveSampleHeatmap(scene);
+		return;
+	}
+
+	TileScheduler scheduler;
+	scheduler.init(camera.width, camera.height, this->tile_size, omp_get_max_threads());
+
+	auto sampler = createSampler(this->sampler_type, this->spp, this->frame);
+
+	auto start = std::chrono::steady_clock::now();
+
+	WavefrontIntegrator stage_times;
+	uint64_t allocations = 0;
+	uint64_t path_segments = 0;
+
+#pragma omp parallel
+	{
+		int thread = omp_get_thread_num();
+		auto thread_sampler = sampler->clone();
+		WavefrontIntegrator integrator;
+		Tile tile;
+		while (scheduler.next(thread, tile))
+		{
+			auto tile_start = std::chrono::steady_clock::now();
+			uint64_t tile_allocations = getAllocationCount();
+			uint64_t tile_segments = 0;
+			if (this->integrator_type == IntegratorType::Wavefront)
+			{
+				tile_segments = this->renderTileWavefront(scene, tile, *thread_sampler, integrator);
+			}
+			else
+			{
+				tile_segments = this->renderTile(scene, tile, *thread_sampler);
+			}
+			tile_allocations = getAllocationCount() - tile_allocations;
+#pragma omp atomic
+			allocations += tile_allocations;
+#pragma omp atomic
+			path_segments += tile_segments;
+			scheduler.finish(thread, std::chrono::steady_clock::now() - tile_start);
+
+			if (thread == 0)
+			{
+				outputProgress(scheduler.getProgress());
+			}
+		}
+
+#pragma omp critical
+		stage_times.addStageTimes(integrator);
+	}
+	outputProgress(1.f);
+
+	if (this->output_statistics)
+	{
+		std::cout << std::endl;
+		scheduler.outputStatistics(std::chrono::steady_clock::now() - start);
+		if (this->integrator_type == IntegratorType::Wavefront)
+		{
+			stage_times.outputStatistics();
+		}
+
+		double samples = double(camera.width) * double(camera.height) * double(this->spp);
+		std::cout << "Average path length: " << double(path_segments) / samples << std::endl;
+#ifndef NDEBUG
+		std::cout << "Heap allocations while tracing: " << allocations << " (" << double(allocations) / samples
+				  << " per sample)" << std::endl;
+#endif
+		if (scene.geometry_cache != nullptr)
+		{
+			scene.geometry_cache->outputStatistics();
+		}
+	}
+
+	this->saveResult(scene);
+}
 
+void Renderer::renderCoordinator(const PathTracingScene& scene, const int port)
+{
+	RenderCoordinator coordinator;
+	coordinator.task_timeout = this->distributed_task_timeout;
+	if (!coordinator.listen(port))
+	{
+		std::cout << "Could not listen on port " << port << std::endl;
+		return;
+	}
+
+	RenderSettings settings;
+	settings.width = scene.camera.width;
+	settings.height = scene.camera.height;
+	settings.spp = this->spp;
+	settings.sampler_type = int32_t(this->sampler_type);
+	settings.frame = this->frame;
+	settings.max_depth = scene.max_depth;
+	settings.russian_roulette_depth = scene.russian_roulette_depth;
+	settings.light_sampler_type = int32_t(scene.light_sampler_type);
+
+	auto start = std::chrono::steady_clock::now();
+	coordinator.render(settings, this->tile_size, this->distributed_task_spp, this->frame_buffer);
+	outputProgress(1.f);
+
+	if (this->output_statistics)
+	{
+		std::cout << std::endl;
+		std::cout << "Distributed render: " << coordinator.worker_count << " workers, " << coordinator.reissued
+				  << " tasks reissued, "
+				  << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s"
+				  << std::endl;
+	}
+
+	this->saveResult(scene);
+	this->saveHDRResult(scene);
+}
+
+void Renderer::renderWorker(PathTracingScene& scene, const std::string& host, const int port)
+{
+	/* Workers may be started before the coordinator, so connecting is retried for a while */
+	Connection connection;
+	for (int attempt = 0; attempt < 100 && !connection.open(host, port); attempt++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+	if (!connection.isOpen())
+	{
+		std::cout << "Could not connect to " << host << ":" << port << std::endl;
+		return;
+	}
+
+	MessageType type;
+	std::vector<char> message;
+	RenderSettings settings;
+	if (!connection.receive(type, message) || type != MessageType::Setup || message.size() != sizeof(RenderSettings))
+	{
+		return;
+	}
+	std::memcpy(&settings, message.data(), sizeof(RenderSettings));
+	if (settings.width != int32_t(scene.camera.width) || settings.height != int32_t(scene.camera.height))
+	{
+		std::cout << "The scene of the worker does not match the image of the coordinator" << std::endl;
+		return;
+	}
+
+	this->spp = settings.spp;
+	this->sampler_type = SamplerType(settings.sampler_type);
+	this->frame = settings.frame;
+	scene.max_depth = settings.max_depth;
+	scene.russian_roulette_depth = settings.russian_roulette_depth;
+	scene.light_sampler_type = LightSamplerType(settings.light_sampler_type);
+	this->setCamera(scene.camera);
+
+	auto sampler = createSampler(this->sampler_type, this->spp, this->frame);
+	std::vector<Vector3f> radiance;
+	std::vector<char> result;
+	int task_count = 0;
+	while (connection.receive(type, message) && type == MessageType::Task && message.size() == sizeof(RenderTask))
+	{
+		RenderTask task;
+		std::memcpy(&task, message.data(), sizeof(RenderTask));
+
+		Tile tile;
+		tile.index = task.index;
+		tile.x_begin = task.x_begin;
+		tile.y_begin = task.y_begin;
+		tile.x_end = task.x_end;
+		tile.y_end = task.y_end;
+		this->renderTileSamples(scene, tile, task.sample_begin, task.sample_end, *sampler, radiance);
+
+		result.resize(sizeof(int32_t) + radiance.size() * sizeof(Vector3f));
+		std::memcpy(result.data(), &task.index, sizeof(int32_t));
+		std::memcpy(result.data() + sizeof(int32_t), radiance.data(), radiance.size() * sizeof(Vector3f));
+		if (!connection.send(MessageType::Result, result.data(), result.size()))
+		{
+			break;
+		}
+		task_count++;
+	}
+
+	if (this->output_statistics)
+	{
+		std::cout << "Worker rendered " << task_count << " tasks" << std::endl;
+	}
+}
+
+void Renderer::setCamera(const Camera& camera)
+{
 	float scale = std::tan(camera.fov * pi / 360.0f);
 	float image_aspect_ratio = float(camera.width) / float(camera.height);
-	Point eye_position = camera.position;
 	Point image_center = camera.look;
-	Direction n = image_center - eye_position;
+	Direction n = image_center - camera.position;
 
 	/* Calculate the local coordinate system on the imaging plane */
 	Vector3f local_y = glm::normalize(camera.up);
@@ -34,25 +234,445 @@ void Renderer::render(PathTracingScene& scene)
 	float r = t * image_aspect_ratio;
 	Point begin = image_center + local_y * t - local_x * r;
 
-	for (int i = 0; i < camera.height; i++)
+	this->eye_position = camera.position;
+	this->pixel_step_x = local_x * 2.0f * r / float(camera.width);
+	this->pixel_step_y = -local_y * 2.0f * t / float(camera.height);
+	this->pixel_origin = begin + this->pixel_step_x * 0.5f + this->pixel_step_y * 0.5f;
+}
+
+uint64_t Renderer::renderTile(PathTracingScene& scene, const Tile& tile, Sampler& sampler)
+{
+	int width = scene.camera.width;
+	uint64_t path_segments = 0;
+#if defined(__AVX2__)
+	/* Camera rays of up to PACKET_SIZE neighboring pixels are traced together, packets only pay off with AVX2 */
+	Ray rays[PACKET_SIZE];
+	IntersectResult results[PACKET_SIZE];
+	SamplerState states[PACKET_SIZE];
+	Vector3f colors[PACKET_SIZE];
+	for (int i = tile.y_begin; i < tile.y_end; i++)
 	{
-#pragma omp parallel for
-		for (int j = 0; j < camera.width; j++)
+		for (int j_begin = tile.x_begin; j_begin < tile.x_end; j_begin += PACKET_SIZE)
 		{
-			Point pixel_center = begin - local_y * float(i + 0.5) * 2.0f * t / float(camera.height) +
-								 local_x * float(j + 0.5) * 2.0f * r / float(camera.width);
-			Vector3f direction = glm::normalize(pixel_center - eye_position);
+			int count = std::min(PACKET_SIZE, tile.x_end - j_begin);
+			std::fill(colors, colors + count, Vector3f{0.0f});
 			for (int k = 0; k < this->spp; k++)
 			{
-				Ray ray{eye_position, direction};
-				this->frame_buffer[i * camera.width + j] += scene.shader(ray) / float(this->spp);
+				for (int lane = 0; lane < count; lane++)
+				{
+					rays[lane] = this->generateCameraRay(j_begin + lane, i, k, sampler);
+					states[lane] = sampler.getState();
+				}
+				scene.intersect8(rays, results, (1 << count) - 1);
+
+				for (int lane = 0; lane < count; lane++)
+				{
+					/* The shader continues after the dimensions used by the camera ray */
+					sampler.setState(states[lane]);
+					int path_length;
+					colors[lane] += scene.shader(rays[lane], results[lane], sampler, path_length) / float(this->spp);
+					path_segments += path_length;
+				}
+			}
+
+			for (int lane = 0; lane < count; lane++)
+			{
+				this->frame_buffer[i * width + j_begin + lane] = colors[lane];
+			}
+		}
+	}
+#else
+	for (int i = tile.y_begin; i < tile.y_end; i++)
+	{
+		for (int j = tile.x_begin; j < tile.x_end; j++)
+		{
+			Vector3f color{0.0f};
+			for (int k = 0; k < this->spp; k++)
+			{
+				Ray ray = this->generateCameraRay(j, i, k, sampler);
+				IntersectResult result = scene.intersect(ray);
+				int path_length;
+				color += scene.shader(ray, result, sampler, path_length) / float(this->spp);
+				path_segments += path_length;
+			}
+			this->frame_buffer[i * width + j] = color;
+		}
+	}
+#endif
+	return path_segments;
+}
+
+uint64_t Renderer::renderTileWavefront(PathTracingScene& scene,
+									   const Tile& tile,
+									   Sampler& sampler,
+									   WavefrontIntegrator& integrator)
+{
+	int width = scene.camera.width;
+	int pixel_count = (tile.x_end - tile.x_begin) * (tile.y_end - tile.y_begin);
+	int chunk_spp = std::max(this->max_wave_size / std::max(pixel_count, 1), 1);
+
+	/* Samples of a pixel are added in sample order, so the frame buffer sums match renderTile */
+	uint64_t path_segments = 0;
+	for (int sample_begin = 0; sample_begin < this->spp; sample_begin += chunk_spp)
+	{
+		auto start = std::chrono::steady_clock::now();
+		int sample_end = std::min(sample_begin + chunk_spp, this->spp);
+		integrator.clear();
+		for (int i = tile.y_begin; i < tile.y_end; i++)
+		{
+			for (int j = tile.x_begin; j < tile.x_end; j++)
+			{
+				for (int k = sample_begin; k < sample_end; k++)
+				{
+					Ray ray = this->generateCameraRay(j, i, k, sampler);
+					integrator.addPath(ray, i * width + j, sampler);
+				}
+			}
+		}
+		integrator.stage_time[size_t(WavefrontStage::Generate)] += std::chrono::steady_clock::now() - start;
+
+		path_segments += integrator.trace(scene, sampler);
+		integrator.accumulate(this->frame_buffer, 1.0f / float(this->spp));
+	}
+	return path_segments;
+}
+
+void Renderer::renderAdaptive(PathTracingScene& scene)
+{
+	auto camera = scene.camera;
+	int pixel_count = camera.width * camera.height;
+	int pass_spp = std::max(std::min(this->adaptive_pass_spp, this->spp), 1);
+	this->pixel_estimates.assign(pixel_count, PixelEstimate{});
+	this->pixel_active.assign(pixel_count, 1);
+
+	TileScheduler scheduler;
+	auto sampler = createSampler(this->sampler_type, this->spp, this->frame);
+
+	auto start = std::chrono::steady_clock::now();
+	auto isOverBudget = [&]() {
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		return this->time_budget > 0.0f && seconds >= this->time_budget;
+	};
+
+	int passes = 0;
+	int active = pixel_count;
+	while (active > 0)
+	{
+		/* Tiles without active pixels are handed out as well, but return right away */
+		scheduler.init(camera.width, camera.height, this->tile_size, omp_get_max_threads());
+
+#pragma omp parallel
+		{
+			int thread = omp_get_thread_num();
+			auto thread_sampler = sampler->clone();
+			Tile tile;
+			while (scheduler.next(thread, tile))
+			{
+				/* Later passes double the samples, so they stop at the budget instead of finishing; the first pass
+				   always completes so every pixel has an estimate */
+				if (passes > 0 && isOverBudget())
+				{
+					break;
+				}
+
+				auto tile_start = std::chrono::steady_clock::now();
+				this->renderTileAdaptive(scene, tile, *thread_sampler, pass_spp);
+				scheduler.finish(thread, std::chrono::steady_clock::now() - tile_start);
 			}
 		}
-		outputProgress(i / (float)camera.height);
+		passes++;
+		active = this->updateActivePixels(camera.width, camera.height);
+		outputProgress(1.0f - float(active) / float(pixel_count));
+
+		if (isOverBudget())
+		{
+			break;
+		}
 	}
 	outputProgress(1.f);
 
+	if (this->output_statistics)
+	{
+		uint64_t samples = 0;
+		for (auto& estimate : this->pixel_estimates)
+		{
+			samples += estimate.count;
+		}
+
+		std::cout << std::endl;
+		std::cout << "Adaptive sampling: " << passes << " passes, " << samples << " samples, "
+				  << double(samples) / double(pixel_count) << " spp on average, " << active
+				  << " pixels unconverged" << std::endl;
+	}
+}
+
+void Renderer::renderTileAdaptive(PathTracingScene& scene, const Tile& tile, Sampler& sampler, const int samples)
+{
+	int width = scene.camera.width;
+	for (int i = tile.y_begin; i < tile.y_end; i++)
+	{
+		for (int j = tile.x_begin; j < tile.x_end; j++)
+		{
+			if (this->pixel_active[i * width + j] == 0)
+			{
+				continue;
+			}
+
+			/*
+			 * Every pass doubles the samples of an active pixel, which keeps the number of passes logarithmic and the
+			 * Sobol points of a pixel a complete power-of-two set. Sample indices continue where the previous pass
+			 * stopped, so the pixel keeps one sample sequence.
+			 */
+			PixelEstimate& estimate = this->pixel_estimates[i * width + j];
+			int end = std::min(estimate.count + std::max(samples, estimate.count), this->spp);
+			for (int k = estimate.count; k < end; k++)
+			{
+				Ray ray = this->generateCameraRay(j, i, k, sampler);
+				IntersectResult result = scene.intersect(ray);
+				int path_length;
+				estimate.add(scene.shader(ray, result, sampler, path_length));
+			}
+			this->frame_buffer[i * width + j] = estimate.mean;
+		}
+	}
+}
+
+int Renderer::updateActivePixels(const int width, const int height)
+{
+	/*
+	 * A pixel whose few samples all missed a rare bright path looks converged on its own, so the error of a pixel is
+	 * the largest error in its 3x3 neighbourhood. Stopping such pixels early would darken the image.
+	 */
+	int active = 0;
+	for (int i = 0; i < height; i++)
+	{
+		for (int j = 0; j < width; j++)
+		{
+			float error = 0.0f;
+			for (int y = std::max(i - 1, 0); y <= std::min(i + 1, height - 1); y++)
+			{
+				for (int x = std::max(j - 1, 0); x <= std::min(j + 1, width - 1); x++)
+				{
+					error = std::max(error, this->pixel_estimates[y * width + x].getError());
+				}
+			}
+
+			bool is_active = this->pixel_estimates[i * width + j].count < this->spp && error > this->adaptive_threshold;
+			this->pixel_active[i * width + j] = is_active ? 1 : 0;
+			active += is_active ? 1 : 0;
+		}
+	}
+	return active;
+}
+
+void Renderer::renderProgressive(PathTracingScene& scene)
+{
+	auto camera = scene.camera;
+	int pixel_count = camera.width * camera.height;
+	std::string path = this->getCheckpointPath(scene);
+
+	/* A checkpoint is only continued if it was written for the same image and sample sequence, the stratified sampler
+	 * lays out its strata for the target spp and only continues a render with the same spp */
+	RenderCheckpoint& state = this->checkpoint;
+	bool resumed = this->resume && state.load(path) && state.width == int(camera.width) &&
+				   state.height == int(camera.height) && state.sampler_type == this->sampler_type &&
+				   state.seed == uint64_t(this->frame) && state.max_depth == scene.max_depth &&
+				   state.russian_roulette_depth == scene.russian_roulette_depth &&
+				   state.light_sampler_type == scene.light_sampler_type &&
+				   (state.sampler_type != SamplerType::Stratified || state.spp == this->spp);
+	if (!resumed)
+	{
+		if (this->resume)
+		{
+			std::cout << "No matching checkpoint at " << path << ", starting a new render" << std::endl;
+		}
+		state = RenderCheckpoint{};
+		state.width = camera.width;
+		state.height = camera.height;
+		state.sampler_type = this->sampler_type;
+		state.seed = uint64_t(this->frame);
+		state.max_depth = scene.max_depth;
+		state.russian_roulette_depth = scene.russian_roulette_depth;
+		state.light_sampler_type = scene.light_sampler_type;
+		state.sample_counts.assign(pixel_count, 0);
+		state.accumulation.assign(pixel_count, Vector3f{0.0f});
+	}
+	state.spp = this->spp;
+	for (int i = 0; i < pixel_count; i++)
+	{
+		if (state.sample_counts[i] > 0)
+		{
+			this->frame_buffer[i] = state.accumulation[i] / float(state.sample_counts[i]);
+		}
+	}
+
+	TileScheduler scheduler;
+	auto sampler = createSampler(this->sampler_type, this->spp, this->frame);
+	int pass_spp = std::max(this->progressive_pass_spp, 1);
+
+	auto start = std::chrono::steady_clock::now();
+	auto last_checkpoint = start;
+	double elapsed = state.elapsed;
+	auto getSampleProgress = [&]() {
+		uint32_t samples = *std::min_element(state.sample_counts.begin(), state.sample_counts.end());
+		return std::min(float(samples) / float(this->spp), 1.0f);
+	};
+
+	while (getSampleProgress() < 1.0f)
+	{
+		scheduler.init(camera.width, camera.height, this->tile_size, omp_get_max_threads());
+
+#pragma omp parallel
+		{
+			int thread = omp_get_thread_num();
+			auto thread_sampler = sampler->clone();
+			Tile tile;
+			while (scheduler.next(thread, tile))
+			{
+				auto tile_start = std::chrono::steady_clock::now();
+				this->renderTileProgressive(scene, tile, *thread_sampler, pass_spp);
+				scheduler.finish(thread, std::chrono::steady_clock::now() - tile_start);
+			}
+		}
+		state.passes++;
+		outputProgress(getSampleProgress());
+
+		auto now = std::chrono::steady_clock::now();
+		state.elapsed = elapsed + std::chrono::duration<double>(now - start).count();
+		if (std::chrono::duration<double>(now - last_checkpoint).count() >= this->checkpoint_interval)
+		{
+			state.save(path);
+			this->saveResult(scene);
+			last_checkpoint = now;
+		}
+
+		if (this->time_budget > 0.0f && std::chrono::duration<double>(now - start).count() >= this->time_budget)
+		{
+			break;
+		}
+	}
+
+	state.save(path);
 	this->saveResult(scene);
+	this->saveHDRResult(scene);
+
+	if (this->output_statistics)
+	{
+		std::cout << std::endl;
+		std::cout << "Progressive render: " << state.passes << " passes, " << getSampleProgress() * this->spp << " of "
+				  << this->spp << " spp, " << state.elapsed << " s in total" << (resumed ? " (resumed)" : "")
+				  << std::endl;
+	}
+}
+
+void Renderer::renderTileProgressive(PathTracingScene& scene, const Tile& tile, Sampler& sampler, const int samples)
+{
+	int width = scene.camera.width;
+	RenderCheckpoint& state = this->checkpoint;
+	for (int i = tile.y_begin; i < tile.y_end; i++)
+	{
+		for (int j = tile.x_begin; j < tile.x_end; j++)
+		{
+			/* Sample indices continue from the sample count, also after resuming from a checkpoint */
+			int index = i * width + j;
+			int begin = int(state.sample_counts[index]);
+			int end = std::min(begin + samples, this->spp);
+			for (int k = begin; k < end; k++)
+			{
+				Ray ray = this->generateCameraRay(j, i, k, sampler);
+				IntersectResult result = scene.intersect(ray);
+				int path_length;
+				state.accumulation[index] += scene.shader(ray, result, sampler, path_length);
+			}
+
+			state.sample_counts[index] = uint32_t(std::max(end, begin));
+			if (state.sample_counts[index] > 0)
+			{
+				this->frame_buffer[index] = state.accumulation[index] / float(state.sample_counts[index]);
+			}
+		}
+	}
+}
+
+void Renderer::renderTileSamples(PathTracingScene& scene,
+								 const Tile& tile,
+								 const int sample_begin,
+								 const int sample_end,
+								 const Sampler& sampler,
+								 std::vector<Vector3f>& radiance)
+{
+	int tile_width = tile.x_end - tile.x_begin;
+	radiance.assign(size_t(tile_width) * size_t(tile.y_end - tile.y_begin), Vector3f{0.0f});
+
+#pragma omp parallel
+	{
+		auto thread_sampler = sampler.clone();
+
+#pragma omp for schedule(dynamic, 1)
+		for (int i = tile.y_begin; i < tile.y_end; i++)
+		{
+			for (int j = tile.x_begin; j < tile.x_end; j++)
+			{
+				Vector3f& pixel = radiance[size_t(i - tile.y_begin) * tile_width + (j - tile.x_begin)];
+				for (int k = sample_begin; k < sample_end; k++)
+				{
+					Ray ray = this->generateCameraRay(j, i, k, *thread_sampler);
+					IntersectResult result = scene.intersect(ray);
+					int path_length;
+					pixel += scene.shader(ray, result, *thread_sampler, path_length);
+				}
+			}
+		}
+	}
+}
+
+std::string Renderer::getCheckpointPath(const PathTracingScene& scene) const
+{
+	if (!this->checkpoint_path.empty())
+	{
+		return this->checkpoint_path;
+	}
+	return std::string(ROOT_DIR) + "/results/" + scene.name + "_checkpoint_cpu.bin";
+}
+
+void Renderer::saveHDRResult(const PathTracingScene& scene)
+{
+	std::string path = std::string(ROOT_DIR) + "/results/" + scene.name + "_spp_" + std::to_string(this->spp) +
+					   "_depth_" + std::to_string(scene.max_depth) + "_cpu.hdr";
+
+	stbi_write_hdr(path.c_str(), scene.camera.width, scene.camera.height, 3, &this->frame_buffer[0].x);
+}
+
+void Renderer::saveSampleHeatmap(const PathTracingScene& scene)
+{
+	std::string path = std::string(ROOT_DIR) + "/results/" + scene.name + "_spp_" + std::to_string(this->spp) +
+					   "_depth_" + std::to_string(scene.max_depth) + "_heatmap_cpu.bmp";
+
+	int width = scene.camera.width;
+	int height = scene.camera.height;
+
+	std::vector<unsigned char> image_data(width * height * 3);
+	for (auto i = 0; i < width * height; ++i)
+	{
+		float t = clamp(0, 1, float(this->pixel_estimates[i].count) / float(this->spp));
+		image_data[i * 3 + 0] = (unsigned char)(255 * t);
+		image_data[i * 3 + 1] = (unsigned char)(255 * (1.0f - std::abs(2.0f * t - 1.0f)));
+		image_data[i * 3 + 2] = (unsigned char)(255 * (1.0f - t));
+	}
+
+	stbi_write_bmp(path.c_str(), width, height, 3, image_data.data());
+}
+
+Ray Renderer::generateCameraRay(const int x, const int y, const int index, Sampler& sampler) const
+{
+	/* Samples only depend on the pixel and sample index, so the image does not depend on the thread count */
+	sampler.startPixelSample(Vector2i{x, y}, index);
+
+	/* Jitter the primary ray inside the pixel footprint */
+	Vector2f jitter = sampler.get2D();
+	Point pixel_point = this->pixel_origin + this->pixel_step_y * (float(y) + jitter.y - 0.5f) +
+						this->pixel_step_x * (float(x) + jitter.x - 0.5f);
+	return Ray{this->eye_position, glm::normalize(pixel_point - this->eye_position)};
 }
 
 void Renderer::saveResult(const PathTracingScene& scene)
@@ -0,0 +1,357 @@
+#include <sampler.h>
+
+namespace
+{
+/* 2^-32, the largest float below one is used to keep samples inside [0, 1) */
+constexpr float UINT_TO_FLOAT = 2.3283064365386963e-10f;
+constexpr float ONE_MINUS_EPSILON = 0.99999994f;
+
+float toFloat(const uint32_t value)
+{
+	return std::min(float(value) * UINT_TO_FLOAT, ONE_MINUS_EPSILON);
+}
+
+uint32_t reverseBits(uint32_t value)
+{
+	value = (value << 16) | (value >> 16);
+	value = ((value & 0x00ff00ffu) << 8) | ((value & 0xff00ff00u) >> 8);
+	value = ((value & 0x0f0f0f0fu) << 4) | ((value & 0xf0f0f0f0u) >> 4);
+	value = ((value & 0x33333333u) << 2) | ((value & 0xccccccccu) >> 2);
+	value = ((value & 0x55555555u) << 1) | ((value & 0xaaaaaaaau) >> 1);
+	return value;
+}
+
+/* Hash-based nested uniform scrambling, Burley 2020, "Practical Hash-based Owen Scrambling" */
+uint32_t laineKarrasPermutation(uint32_t value, const uint32_t seed)
+{
+	value += seed;
+	value ^= value * 0x6c50b47cu;
+	value ^= value * 0xb82f1e52u;
+	value ^= value * 0xc7afe638u;
+	value ^= value * 0x8d22f6e6u;
+	return value;
+}
+
+uint32_t nestedUniformScramble(uint32_t value, const uint32_t seed)
+{
+	return reverseBits(laineKarrasPermutation(reverseBits(value), seed));
+}
+
+/* Generator matrices of the first two Sobol dimensions */
+struct SobolDirections
+{
+	SobolDirections()
+	{
+		uint32_t m = 1;
+		for (int k = 0; k < 32; k++)
+		{
+			this->values[0][k] = 1u << (31 - k);
+			this->values[1][k] = m << (31 - k);
+			m = (m << 1) ^ m;
+		}
+	}
+
+	uint32_t values[2][32];
+};
+
+uint32_t sobol(uint32_t index, const int dimension)
+{
+	static const SobolDirections directions;
+
+	/* The generator matrix of the first dimension is the identity in reversed bit order */
+	if (dimension == 0)
+	{
+		return reverseBits(index);
+	}
+
+	uint32_t result = 0;
+	for (int k = 0; index != 0; index >>= 1, k++)
+	{
+		if (index & 1u)
+		{
+			result ^= directions.values[dimension][k];
+		}
+	}
+	return result;
+}
+
+Vector2f owenScrambledSobol(const uint32_t index, const uint64_t hash)
+{
+	uint32_t shuffled = nestedUniformScramble(index, uint32_t(hash));
+	uint32_t x = nestedUniformScramble(sobol(shuffled, 0), uint32_t(hash >> 32));
+	uint32_t y = nestedUniformScramble(sobol(shuffled, 1), uint32_t(mixBits(hash)));
+	return Vector2f{toFloat(x), toFloat(y)};
+}
+
+/* Random permutation element without storage, Kensler 2013, "Correlated Multi-Jittered Sampling" */
+uint32_t permutationElement(uint32_t index, const uint32_t length, const uint32_t seed)
+{
+	uint32_t mask = length - 1;
+	mask |= mask >> 1;
+	mask |= mask >> 2;
+	mask |= mask >> 4;
+	mask |= mask >> 8;
+	mask |= mask >> 16;
+
+	do
+	{
+		index ^= seed;
+		index *= 0xe170893du;
+		index ^= seed >> 16;
+		index ^= (index & mask) >> 4;
+		index ^= seed >> 8;
+		index *= 0x0929eb3fu;
+		index ^= seed >> 23;
+		index ^= (index & mask) >> 1;
+		index *= 1u | seed >> 27;
+		index *= 0x6935fa69u;
+		index ^= (index & mask) >> 11;
+		index *= 0x74dcb303u;
+		index ^= (index & mask) >> 2;
+		index *= 0x9e501cc3u;
+		index ^= (index & mask) >> 2;
+		index *= 0xc860a3dfu;
+		index &= mask;
+		index ^= index >> 5;
+	} while (index >= length);
+
+	return (index + seed) % length;
+}
+
+uint64_t getPixelKey(const Vector2i& pixel)
+{
+	return (uint64_t(uint32_t(pixel.x)) << 32) | uint64_t(uint32_t(pixel.y));
+}
+} // namespace
+
+Sampler::Sampler(const int samples_per_pixel, const uint64_t seed)
+{
+	this->samples_per_pixel = std::max(samples_per_pixel, 1);
+	this->seed = seed;
+}
+
+void Sampler::startPixelSample(const Vector2i& pixel, const int index)
+{
+	this->pixel = pixel;
+	this->sample_index = index;
+	this->dimension = 0;
+	this->random.setSequence(hashSeed(getPixelKey(pixel), index, this->seed));
+}
+
+SamplerState Sampler::getState() const
+{
+	return SamplerState{this->pixel, this->sample_index, this->dimension, this->random};
+}
+
+void Sampler::setState(const SamplerState& state)
+{
+	this->pixel = state.pixel;
+	this->sample_index = state.sample_index;
+	this->dimension = state.dimension;
+	this->random = state.random;
+}
+
+uint64_t Sampler::getDimensionHash() const
+{
+	return hashSeed(getPixelKey(this->pixel), this->dimension, this->seed);
+}
+
+float IndependentSampler::get1D()
+{
+	this->dimension++;
+	return this->random.nextFloat();
+}
+
+Vector2f IndependentSampler::get2D()
+{
+	this->dimension += 2;
+	float x = this->random.nextFloat();
+	float y = this->random.nextFloat();
+	return Vector2f{x, y};
+}
+
+std::unique_ptr<Sampler> IndependentSampler::clone() const
+{
+	return std::make_unique<IndependentSampler>(*this);
+}
+
+float StratifiedSampler::get1D()
+{
+	uint64_t hash = this->getDimensionHash();
+	this->dimension++;
+
+	/* Sample indices past the sample count start a new, differently shuffled round of strata */
+	uint32_t count = uint32_t(this->samples_per_pixel);
+	uint32_t round = uint32_t(this->sample_index) / count;
+	uint32_t stratum = permutationElement(uint32_t(this->sample_index) % count, count, uint32_t(hash) ^ round);
+	return std::min((float(stratum) + this->random.nextFloat()) / float(count), ONE_MINUS_EPSILON);
+}
+
+Vector2f StratifiedSampler::get2D()
+{
+	uint64_t hash = this->getDimensionHash();
+	this->dimension += 2;
+
+	uint32_t count = uint32_t(this->samples_per_pixel);
+	uint32_t round = uint32_t(this->sample_index) / count;
+	uint32_t index = uint32_t(this->sample_index) % count;
+	float jitter_x = this->random.nextFloat();
+	float jitter_y = this->random.nextFloat();
+
+	uint32_t resolution = uint32_t(std::sqrt(float(count)) + 0.5f);
+	if (resolution * resolution == count)
+	{
+		/* Jittered grid */
+		uint32_t stratum = permutationElement(index, count, uint32_t(hash) ^ round);
+		float x = (float(stratum % resolution) + jitter_x) / float(resolution);
+		float y = (float(stratum / resolution) + jitter_y) / float(resolution);
+		return Vector2f{std::min(x, ONE_MINUS_EPSILON), std::min(y, ONE_MINUS_EPSILON)};
+	}
+	else
+	{
+		/* Latin hypercube */
+		uint32_t stratum_x = permutationElement(index, count, uint32_t(hash) ^ round);
+		uint32_t stratum_y = permutationElement(index, count, uint32_t(hash >> 32) ^ round);
+		float x = (float(stratum_x) + jitter_x) / float(count);
+		float y = (float(stratum_y) + jitter_y) / float(count);
+		return Vector2f{std::min(x, ONE_MINUS_EPSILON), std::min(y, ONE_MINUS_EPSILON)};
+	}
+}
+
+std::unique_ptr<Sampler> StratifiedSampler::clone() const
+{
+	return std::make_unique<StratifiedSampler>(*this);
+}
+
+float SobolSampler::get1D()
+{
+	uint64_t hash = this->getDimensionHash();
+	this->dimension++;
+	return owenScrambledSobol(uint32_t(this->sample_index), hash).x;
+}
+
+Vector2f SobolSampler::get2D()
+{
+	uint64_t hash = this->getDimensionHash();
+	this->dimension += 2;
+	return owenScrambledSobol(uint32_t(this->sample_index), hash);
+}
+
+std::unique_ptr<Sampler> SobolSampler::clone() const
+{
+	return std::make_unique<SobolSampler>(*this);
+}
+
+float BlueNoiseSampler::get1D()
+{
+	/* The point set only depends on the dimension, the pixel only selects the rotation */
+	uint64_t hash = hashSeed(0, this->dimension, this->seed);
+	float value = owenScrambledSobol(uint32_t(this->sample_index), hash).x + this->getOffset(this->dimension);
+	this->dimension++;
+	return std::min(value - std::floor(value), ONE_MINUS_EPSILON);
+}
+
+Vector2f BlueNoiseSampler::get2D()
+{
+	uint64_t hash = hashSeed(0, this->dimension, this->seed);
+	Vector2f value = owenScrambledSobol(uint32_t(this->sample_index), hash);
+	value.x += this->getOffset(this->dimension);
+	value.y += this->getOffset(this->dimension + 1);
+	this->dimension += 2;
+	return Vector2f{std::min(value.x - std::floor(value.x), ONE_MINUS_EPSILON),
+					std::min(value.y - std::floor(value.y), ONE_MINUS_EPSILON)};
+}
+
+std::unique_ptr<Sampler> BlueNoiseSampler::clone() const
+{
+	return std::make_unique<BlueNoiseSampler>(*this);
+}
+
+float BlueNoiseSampler::getOffset(const int dimension) const
+{
+	/* Every dimension reads the mask with its own toroidal shift to keep dimensions decorrelated */
+	uint64_t shift = mixBits(uint64_t(dimension) + this->seed);
+	int x = (this->pixel.x + int(shift & 0xffu)) & (BLUE_NOISE_SIZE - 1);
+	int y = (this->pixel.y + int((shift >> 8) & 0xffu)) & (BLUE_NOISE_SIZE - 1);
+	return getBlueNoiseMask()[y * BLUE_NOISE_SIZE + x];
+}
+
+std::unique_ptr<Sampler> createSampler(const SamplerType type, const int samples_per_pixel, const uint64_t seed)
+{
+	switch (type)
+	{
+	case SamplerType::Independent:
+		{
+			return std::make_unique<IndependentSampler>(samples_per_pixel, seed);
+		}
+	case SamplerType::Stratified:
+		{
+			return std::make_unique<StratifiedSampler>(samples_per_pixel, seed);
+		}
+	case SamplerType::BlueNoise:
+		{
+			return std::make_unique<BlueNoiseSampler>(samples_per_pixel, seed);
+		}
+	case SamplerType::Sobol:
+	default:
+		{
+			return std::make_unique<SobolSampler>(samples_per_pixel, seed);
+		}
+	}
+}
+
+const std::vector<float>& getBlueNoiseMask()
+{
+	static const std::vector<float> mask = [] {
+		const int size = BLUE_NOISE_SIZE;
+		const int count = size * size;
+		const float sigma = 1.9f;
+
+		/* Toroidal Gaussian energy kernel */
+		std::vector<float> kernel(count);
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				float dx = float(std::min(x, size - x));
+				float dy = float(std::min(y, size - y));
+				kernel[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * sigma * sigma));
+			}
+		}
+
+		/* Void-and-cluster ranking: repeatedly fill the largest void, the insertion order becomes the threshold */
+		std::vector<float> energy(count, 0.0f);
+		std::vector<bool> occupied(count, false);
+		std::vector<float> result(count, 0.0f);
+		for (int rank = 0; rank < count; rank++)
+		{
+			int best = -1;
+			for (int i = 0; i < count; i++)
+			{
+				if (!occupied[i] && (best == -1 || energy[i] < energy[best]))
+				{
+					best = i;
+				}
+			}
+
+			occupied[best] = true;
+			result[best] = (float(rank) + 0.5f) / float(count);
+
+			int best_x = best % size;
+			int best_y = best / size;
+			for (int y = 0; y < size; y++)
+			{
+				for (int x = 0; x < size; x++)
+				{
+					int dx = (x - best_x) & (size - 1);
+					int dy = (y - best_y) & (size - 1);
+					energy[y * size + x] += kernel[dy * size + dx];
+				}
+			}
+		}
+
+		return result;
+	}();
+
+	return mask;
+}
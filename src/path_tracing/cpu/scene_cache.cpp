@@ -0,0 +1,911 @@
+#include <scene_cache.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <type_traits>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+/* "PTSC" followed by the format version, checked before anything else is read */
+constexpr uint32_t SCENE_CACHE_MAGIC = 0x43535450;
+constexpr uint32_t SCENE_CACHE_VERSION = 8;
+
+/* Arrays start at multiples of the wide BVH node alignment */
+constexpr size_t SCENE_CACHE_ALIGNMENT = 64;
+
+/* The sizes of the types stored as raw bytes, a cache written by a build with another layout is rejected */
+struct CacheLayout
+{
+	uint32_t bvh_width{uint32_t(BVH_WIDTH)};
+	uint32_t vertex_size{uint32_t(sizeof(Vertex))};
+	uint32_t triangle_size{uint32_t(sizeof(TriangleRecord))};
+	uint32_t bvh_size{uint32_t(sizeof(BVH))};
+	uint32_t scene_bvh_size{uint32_t(sizeof(SceneBVH))};
+	uint32_t wide_bvh_node_size{uint32_t(sizeof(WideBVHNode<BVH_WIDTH>))};
+	uint32_t point_light_size{uint32_t(sizeof(PointLight))};
+	uint32_t direction_light_size{uint32_t(sizeof(DirectionLight))};
+	uint32_t index_size{uint32_t(sizeof(Index))};
+	uint32_t alias_entry_size{uint32_t(sizeof(AliasEntry))};
+	uint32_t light_tree_node_size{uint32_t(sizeof(LightTreeNode))};
+	uint32_t light_emitter_size{uint32_t(sizeof(LightEmitter))};
+
+	bool operator==(const CacheLayout& other) const
+	{
+		return std::memcmp(this, &other, sizeof(CacheLayout)) == 0;
+	}
+};
+
+/* The builder settings the BVHs of the cache were built with */
+struct CacheBuilder
+{
+	int32_t max_leaf_size{0};
+	int32_t bin_count{0};
+	float traversal_cost{0.0f};
+	float intersection_cost{0.0f};
+
+	explicit CacheBuilder(const BVHBuilder& builder = BVHBuilder{})
+	{
+		this->max_leaf_size = builder.max_leaf_size;
+		this->bin_count = builder.bin_count;
+		this->traversal_cost = builder.traversal_cost;
+		this->intersection_cost = builder.intersection_cost;
+	}
+
+	bool operator==(const CacheBuilder& other) const
+	{
+		return std::memcmp(this, &other, sizeof(CacheBuilder)) == 0;
+	}
+};
+
+constexpr uint64_t HASH_OFFSET = 0xcbf29ce484222325ull;
+constexpr uint64_t HASH_PRIME = 0x100000001b3ull;
+
+/* FNV-1a over 8-byte words, so hashing a large OBJ file runs at about memory bandwidth */
+uint64_t hashBytes(const char* data, const size_t size, uint64_t hash)
+{
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+	{
+		uint64_t word;
+		std::memcpy(&word, data + i, sizeof(uint64_t));
+		hash = (hash ^ word) * HASH_PRIME;
+		hash ^= hash >> 32;
+	}
+	for (; i < size; i++)
+	{
+		hash = (hash ^ uint8_t(data[i])) * HASH_PRIME;
+	}
+	return hash;
+}
+
+/**
+ * @brief Writes values and arrays to a cache file, padding every array to SCENE_CACHE_ALIGNMENT.
+ */
+class CacheWriter
+{
+public:
+	explicit CacheWriter(std::ofstream& file) : file(file)
+	{
+	}
+
+	template <typename T>
+	void value(const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values are stored as bytes");
+		this->write(&value, sizeof(T));
+	}
+
+	void string(const std::string& string)
+	{
+		this->value(uint64_t(string.size()));
+		this->write(string.data(), string.size());
+	}
+
+	template <typename T>
+	void array(const std::vector<T>& array)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable arrays are stored as bytes");
+		this->value(uint64_t(array.size()));
+
+		static const char padding[SCENE_CACHE_ALIGNMENT] = {};
+		this->write(padding, (SCENE_CACHE_ALIGNMENT - this->offset % SCENE_CACHE_ALIGNMENT) % SCENE_CACHE_ALIGNMENT);
+		this->write(array.data(), array.size() * sizeof(T));
+	}
+
+	template <typename T>
+	void geometry(const PathTracingMesh& mesh, const std::vector<T>& array, const int cache_array)
+	{
+		if (mesh.geometry_cache == nullptr)
+		{
+			this->array(array);
+			return;
+		}
+
+		/* The arrays of out-of-core meshes are copied from the geometry cache, in the same layout as in memory */
+		int count = mesh.geometry_cache->getCount(cache_array);
+		this->value(uint64_t(count));
+		static const char padding[SCENE_CACHE_ALIGNMENT] = {};
+		this->write(padding, (SCENE_CACHE_ALIGNMENT - this->offset % SCENE_CACHE_ALIGNMENT) % SCENE_CACHE_ALIGNMENT);
+		for (int i = 0; i < count; i++)
+		{
+			this->write(&mesh.geometry_cache->get<T>(cache_array, i), sizeof(T));
+		}
+	}
+
+private:
+	void write(const void* data, const size_t size)
+	{
+		this->file.write(static_cast<const char*>(data), std::streamsize(size));
+		this->offset += size;
+	}
+
+	std::ofstream& file;
+
+	size_t offset{0};
+};
+
+/**
+ * @brief Reads what CacheWriter wrote from a mapped file, every read past the end makes the reader invalid.
+ */
+class CacheReader
+{
+public:
+	CacheReader(const char* data, const size_t size) : data(data), size(size)
+	{
+	}
+
+	template <typename T>
+	void value(T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values are stored as bytes");
+		this->read(&value, sizeof(T));
+	}
+
+	void string(std::string& string)
+	{
+		uint64_t length = 0;
+		this->value(length);
+		if (this->available(length))
+		{
+			string.assign(this->data + this->offset, size_t(length));
+			this->offset += size_t(length);
+		}
+	}
+
+	template <typename T>
+	void array(std::vector<T>& array)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable arrays are stored as bytes");
+		uint64_t count = 0;
+		this->value(count);
+		this->offset += (SCENE_CACHE_ALIGNMENT - this->offset % SCENE_CACHE_ALIGNMENT) % SCENE_CACHE_ALIGNMENT;
+		if (count > this->size / sizeof(T) || !this->available(count * sizeof(T)))
+		{
+			this->valid = false;
+			return;
+		}
+
+		array.resize(size_t(count));
+		this->read(array.data(), size_t(count) * sizeof(T));
+	}
+
+	template <typename T>
+	void geometry(PathTracingMesh& mesh, std::vector<T>& array, int& cache_array)
+	{
+		if (this->geometry_cache == nullptr)
+		{
+			this->array(array);
+			return;
+		}
+
+		/* The arrays of out-of-core meshes stay in the file, the mesh only remembers where they are */
+		uint64_t count = 0;
+		this->value(count);
+		this->offset += (SCENE_CACHE_ALIGNMENT - this->offset % SCENE_CACHE_ALIGNMENT) % SCENE_CACHE_ALIGNMENT;
+		if (count > uint64_t(std::numeric_limits<int>::max()) || !this->available(count * sizeof(T)))
+		{
+			this->valid = false;
+			return;
+		}
+
+		array.clear();
+		mesh.geometry_cache = this->geometry_cache;
+		cache_array = this->geometry_cache->addArray(this->offset, int(count), sizeof(T));
+		this->offset += size_t(count) * sizeof(T);
+	}
+
+	uint64_t remaining() const
+	{
+		return this->offset < this->size ? this->size - this->offset : 0;
+	}
+
+	/* Whether every read so far was inside the file. */
+	bool valid{true};
+
+	/* The geometry cache the mesh arrays are left in, nullptr to read them into memory. */
+	GeometryCache* geometry_cache{nullptr};
+
+private:
+	bool available(const uint64_t bytes)
+	{
+		this->valid = this->valid && this->offset <= this->size && bytes <= this->size - this->offset;
+		return this->valid;
+	}
+
+	void read(void* value, const size_t bytes)
+	{
+		if (this->available(bytes))
+		{
+			std::memcpy(value, this->data + this->offset, bytes);
+			this->offset += bytes;
+		}
+	}
+
+	const char* data;
+
+	size_t size;
+
+	size_t offset{0};
+};
+
+/* The transfer functions are shared by saving and loading, so both always agree on the field order */
+
+template <typename Stream, typename T>
+void transferCamera(Stream& stream, T& camera)
+{
+	stream.string(camera.name);
+	stream.value(camera.width);
+	stream.value(camera.height);
+	stream.value(camera.fov);
+	stream.value(camera.fovy);
+	stream.value(camera.aspect_ratio);
+	stream.value(camera.near_plane);
+	stream.value(camera.far_plane);
+	stream.value(camera.position);
+	stream.value(camera.look);
+	stream.value(camera.up);
+	stream.value(camera.type);
+}
+
+template <typename Stream, typename T>
+void transferMaterial(Stream& stream, T& material)
+{
+	stream.string(material.name);
+	stream.value(material.ka);
+	stream.value(material.kd);
+	stream.value(material.ks);
+	stream.value(material.tr);
+	stream.value(material.ns);
+	stream.value(material.ni);
+	stream.value(material.diffuse_texture);
+	stream.value(material.specular_texture);
+	stream.value(material.type);
+	stream.value(material.albedo);
+	stream.value(material.metallic);
+	stream.value(material.roughness);
+	stream.value(material.albedo_texture);
+	stream.value(material.bottom_albedo);
+	stream.value(material.bottom_metallic);
+	stream.value(material.bottom_roughness);
+	stream.value(material.bottom_albedo_texture);
+}
+
+template <typename Stream, typename T>
+void transferTexture(Stream& stream, T& texture)
+{
+	stream.string(texture.name);
+	stream.array(texture.data);
+	stream.value(texture.width);
+	stream.value(texture.height);
+	stream.value(texture.channel);
+	stream.string(texture.texture_path);
+	stream.value(texture.minify);
+	stream.value(texture.magnify);
+	stream.value(texture.mipmap);
+	stream.value(texture.address_u);
+	stream.value(texture.address_v);
+	stream.value(texture.address_w);
+}
+
+template <typename Stream, typename T>
+void transferMesh(Stream& stream, T& mesh)
+{
+	stream.geometry(mesh, mesh.vertices, mesh.geometry_vertices);
+	stream.geometry(mesh, mesh.indices, mesh.geometry_indices);
+	stream.geometry(mesh, mesh.triangles, mesh.geometry_triangles);
+	stream.value(mesh.bounding_box);
+	stream.value(mesh.area);
+	stream.array(mesh.bvh);
+	stream.array(mesh.triangle_indices);
+	stream.value(mesh.sah_cost);
+	stream.value(mesh.build_sah_cost);
+	stream.array(mesh.vertex_index);
+	stream.array(mesh.triangle_table.entries);
+	stream.array(mesh.wide_bvh.nodes);
+	stream.array(mesh.wide_bvh.primitive_indices);
+}
+
+/* Meshes are shared by pointer, the reader creates them as it reads */
+PathTracingMesh& getMesh(std::shared_ptr<PathTracingMesh>& mesh)
+{
+	if (mesh == nullptr)
+	{
+		mesh = std::make_shared<PathTracingMesh>();
+	}
+	return *mesh;
+}
+
+const PathTracingMesh& getMesh(const std::shared_ptr<PathTracingMesh>& mesh)
+{
+	return *mesh;
+}
+
+template <typename Stream, typename T>
+void transferObject(Stream& stream, T& object)
+{
+	stream.string(object.name);
+	stream.value(object.material_index);
+	stream.value(object.model);
+	stream.value(object.mesh_index);
+	stream.value(object.transformed);
+	stream.value(object.inverse_model);
+	stream.value(object.normal_model);
+	transferMaterial(stream, object.material);
+	stream.value(object.bounding_box);
+	stream.value(object.area);
+	stream.value(object.is_light);
+	stream.value(object.radiance);
+	stream.value(object.triangle_count);
+}
+
+/* Vectors of types holding strings are stored element by element */
+template <typename Stream, typename T, typename Transfer>
+void transferVector(Stream& stream, std::vector<T>& vector, Transfer transfer)
+{
+	uint64_t count = vector.size();
+	stream.value(count);
+	if (count > stream.remaining())
+	{
+		stream.valid = false;
+		return;
+	}
+	vector.resize(size_t(count));
+	for (auto& element : vector)
+	{
+		transfer(stream, element);
+	}
+}
+
+template <typename Stream, typename T, typename Transfer>
+void transferVector(Stream& stream, const std::vector<T>& vector, Transfer transfer)
+{
+	stream.value(uint64_t(vector.size()));
+	for (auto& element : vector)
+	{
+		transfer(stream, element);
+	}
+}
+
+template <typename Stream, typename T>
+void transferScene(Stream& stream, T& scene)
+{
+	stream.string(scene.name);
+	transferCamera(stream, scene.camera);
+	transferVector(stream, scene.materials, [](auto& inner, auto& material) { transferMaterial(inner, material); });
+	transferVector(stream, scene.textures, [](auto& inner, auto& texture) { transferTexture(inner, texture); });
+	stream.array(scene.point_lights);
+	stream.array(scene.direction_lights);
+	transferVector(stream, scene.meshes, [](auto& inner, auto& mesh) { transferMesh(inner, getMesh(mesh)); });
+	transferVector(stream, scene.objects, [](auto& inner, auto& object) { transferObject(inner, object); });
+	stream.array(scene.bvh);
+	stream.array(scene.wide_bvh.nodes);
+	stream.array(scene.wide_bvh.primitive_indices);
+	stream.array(scene.light_object_index);
+	stream.array(scene.light_table.entries);
+	stream.array(scene.light_tree.nodes);
+	stream.array(scene.light_tree.bit_trails);
+	stream.value(scene.light_tree.infinite_count);
+	stream.array(scene.light_tree.infinite_powers);
+	stream.array(scene.light_emitters);
+	stream.value(scene.build_sah_cost);
+}
+
+/* Whether every alias of a table is one of its slots */
+bool validateAliasTable(const AliasTable& table)
+{
+	for (auto& entry : table.entries)
+	{
+		if (entry.alias < 0 || entry.alias >= int(table.entries.size()))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Whether the children of every interior node follow it, so a traversal cannot loop, and every leaf is valid */
+template <typename Node, typename ValidLeaf>
+bool validateBVH(const std::vector<Node>& nodes, ValidLeaf valid_leaf)
+{
+	int count = int(nodes.size());
+	for (int i = 0; i < count; i++)
+	{
+		const Node& node = nodes[i];
+		if (node.leaf_node_flag ? !valid_leaf(node)
+								: node.left <= i || node.left >= count || node.right <= i || node.right >= count)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Whether a leaf references a range of the primitive index array */
+bool validateLeafRange(const BVH& node, const size_t primitive_index_count)
+{
+	return node.primitive_count == 0 ||
+		   (node.primitive_offset >= 0 && node.primitive_count > 0 &&
+			size_t(node.primitive_offset) + size_t(node.primitive_count) <= primitive_index_count);
+}
+
+/* Whether a wide BVH only references its own nodes and primitives and fits the traversal stack */
+bool validateWideBVH(const WideBVH<BVH_WIDTH>& bvh, const int primitive_count)
+{
+	for (auto& index : bvh.primitive_indices)
+	{
+		if (index < 0 || index >= primitive_count)
+		{
+			return false;
+		}
+	}
+
+	/* Children follow their parent, so the depth of every node is known before its children are checked */
+	int count = int(bvh.nodes.size());
+	std::vector<int> depth(bvh.nodes.size(), 0);
+	for (int i = 0; i < count; i++)
+	{
+		const WideBVHNode<BVH_WIDTH>& node = bvh.nodes[i];
+		for (int slot = 0; slot < BVH_WIDTH; slot++)
+		{
+			int offset = node.offset[slot];
+			if (node.count[slot] > 0)
+			{
+				if (offset < 0 || size_t(offset) + node.count[slot] > bvh.primitive_indices.size())
+				{
+					return false;
+				}
+			}
+			else if (offset != -1)
+			{
+				if (offset <= i || offset >= count || depth[i] + 1 >= MAX_TRAVERSAL_DEPTH)
+				{
+					return false;
+				}
+				depth[offset] = std::max(depth[offset], depth[i] + 1);
+			}
+			else
+			{
+				/* Unused slots are only skipped by the slab test if their bounds are empty */
+				for (int axis = 0; axis < 3; axis++)
+				{
+					if (node.bounds[axis][slot] != std::numeric_limits<float>::infinity() ||
+						node.bounds[axis + 3][slot] != -std::numeric_limits<float>::infinity())
+					{
+						return false;
+					}
+				}
+			}
+		}
+	}
+	return true;
+}
+
+/* Whether every index stored with a mesh, in memory or in the geometry cache, is inside the array it refers to */
+bool validateMesh(const PathTracingMesh& mesh)
+{
+	const GeometryCache* cache = mesh.geometry_cache;
+	int triangle_count = mesh.getTriangleCount();
+	int vertex_count = cache == nullptr ? int(mesh.vertices.size()) : cache->getCount(mesh.geometry_vertices);
+	int index_count = cache == nullptr ? int(mesh.indices.size()) : cache->getCount(mesh.geometry_indices);
+	if (size_t(index_count) != 3 * size_t(triangle_count))
+	{
+		return false;
+	}
+	for (int i = 0; i < index_count; i++)
+	{
+		Index vertex = cache == nullptr ? mesh.indices[i] : cache->get<Index>(mesh.geometry_indices, i);
+		if (vertex < 0 || vertex >= vertex_count)
+		{
+			return false;
+		}
+	}
+	for (auto& vertex : mesh.vertex_index)
+	{
+		if (vertex < -1 || vertex >= vertex_count)
+		{
+			return false;
+		}
+	}
+
+	for (auto& triangle : mesh.triangle_indices)
+	{
+		if (triangle < 0 || triangle >= triangle_count)
+		{
+			return false;
+		}
+	}
+	size_t primitive_index_count = mesh.triangle_indices.size();
+	if (!validateBVH(mesh.bvh, [&](const BVH& node) { return validateLeafRange(node, primitive_index_count); }))
+	{
+		return false;
+	}
+
+	size_t table_size = mesh.triangle_table.entries.size();
+	return (table_size == 0 || table_size == size_t(triangle_count)) && validateAliasTable(mesh.triangle_table) &&
+		   validateWideBVH(mesh.wide_bvh, triangle_count);
+}
+
+/* Whether every index of a loaded scene, whose objects already reference their meshes, is inside its array */
+bool validateScene(const PathTracingScene& scene)
+{
+	for (auto& mesh : scene.meshes)
+	{
+		if (!validateMesh(*mesh))
+		{
+			return false;
+		}
+	}
+
+	int object_count = int(scene.objects.size());
+	for (auto& object : scene.objects)
+	{
+		/* The texture of a shaded hit is read at the material index */
+		if (object.material_index < -1 || object.material_index >= int(scene.textures.size()))
+		{
+			return false;
+		}
+	}
+	if (!validateBVH(scene.bvh, [&](const SceneBVH& node) {
+			return node.object_index >= 0 && node.object_index < object_count;
+		}) ||
+		!validateWideBVH(scene.wide_bvh, object_count))
+	{
+		return false;
+	}
+
+	/* Light objects are sampled through the triangle tables of their meshes */
+	for (auto& index : scene.light_object_index)
+	{
+		if (index < 0 || index >= object_count)
+		{
+			return false;
+		}
+		const PathTracingMesh& mesh = *scene.objects[index].geometry;
+		if (mesh.triangle_table.entries.size() != size_t(mesh.getTriangleCount()))
+		{
+			return false;
+		}
+	}
+	if (!validateAliasTable(scene.light_table))
+	{
+		return false;
+	}
+
+	for (auto& emitter : scene.light_emitters)
+	{
+		int count = int(scene.direction_lights.size());
+		if (emitter.object_index >= 0)
+		{
+			count = scene.objects[emitter.object_index].geometry->getTriangleCount();
+		}
+		else if (emitter.object_index == -1)
+		{
+			count = int(scene.point_lights.size());
+		}
+		if (emitter.index < 0 || emitter.index >= count)
+		{
+			return false;
+		}
+	}
+
+	/* Interior nodes are followed by their first child, leaves hold one of the lights in front of the infinite ones */
+	const LightTree& tree = scene.light_tree;
+	int node_count = int(tree.nodes.size());
+	int light_count = int(scene.light_emitters.size()) - tree.infinite_count;
+	if (light_count < 0)
+	{
+		return false;
+	}
+	for (int i = 0; i < node_count; i++)
+	{
+		int child_or_light = tree.nodes[i].child_or_light;
+		if (tree.nodes[i].leaf_node_flag ? child_or_light < 0 || child_or_light >= light_count
+										 : child_or_light <= i + 1 || child_or_light >= node_count)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+} // namespace
+
+MappedFile::~MappedFile()
+{
+	this->close();
+}
+
+bool MappedFile::open(const std::string& path)
+{
+	this->close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(
+		path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+	{
+		CloseHandle(file);
+		return false;
+	}
+	this->length = size_t(size.QuadPart);
+	if (this->length > 0)
+	{
+		this->mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (this->mapping != nullptr)
+		{
+			this->address = static_cast<const char*>(MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0));
+		}
+	}
+	CloseHandle(file);
+#else
+	int file = ::open(path.c_str(), O_RDONLY);
+	if (file == -1)
+	{
+		return false;
+	}
+
+	struct stat status;
+	if (fstat(file, &status) != 0)
+	{
+		::close(file);
+		return false;
+	}
+	this->length = size_t(status.st_size);
+	if (this->length > 0)
+	{
+		void* address = mmap(nullptr, this->length, PROT_READ, MAP_PRIVATE, file, 0);
+		this->address = address == MAP_FAILED ? nullptr : static_cast<const char*>(address);
+	}
+	::close(file);
+#endif
+
+	if (this->length > 0 && this->address == nullptr)
+	{
+		this->close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (this->address != nullptr)
+	{
+		UnmapViewOfFile(this->address);
+	}
+	if (this->mapping != nullptr)
+	{
+		CloseHandle(this->mapping);
+	}
+#else
+	if (this->address != nullptr)
+	{
+		munmap(const_cast<char*>(this->address), this->length);
+	}
+#endif
+	this->address = nullptr;
+	this->mapping = nullptr;
+	this->length = 0;
+}
+
+const char* MappedFile::data() const
+{
+	return this->address;
+}
+
+size_t MappedFile::size() const
+{
+	return this->length;
+}
+
+uint64_t hashSourceFiles(const std::vector<std::string>& paths)
+{
+	uint64_t hash = HASH_OFFSET;
+	for (auto& path : paths)
+	{
+		hash = hashBytes(path.data(), path.size(), hash);
+
+		MappedFile file;
+		if (!file.open(path))
+		{
+			hash = (hash ^ 0xff) * HASH_PRIME;
+			continue;
+		}
+
+		uint64_t size = file.size();
+		hash = hashBytes(reinterpret_cast<const char*>(&size), sizeof(size), hash);
+		hash = hashBytes(file.data(), file.size(), hash);
+	}
+	return hash;
+}
+
+bool saveSceneCache(const std::string& path, const PathTracingScene& scene, const std::vector<std::string>& sources)
+{
+	std::vector<std::string> files = sources;
+	for (auto& texture : scene.textures)
+	{
+		if (!texture.texture_path.empty())
+		{
+			files.push_back(texture.texture_path);
+		}
+	}
+
+	std::string temporary_path = path + ".tmp";
+	{
+		std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			return false;
+		}
+
+		CacheWriter writer(file);
+		writer.value(SCENE_CACHE_MAGIC);
+		writer.value(SCENE_CACHE_VERSION);
+		writer.value(CacheLayout{});
+		writer.value(CacheBuilder(scene.bvh_builder));
+
+		writer.value(uint64_t(files.size()));
+		for (auto& source : files)
+		{
+			writer.string(source);
+		}
+		writer.value(hashSourceFiles(files));
+
+		transferScene(writer, scene);
+		if (!file)
+		{
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary_path, path, error);
+	return !error;
+}
+
+bool loadSceneCache(const std::string& path, PathTracingScene& scene, const size_t geometry_cache_size)
+{
+	MappedFile file;
+	if (!file.open(path))
+	{
+		return false;
+	}
+	CacheReader reader(file.data(), file.size());
+
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	CacheLayout layout;
+	CacheBuilder builder;
+	reader.value(magic);
+	reader.value(version);
+	reader.value(layout);
+	reader.value(builder);
+	if (!reader.valid || magic != SCENE_CACHE_MAGIC || version != SCENE_CACHE_VERSION || !(layout == CacheLayout{}) ||
+		!(builder == CacheBuilder(scene.bvh_builder)))
+	{
+		return false;
+	}
+
+	/* A cache is only as new as the files it was built from */
+	uint64_t source_count = 0;
+	reader.value(source_count);
+	if (!reader.valid || source_count > file.size())
+	{
+		return false;
+	}
+	std::vector<std::string> sources(static_cast<size_t>(source_count));
+	for (auto& source : sources)
+	{
+		reader.string(source);
+	}
+	uint64_t source_hash = 0;
+	reader.value(source_hash);
+	if (!reader.valid || source_hash != hashSourceFiles(sources))
+	{
+		return false;
+	}
+
+	std::shared_ptr<GeometryCache> geometry_cache;
+	if (geometry_cache_size > 0)
+	{
+		geometry_cache = std::make_shared<GeometryCache>(geometry_cache_size);
+		if (!geometry_cache->open(path))
+		{
+			return false;
+		}
+		reader.geometry_cache = geometry_cache.get();
+	}
+
+	PathTracingScene cached;
+	transferScene(reader, cached);
+	if (!reader.valid ||
+		cached.light_table.entries.size() !=
+			cached.light_object_index.size() + cached.point_lights.size() + cached.direction_lights.size() ||
+		cached.light_tree.bit_trails.size() != cached.light_emitters.size() ||
+		cached.light_tree.infinite_count != int(cached.direction_lights.size()) ||
+		cached.light_tree.infinite_powers.size() != cached.direction_lights.size())
+	{
+		return false;
+	}
+	for (auto& object : cached.objects)
+	{
+		if (object.mesh_index < 0 || object.mesh_index >= int(cached.meshes.size()))
+		{
+			return false;
+		}
+		object.geometry = cached.meshes[object.mesh_index];
+	}
+	for (auto& emitter : cached.light_emitters)
+	{
+		if (emitter.object_index < -2 || emitter.object_index >= int(cached.objects.size()))
+		{
+			return false;
+		}
+	}
+	if (!validateScene(cached))
+	{
+		return false;
+	}
+
+	scene.name = std::move(cached.name);
+	scene.camera = std::move(cached.camera);
+	scene.materials = std::move(cached.materials);
+	scene.textures = std::move(cached.textures);
+	scene.point_lights = std::move(cached.point_lights);
+	scene.direction_lights = std::move(cached.direction_lights);
+	scene.objects = std::move(cached.objects);
+	scene.meshes = std::move(cached.meshes);
+	scene.bvh = std::move(cached.bvh);
+	scene.wide_bvh = std::move(cached.wide_bvh);
+	scene.light_object_index = std::move(cached.light_object_index);
+	scene.light_table = std::move(cached.light_table);
+	scene.light_tree = std::move(cached.light_tree);
+	scene.light_emitters = std::move(cached.light_emitters);
+	scene.build_sah_cost = cached.build_sah_cost;
+	scene.geometry_cache = std::move(geometry_cache);
+	scene.initLightLookup();
+	scene.initMaterials();
+	return true;
+}
@@ -0,0 +1,99 @@
+#include <tile_scheduler.h>
+
+void TileScheduler::init(const int width, const int height, const int tile_size, const int thread_count)
+{
+	int count_x = (width + tile_size - 1) / tile_size;
+	int count_y = (height + tile_size - 1) / tile_size;
+	this->tile_count = count_x * count_y;
+	this->finished = 0;
+
+	int threads = std::max(thread_count, 1);
+	this->queues.clear();
+	for (int i = 0; i < threads; i++)
+	{
+		this->queues.push_back(std::make_unique<WorkQueue>());
+	}
+	this->statistics.assign(threads, ThreadStatistics{});
+
+	/* Give every thread a contiguous run of tiles so neighbouring tiles share cached geometry */
+	for (int i = 0; i < this->tile_count; i++)
+	{
+		Tile tile;
+		tile.index = i;
+		tile.x_begin = (i % count_x) * tile_size;
+		tile.y_begin = (i / count_x) * tile_size;
+		tile.x_end = std::min(tile.x_begin + tile_size, width);
+		tile.y_end = std::min(tile.y_begin + tile_size, height);
+
+		int owner = int(int64_t(i) * threads / this->tile_count);
+		this->queues[owner]->tiles.push_back(tile);
+	}
+}
+
+bool TileScheduler::next(const int thread, Tile& tile)
+{
+	int threads = int(this->queues.size());
+
+	/* Take work from the front of the own queue */
+	{
+		auto& queue = *this->queues[thread];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tiles.empty())
+		{
+			tile = queue.tiles.front();
+			queue.tiles.pop_front();
+			return true;
+		}
+	}
+
+	/* Steal from the back of the other queues */
+	for (int i = 1; i < threads; i++)
+	{
+		auto& victim = *this->queues[(thread + i) % threads];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tiles.empty())
+		{
+			tile = victim.tiles.back();
+			victim.tiles.pop_back();
+			this->statistics[thread].stolen++;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void TileScheduler::finish(const int thread, const std::chrono::steady_clock::duration duration)
+{
+	this->statistics[thread].tiles++;
+	this->statistics[thread].busy += duration;
+	this->finished++;
+}
+
+float TileScheduler::getProgress() const
+{
+	return this->tile_count == 0 ? 1.0f : float(this->finished) / float(this->tile_count);
+}
+
+void TileScheduler::outputStatistics(const std::chrono::steady_clock::duration duration) const
+{
+	double seconds = std::chrono::duration<double>(duration).count();
+	double busy_sum = 0.0;
+
+	std::cout << "Tiles: " << this->tile_count << " , Threads: " << this->statistics.size()
+			  << " , Tiles/s: " << (seconds > 0.0 ? this->tile_count / seconds : 0.0) << std::endl;
+	for (size_t i = 0; i < this->statistics.size(); i++)
+	{
+		auto& statistic = this->statistics[i];
+		double busy = std::chrono::duration<double>(statistic.busy).count();
+		busy_sum += busy;
+		std::cout << "  Thread " << i << " : " << statistic.tiles << " tiles (" << statistic.stolen << " stolen), "
+				  << int(seconds > 0.0 ? 100.0 * busy / seconds : 0.0) << " % utilization" << std::endl;
+	}
+
+	if (!this->statistics.empty() && seconds > 0.0)
+	{
+		std::cout << "Average Utilization: " << int(100.0 * busy_sum / (seconds * this->statistics.size())) << " %"
+				  << std::endl;
+	}
+}
@@ -0,0 +1,36 @@
+#include <triangle_record.h>
+
+TriangleRecord::TriangleRecord(const Vertex& vertex1, const Vertex& vertex2, const Vertex& vertex3)
+{
+	this->vertex = vertex1.position;
+	this->edge1 = vertex2.position - vertex1.position;
+	this->edge2 = vertex3.position - vertex1.position;
+
+	auto average_normal = (vertex1.normal + vertex2.normal + vertex3.normal) / 3.0f;
+	this->normal = glm::normalize(glm::cross(this->edge1, this->edge2));
+	if (glm::dot(this->normal, average_normal) < 0.0f)
+	{
+		this->normal *= -1;
+	}
+}
+
+BoundingBox TriangleRecord::getBoundingBox() const
+{
+	BoundingBox bounding_box{this->vertex};
+	bounding_box.unionPoint(this->vertex + this->edge1);
+	bounding_box.unionPoint(this->vertex + this->edge2);
+	return bounding_box;
+}
+
+float TriangleRecord::getArea() const
+{
+	return glm::length(glm::cross(this->edge1, this->edge2)) * 0.5f;
+}
+
+void TriangleRecord::sample(Point& point, float& pdf, const Vector2f& u) const
+{
+	float x = std::sqrt(u.x);
+	float y = u.y;
+	point = this->vertex + this->edge1 * (x * (1.0f - y)) + this->edge2 * (x * y);
+	pdf = 1.0f / this->getArea();
+}
@@ -0,0 +1,260 @@
+#include <wavefront.h>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+const char* STAGE_NAMES[] = {"Generate", "Extend", "Shade", "Connect", "Accumulate"};
+} // namespace
+
+void WavefrontIntegrator::clear()
+{
+	this->throughput.clear();
+	this->radiance.clear();
+	this->bsdf_pdf.clear();
+	this->previous_point.clear();
+	this->previous_normal.clear();
+	this->pixel.clear();
+	this->sampler_state.clear();
+	this->ray_path.clear();
+	this->rays.clear();
+}
+
+void WavefrontIntegrator::addPath(const Ray& ray, const int pixel, const Sampler& sampler)
+{
+	this->ray_path.push_back(int(this->pixel.size()));
+	this->rays.push_back(ray);
+
+	this->throughput.push_back(Vector3f{1.0f});
+	this->radiance.push_back(Vector3f{0.0f});
+	this->bsdf_pdf.push_back(0.0f);
+	this->previous_point.push_back(Point{0.0f});
+	this->previous_normal.push_back(Direction{0.0f});
+	this->pixel.push_back(pixel);
+	this->sampler_state.push_back(sampler.getState());
+}
+
+uint64_t WavefrontIntegrator::trace(PathTracingScene& scene, Sampler& sampler)
+{
+	uint64_t path_segments = 0;
+
+	/* Paths still alive after max_depth bounces are terminated without further radiance */
+	for (int depth = 0; depth <= scene.max_depth && !this->rays.empty(); depth++)
+	{
+		auto start = Clock::now();
+		path_segments += this->rays.size();
+		this->extend(scene);
+		auto extended = Clock::now();
+
+		this->next_ray_path.clear();
+		this->next_rays.clear();
+		this->shadow_path.clear();
+		this->shadow_rays.clear();
+		this->shadow_contribution.clear();
+
+		this->sortHits(scene);
+		for (int material = 0; material < int(this->material_queue.size()); material++)
+		{
+			switch (scene.bsdfs[material].type)
+			{
+			case MaterialType::Diffuse:
+				this->shade<MaterialType::Diffuse>(scene, sampler, material, depth);
+				break;
+			case MaterialType::Glossy:
+				this->shade<MaterialType::Glossy>(scene, sampler, material, depth);
+				break;
+			case MaterialType::Specular:
+				this->shade<MaterialType::Specular>(scene, sampler, material, depth);
+				break;
+			case MaterialType::Refraction:
+				this->shade<MaterialType::Refraction>(scene, sampler, material, depth);
+				break;
+			}
+		}
+		auto shaded = Clock::now();
+
+		this->connect(scene);
+		auto connected = Clock::now();
+
+		this->ray_path.swap(this->next_ray_path);
+		this->rays.swap(this->next_rays);
+
+		this->stage_time[size_t(WavefrontStage::Extend)] += extended - start;
+		this->stage_time[size_t(WavefrontStage::Shade)] += shaded - extended;
+		this->stage_time[size_t(WavefrontStage::Connect)] += connected - shaded;
+	}
+	this->ray_path.clear();
+	this->rays.clear();
+	return path_segments;
+}
+
+void WavefrontIntegrator::accumulate(std::vector<Vector3f>& frame_buffer, const float weight)
+{
+	auto start = Clock::now();
+	for (size_t i = 0; i < this->pixel.size(); i++)
+	{
+		frame_buffer[this->pixel[i]] += this->radiance[i] * weight;
+	}
+	this->stage_time[size_t(WavefrontStage::Accumulate)] += Clock::now() - start;
+}
+
+void WavefrontIntegrator::addStageTimes(const WavefrontIntegrator& other)
+{
+	for (size_t i = 0; i < this->stage_time.size(); i++)
+	{
+		this->stage_time[i] += other.stage_time[i];
+	}
+}
+
+void WavefrontIntegrator::outputStatistics() const
+{
+	double total = 0.0;
+	for (auto& time : this->stage_time)
+	{
+		total += std::chrono::duration<double>(time).count();
+	}
+
+	std::cout << "Wavefront stages:" << std::endl;
+	for (size_t i = 0; i < this->stage_time.size(); i++)
+	{
+		double seconds = std::chrono::duration<double>(this->stage_time[i]).count();
+		std::cout << "  " << STAGE_NAMES[i] << " : " << seconds * 1000.0 << " ms ("
+				  << int(total > 0.0 ? 100.0 * seconds / total : 0.0) << " %)" << std::endl;
+	}
+}
+
+void WavefrontIntegrator::extend(const PathTracingScene& scene)
+{
+	scene.intersect(this->rays, this->hits, this->order);
+}
+
+void WavefrontIntegrator::sortHits(const PathTracingScene& scene)
+{
+	this->material_queue.resize(scene.bsdfs.size());
+	for (auto& queue : this->material_queue)
+	{
+		queue.clear();
+	}
+
+	for (size_t i = 0; i < this->rays.size(); i++)
+	{
+		const IntersectResult& hit = this->hits[i];
+		if (!hit.is_intersect)
+		{
+			continue;
+		}
+
+		const PathTracingObject& object = scene.objects[hit.object_index];
+		if (object.is_light)
+		{
+			/* The light is weighted against sampling the same point from the previous vertex */
+			int path = this->ray_path[i];
+			float weight = 1.0f;
+			if (this->bsdf_pdf[path] > 0.0f)
+			{
+				float light_pdf = scene.getLightPDF(this->previous_point[path], this->previous_normal[path], hit);
+				weight = powerHeuristic(this->bsdf_pdf[path], light_pdf);
+			}
+			this->radiance[path] += this->throughput[path] * object.radiance * weight;
+			continue;
+		}
+		this->material_queue[object.bsdf_index].push_back(int(i));
+	}
+}
+
+template <MaterialType type>
+void WavefrontIntegrator::shade(PathTracingScene& scene, Sampler& sampler, const int material, const int depth)
+{
+	using Kernels = BSDF<type>;
+	const BSDFParameters& bsdf = scene.bsdfs[material];
+	for (int i : this->material_queue[material])
+	{
+		int path = this->ray_path[i];
+		const IntersectResult& hit = this->hits[i];
+		const PathTracingObject& object = scene.objects[hit.object_index];
+		Point object_point = hit.point;
+		Direction object_normal = hit.normal;
+		Direction wi = -this->rays[i].direction;
+
+		sampler.setState(this->sampler_state[path]);
+		float u_light = sampler.get1D();
+		Vector2f u_light_point = sampler.get2D();
+		Vector2f u_bsdf = sampler.get2D();
+		float u_roulette = depth + 1 >= scene.russian_roulette_depth ? sampler.get1D() : 0.0f;
+		this->sampler_state[path] = sampler.getState();
+
+		Vector3f color{0.0f};
+		if (object.material_index != -1)
+		{
+			color = scene.textures[object.material_index].getColor(hit.uv.x, hit.uv.y);
+		}
+
+		/* Light samples of specular vertices carry no radiance, but their sample dimensions are still consumed */
+		LightSample light;
+		if (!Kernels::delta)
+		{
+			scene.sampleLight(light, object_point, object_normal, u_light, u_light_point);
+		}
+		if (light.pdf > 0.0f)
+		{
+			/* Point lights cannot be hit by BSDF samples, area light samples are weighted against them */
+			float weight = 1.0f;
+			if (light.object_index != -1)
+			{
+				weight = powerHeuristic(light.pdf, Kernels::pdf(bsdf, wi, light.direction, object_normal));
+			}
+			Vector3f evaluate = Kernels::evaluate(bsdf, wi, light.direction, object_normal, color);
+			Vector3f contribution = light.radiance * evaluate * weight / light.pdf;
+
+			/* Hits within 0.001 of the light sample belong to the light itself */
+			Ray shadow_ray{object_point, light.direction};
+			shadow_ray.t = light.distance - 0.001f;
+			this->shadow_path.push_back(path);
+			this->shadow_rays.push_back(shadow_ray);
+			this->shadow_contribution.push_back(this->throughput[path] * contribution);
+		}
+
+		Vector3f wo = glm::normalize(Kernels::sample(bsdf, wi, object_normal, u_bsdf));
+		this->bsdf_pdf[path] = 0.0f;
+		if (!Kernels::delta)
+		{
+			float pdf = Kernels::pdf(bsdf, wi, wo, object_normal);
+			if (pdf <= 0.0f)
+			{
+				continue;
+			}
+			this->bsdf_pdf[path] = pdf;
+			this->previous_point[path] = object_point;
+			this->previous_normal[path] = object_normal;
+
+			Vector3f evaluate = Kernels::evaluate(bsdf, wi, wo, object_normal, color);
+			this->throughput[path] *= evaluate / pdf;
+		}
+
+		/* Russian roulette, paths that carry little radiance are terminated and the survivors reweighted */
+		if (depth + 1 >= scene.russian_roulette_depth)
+		{
+			float survival = getSurvivalProbability(this->throughput[path]);
+			if (u_roulette >= survival)
+			{
+				continue;
+			}
+			this->throughput[path] /= survival;
+		}
+
+		this->next_ray_path.push_back(path);
+		this->next_rays.push_back(Ray{object_point, wo});
+	}
+}
+
+void WavefrontIntegrator::connect(const PathTracingScene& scene)
+{
+	scene.occluded(this->shadow_rays, this->shadow_occluded);
+	for (size_t i = 0; i < this->shadow_rays.size(); i++)
+	{
+		if (this->shadow_occluded[i] == 0)
+		{
+			this->radiance[this->shadow_path[i]] += this->shadow_contribution[i];
+		}
+	}
+}
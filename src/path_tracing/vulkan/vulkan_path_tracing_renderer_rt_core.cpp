@@ -30,8 +30,9 @@ void VulkanPathTracingRendererRTCore::setData(const Scene& scene)
 	auto command_manager_sptr = std::make_shared<CommandManager>(this->command_manager);
 	auto swap_chain_manager_sptr = std::make_shared<SwapChainManager>(this->swap_chain_manager);
 
-	this->all_vertex_managers.resize(scene.objects.size());
-	this->all_index_managers.resize(scene.objects.size());
+	this->all_vertex_managers.clear();
+	this->all_index_managers.clear();
+	this->instance_blas.clear();
 
 	auto getTransformMatrix = [](const Matrix4f& model) {
 		VkTransformMatrixKHR result{};
@@ -52,18 +53,28 @@ void VulkanPathTracingRendererRTCore::setData(const Scene& scene)
 	for (size_t i = 0; i < scene.objects.size(); i++)
 	{
 		auto& object = scene.objects[i];
-		this->all_vertex_managers[i] = VertexBufferManager(context_manager_sptr, command_manager_sptr);
-		this->all_vertex_managers[i].vertices = object.vertices;
-		this->all_vertex_managers[i].usage |= VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR;
-		this->all_vertex_managers[i].usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
-		this->all_vertex_managers[i].init();
-
-		this->all_index_managers[i] = IndexBufferManager(context_manager_sptr, command_manager_sptr);
-		this->all_index_managers[i].indices = object.indices;
-		this->all_index_managers[i].enable_ray_tracing = true;
-		this->all_index_managers[i].init();
-
 		this->model_matrixes.push_back(getTransformMatrix(object.model));
+
+		/* Instances are placed by their transform in the TLAS, the BLAS of their vertices is built once */
+		if (object.mesh_source != -1)
+		{
+			this->instance_blas.push_back(this->instance_blas[object.mesh_source]);
+			continue;
+		}
+		this->instance_blas.push_back(static_cast<uint32_t>(this->all_vertex_managers.size()));
+
+		this->all_vertex_managers.emplace_back(context_manager_sptr, command_manager_sptr);
+		auto& vertex_manager = this->all_vertex_managers.back();
+		vertex_manager.vertices = object.vertices;
+		vertex_manager.usage |= VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR;
+		vertex_manager.usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+		vertex_manager.init();
+
+		this->all_index_managers.emplace_back(context_manager_sptr, command_manager_sptr);
+		auto& index_manager = this->all_index_managers.back();
+		index_manager.indices = object.indices;
+		index_manager.enable_ray_tracing = true;
+		index_manager.init();
 	}
 
 	this->all_blas_buffer_manager = StorageBufferManager(context_manager_sptr, command_manager_sptr);
@@ -526,6 +537,10 @@ void VulkanPathTracingRendererRTCore::setupObjectAddress(const Scene& scene)
 
 		if (object.is_light)
 		{
+			/* Instances measure the triangles of the object they share them with */
+			auto& geometry = scene.getGeometry(scene.objects[i]);
+			object.vertices = geometry.vertices;
+			object.indices = geometry.indices;
 			object.getArea();
 
 			luminous_indices.push_back(i);
@@ -688,12 +703,12 @@ void VulkanPathTracingRendererRTCore::createBLAS()
 void VulkanPathTracingRendererRTCore::createTLAS()
 {
 	std::vector<VkAccelerationStructureInstanceKHR> instances{};
-	instances.resize(this->blas.size());
-	for (size_t i = 0; i < this->blas.size(); i++)
+	instances.resize(this->instance_blas.size());
+	for (size_t i = 0; i < this->instance_blas.size(); i++)
 	{
 		VkAccelerationStructureDeviceAddressInfoKHR address{};
 		address.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
-		address.accelerationStructure = this->blas[i];
+		address.accelerationStructure = this->blas[this->instance_blas[i]];
 
 		instances[i].transform = this->model_matrixes[i];
 		instances[i].instanceCustomIndex = static_cast<uint32_t>(i);
@@ -738,7 +753,7 @@ void VulkanPathTracingRendererRTCore::createTLAS()
 	VkAccelerationStructureBuildSizesInfoKHR build_size{};
 	build_size.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
 	build_size.pNext = nullptr;
-	uint32_t counts[] = {this->blas.size()};
+	uint32_t counts[] = {static_cast<uint32_t>(this->instance_blas.size())};
 	vkGetAccelerationStructureBuildSizesKHR(this->context_manager.device,
 											VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
 											&build_geometry,
@@ -770,7 +785,7 @@ void VulkanPathTracingRendererRTCore::createTLAS()
 	build_geometry.dstAccelerationStructure = this->tlas;
 	build_geometry.scratchData.deviceAddress = this->scratch_buffer_manager.getBufferAddress();
 
-	VkAccelerationStructureBuildRangeInfoKHR build_range{this->blas.size(), 0, 0, 0};
+	VkAccelerationStructureBuildRangeInfoKHR build_range{static_cast<uint32_t>(this->instance_blas.size()), 0, 0, 0};
 	VkAccelerationStructureBuildRangeInfoKHR* ranges[] = {&build_range};
 
 	auto command_buffer = this->command_manager.beginGraphicsCommands();